@@ -13,6 +13,10 @@
 
 class ConvSim : public Simulator {
     protected:
+        friend class SimDriver<ConvSim>;
+
+        /**the ciphertext is the AES of fingerprint under the MLE key */
+        static const int CIPHER_TYPE = CIPHER_AES;
 
         /// \brief generate the encrypt key
         ///
@@ -24,6 +28,16 @@ class ConvSim : public Simulator {
            cryptoObj_->generateHash(chunkHash, FP_SIZE + 1, key);
         }
 
+        /// \brief the key-derivation policy: the key is the hash of chunk
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived key <return>
+        inline void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize,
+            uint8_t* key) {
+            KeyGen(chunkFp, chunkSize, key);
+        }
+
     public:
 
         /// \brief Construct a new Conv Sim object
@@ -41,6 +55,13 @@ class ConvSim : public Simulator {
         void ProcessHashFile(std::string const inputFileName, 
            std::string const outputFileName);
 
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+        ///
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
 
 
 };
@@ -47,6 +47,18 @@ class CountMinSketch {
         /**array of arrays of counters */
         uint32_t** counterArray_;
 
+        /**the number of windows (1: no window), and the current window */
+        uint32_t windowNum_;
+        uint32_t currentWindow_;
+
+        /**window mode: the cells of each window (depth * width), 
+         * high 32 bits: epoch, low 32 bits: counter
+         */
+        uint64_t** windowCells_;
+
+        /**the epoch of each window, a cell is valid only if its epoch matches */
+        uint64_t* windowEpoch_;
+
         /**array of hash values for a particular item
          * contains two element arrays {aj, bj}
          */
@@ -68,14 +80,16 @@ class CountMinSketch {
         ///
         /// \param width 
         /// \param depth 
-        CountMinSketch(uint32_t width, uint32_t depth);
+        /// \param windowNum - the number of sub-sketches in the sliding window (1: disable)
+        CountMinSketch(uint32_t width, uint32_t depth, uint32_t windowNum = 1);
 
         /// \brief update the count in sketch 
         ///
         /// \param chunkHash 
         /// \param chunkHashLen 
         /// \param count 
-        void Update(uint8_t* const chunkHash, size_t chunkHashLen, uint32_t count);
+        /// \return uint32_t - the estimated count after update (in current window if enabled)
+        uint32_t Update(uint8_t* const chunkHash, size_t chunkHashLen, uint32_t count);
 
         /// \brief estimate the count in sketch
         ///
@@ -103,7 +117,11 @@ class CountMinSketch {
         ///
         void ClearUp();
 
-        /// \brief Get the First Row of the sketch
+        /// \brief move to the next window, the oldest window is aged out lazily by epoch
+        ///
+        void Rotate();
+
+        /// \brief Get the First Row of the sketch (not available in window mode)
         ///
         /// \return uint32_t* - the pointer points to the first row of sketch
         inline uint32_t* GetFirstRow() {
@@ -11,6 +11,8 @@
 #define ULL unsigned long long /**just for  */
 #define S2US (1000 * 1000)  /**transform second to microsecond */ 
 #define BUFFER_SIZE (128 * 1024 * 1024) /**the read buffer size */
+#define TRACE_BLOCK_SIZE (4 * 1024 * 1024) /**the block size of decompressed trace */
+#define TRACE_BLOCK_NUM (4) /**the number of blocks between reader thread and parser */
 #define CIPHER_SIZE (32)
 #define TEST_TIME (10)
 #define B_TO_GB (1024 * 1024 * 1024)
@@ -24,9 +26,56 @@
 
 #define ACCURACY (500)
 #define SEGMENT_ENABLE 0
+#define SKETCH_WINDOW_NUM (4) /**the number of sub-sketches in the sliding window (SEGMENT_ENABLE) */
 #define LOCAL_TEC 1
 #define GLOBAL_TEC 2
 
+/**for external-memory counting (sorted runs + merge instead of leveldb) */
+#define EXTERNAL_COUNT_ENABLE 0
+#define EXT_RUN_BUFFER_SIZE (256 * 1024 * 1024) /**the in-memory run size of each counter */
+#define EXT_MERGE_FAN_IN (128) /**the max number of runs merged in one pass */
+#define EXT_READ_BUFFER_SIZE (1024 * 1024) /**the read buffer size of each run in merge */
+
+/**for consistent sampling on fingerprint hash (approximate simulation) */
+#define SAMPLING_ENABLE 0
+#define SAMPLING_RATE (0.01) /**the fraction of fingerprints kept */
+#define SAMPLING_SEED (0x5eed) /**the seed of sampling hash */
+#define SAMPLING_Z_SCORE (1.96) /**for 95% confidence bounds */
+
+/**for the partition mode: each worker simulates the fingerprints in its hash range */
+#define PARTITION_SEED (0x9a27) /**the seed of partition hash (independent of sampling) */
+#define PARTITION_STAT_SUFFIX ".part" /**the mergeable partial statistics of a worker */
+
+/**for the multi-key-manager simulation: the routing schemes (as TEDStore keyClient) */
+#define ROUTE_BASIC 1 /**hash routing, to the least loaded manager if unbalanced */
+#define ROUTE_ENHANCE 2 /**as ROUTE_BASIC, but a fingerprint sticks to its manager (LRU) */
+#define ROUTE_FP 3 /**hash routing by the fingerprint value */
+#define ROUTE_RR 4 /**round robin */
+#define KM_DEVIATION_THRESHOLD (5000) /**the max deviation of load before rebalancing */
+#define KM_RECORD_CACHE_SIZE (1000000) /**the capacity of fingerprint -> manager cache */
+#define KM_KEY_ID_SIZE (16) /**the prefix of derived key counted in each manager */
+
+/**for HyperLogLog unique counting (approximate, no leveldb and no frequency output) */
+#define HLL_COUNT_ENABLE 0
+#define HLL_PRECISION (14) /**2^14 registers, about 0.8% standard error */
+#define HLL_SEED (0x4c4c) /**the seed of HyperLogLog hash */
+
+/**for the streaming time series of KLD, blowup and unique counts (leveldb counting only) */
+#define TIMESERIES_ENABLE 0
+#define TIMESERIES_INTERVAL (100000) /**emit a row every N logical chunks, 0: every fted batch */
+
+/**for SpaceSaving heavy-hitter tracking of plaintext and ciphertext chunks */
+#define HEAVY_HITTER_ENABLE 0
+#define HEAVY_HITTER_CAPACITY (4096) /**the number of monitored keys in each tracker */
+#define HEAVY_HITTER_TOP_K (100) /**the number of reported keys */
+
+/**for the output of ciphertext and frequency: formatted into buffers, written by a thread */
+#define OUTPUT_BUFFER_SIZE (4 * 1024 * 1024) /**the size of each of two buffers */
+#define OUTPUT_BINARY_ENABLE 0 /**binary records: [1-byte key length][key][8-byte value] */
+
+/**for the two-pass simulator: the in-memory cache of first pass, spill to disk if exceeds */
+#define PASS_CACHE_SIZE (512 * 1024 * 1024)
+
 /**for debug */
 #define CURRENT_LIEN __LINE__
 #define FILE_NAME __FILE__
@@ -0,0 +1,122 @@
+/// \file extCounter.h
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief define the interface of external-memory counter (sorted runs + merge)
+/// \version 0.1
+/// \date 2019-10-21
+///
+/// \copyright Copyright (c) 2019
+///
+#ifndef __EXT_COUNTER_H__
+#define __EXT_COUNTER_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "define.h"
+#include "outputSink.h"
+
+class ExtCounter {
+    private:
+        /**the prefix of the run files */
+        std::string prefix_;
+
+        /**the length of key, fixed by the first added key */
+        size_t keyLen_ = 0;
+
+        /**the length of an in-memory record: key + chunk size */
+        size_t memRecordLen_ = 0;
+
+        /**the length of an on-disk record: key + count + chunk size */
+        size_t diskRecordLen_ = 0;
+
+        /**the in-memory run buffer */
+        uint8_t* runBuffer_;
+        size_t runBufferSize_;
+        size_t runBufferUsed_ = 0;
+
+        /**the index array used to sort the in-memory run */
+        std::vector<uint32_t> sortIndex_;
+
+        /**the file name list of the sorted runs */
+        std::vector<std::string> runList_;
+        uint64_t runCount_ = 0;
+
+        /**the file name of final merged run */
+        std::string mergedName_;
+        bool isFinalized_ = false;
+
+        /**the unique statistics computed in merge */
+        uint64_t uniqueChunks_ = 0;
+        uint64_t uniqueSize_ = 0;
+
+        /**the sum of squares computed in merge: count^2, (count * size)^2, size^2 */
+        double freqSquare_ = 0;
+        double freqSizeSquare_ = 0;
+        double sizeSquare_ = 0;
+
+        /// \brief sort the in-memory run and write it to disk
+        ///
+        void SpillRun();
+
+        /// \brief record the statistics of a unique key in final merge
+        ///
+        /// \param count - the count of this key
+        /// \param size - the chunk size of this key
+        void AddUniqueStat(uint64_t const count, uint64_t const size);
+
+        /// \brief merge a list of sorted runs into one run
+        ///
+        /// \param inputList - the input run files
+        /// \param outputName - the output run file
+        /// \param countUnique - whether to count the unique statistics
+        void MergeRuns(std::vector<std::string>& inputList, std::string const outputName,
+            bool const countUnique);
+
+        /// \brief generate the name of a new run file
+        ///
+        /// \return std::string - the run file name
+        std::string NewRunName();
+
+    public:
+        /// \brief Construct a new Ext Counter object
+        ///
+        /// \param prefix - the prefix of the run files
+        /// \param bufferSize - the size of in-memory run buffer
+        ExtCounter(std::string const prefix, size_t bufferSize = EXT_RUN_BUFFER_SIZE);
+
+        /// \brief Destroy the Ext Counter object
+        ///
+        ~ExtCounter();
+
+        /// \brief add a key to the counter
+        ///
+        /// \param key - the key buffer
+        /// \param keyLen - the length of key
+        /// \param chunkSize - the size of this chunk
+        void Add(uint8_t* const key, size_t keyLen, uint64_t const chunkSize);
+
+        /// \brief merge all runs to get the exact counts, only works for the first call
+        ///
+        /// \param uniqueChunks - the number of unique keys <return>
+        /// \param uniqueSize - the size of unique keys <return>
+        void Finalize(uint64_t& uniqueChunks, uint64_t& uniqueSize);
+
+        /// \brief Get the sum of squares of per-key statistics (after Finalize)
+        ///
+        /// \param freqSquare - sum of count^2 <return>
+        /// \param freqSizeSquare - sum of (count * size)^2 <return>
+        /// \param sizeSquare - sum of size^2 <return>
+        void GetSquareSum(double& freqSquare, double& freqSizeSquare, double& sizeSquare);
+
+        /// \brief print the frequency of each key in the key order
+        ///
+        /// \param sink - the output sink
+        /// \param FpLength - the length of key to print
+        void PrintFreq(OutputSink* sink, size_t FpLength);
+};
+
+#endif // !__EXT_COUNTER_H__
@@ -16,10 +16,16 @@
 #include "countMin.h"
 #include "randomGen.h"
 #include <unordered_set>
+#include <vector>
 #include <sys/time.h>
 
 class GlobalTECSim : public Simulator {
     protected:
+        friend class SimDriver<GlobalTECSim>;
+
+        /**the ciphertext is the fingerprint + the state */
+        static const int CIPHER_TYPE = CIPHER_STATE;
+
         /**storage blowup rate: [0, 1] */
         double blowUpRate_;
 
@@ -47,6 +53,26 @@ class GlobalTECSim : public Simulator {
         /**the threshold in TEC */
         uint32_t threshold_;
 
+        /**the cache of parsed records in first pass: fingerprint + chunk size */
+        std::vector<uint8_t> passCache_;
+
+        /**the spill file of the cache when it exceeds PASS_CACHE_SIZE */
+        FILE* passCacheFile_ = NULL;
+        std::string passCacheName_;
+
+        /// \brief append a parsed record to the first pass cache
+        ///
+        /// \param chunkHash - the chunk fingerprint (FP_SIZE)
+        /// \param chunkSize - the chunk size
+        void CacheRecord(uint8_t* const chunkHash, uint64_t const chunkSize);
+
+        /// \brief process a block of cached records in second pass
+        ///
+        /// \param block - the record block
+        /// \param blockLen - the length of the block
+        /// \param fpOut - the output file
+        void ProcessCacheBlock(uint8_t* const block, size_t blockLen, FILE* fpOut);
+
         /// \brief update the state according to the incoming chunk in global hash table
         ///
         /// \param chunkHash 
@@ -63,6 +89,18 @@ class GlobalTECSim : public Simulator {
         /// \param key - generated encryption key <return>
         void KeyGen(uint8_t* const chunkHash, size_t chunkHashLen, 
             uint64_t const chunkSize, uint8_t key[sizeof(int)]);
+
+        /// \brief the key-derivation policy: update the frequency, then derive the state
+        /// by the solved threshold
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived state <return>
+        inline void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize,
+            uint8_t* key) {
+            GlobalUpdateState(chunkFp, FP_SIZE + 1, chunkSize);
+            KeyGen(chunkFp, FP_SIZE + 1, chunkSize, key);
+        }
         
         /// \brief simulate the encryption process: directly append the (frequency / T) to the 
         /// end of hash
@@ -80,7 +118,11 @@ class GlobalTECSim : public Simulator {
         ///
         GlobalTECSim() {
             fprintf(stderr, "Initialize Global Tunable Encryption Simulator.\n");
+            /**the ciphertext is the fingerprint + 4-byte state */
+            cipherFpLen_ = FP_SIZE + sizeof(int);
             cmSketch_ = new CountMinSketch(SKETCH_WIDTH, SKETCH_DEPTH);
+            /**the heavy hitters are tracked alongside the sketch */
+            InitHeavyHitter();
         }
 
         /// \brief Destroy the Global TECSim object
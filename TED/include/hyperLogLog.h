@@ -0,0 +1,77 @@
+/// \file hyperLogLog.h
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief define the interface of HyperLogLog cardinality estimator
+/// \version 0.1
+/// \date 2019-10-27
+///
+/// \copyright Copyright (c) 2019
+///
+#ifndef __HYPER_LOG_LOG_H__
+#define __HYPER_LOG_LOG_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "define.h"
+#include "murmurHash3.h"
+
+class HyperLogLog {
+    private:
+        /**the number of index bits, and the number of registers (2^precision) */
+        uint32_t precision_;
+        uint32_t registerNum_;
+
+        /**the max rank observed in each register */
+        uint8_t* registers_;
+
+    public:
+        /// \brief Construct a new Hyper Log Log object
+        ///
+        /// \param precision - the number of index bits, [4, 18]
+        HyperLogLog(uint32_t precision = HLL_PRECISION);
+
+        /// \brief Destroy the Hyper Log Log object
+        ///
+        ~HyperLogLog();
+
+        /// \brief add a key to the estimator
+        ///
+        /// \param key - the key buffer
+        /// \param keyLen - the length of key
+        void Add(uint8_t* const key, size_t keyLen);
+
+        /// \brief estimate the number of distinct keys
+        ///
+        /// \return double - the estimated cardinality
+        double Estimate();
+
+        /// \brief merge another estimator (of the same precision) into this one
+        ///
+        /// \param other - the other estimator
+        void Merge(HyperLogLog const& other);
+
+        /// \brief reset all registers
+        ///
+        void Clear();
+
+        /// \brief save the registers to a file
+        ///
+        /// \param fp - the output file
+        void Save(FILE* fp);
+
+        /// \brief load the registers from a file
+        ///
+        /// \param fp - the input file
+        /// \return true - success
+        /// \return false - the file is broken or the precision mismatches
+        bool Load(FILE* fp);
+
+        /// \brief Get the relative standard error of estimation (1.04 / sqrt(m))
+        ///
+        /// \return double - the standard error
+        double GetStandardError();
+};
+
+#endif // !__HYPER_LOG_LOG_H__
@@ -14,6 +14,23 @@
 
 class IntuiSim : public TECSim {
     private:
+        friend class SimDriver<IntuiSim>;
+
+        /**the ciphertext is the fingerprint + the state */
+        static const int CIPHER_TYPE = CIPHER_STATE;
+
+        /// \brief the key-derivation policy: update the frequency, then derive the state by the
+        /// intuitive threshold
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived state <return>
+        inline void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize,
+            uint8_t* key) {
+            currentLogicalChunk_++;
+            TECUpdateState(chunkFp, FP_SIZE + 1, chunkSize);
+            IntuiKeyGen(chunkFp, FP_SIZE + 1, chunkSize, key);
+        }
 
         double boundRate_;
 
@@ -42,6 +59,8 @@ class IntuiSim : public TECSim {
         ///
         IntuiSim() {
             fprintf(stderr, "Initialize Intuitive Simulator.\n");
+            /**the ciphertext is the fingerprint + 4-byte state */
+            cipherFpLen_ = FP_SIZE + sizeof(int);
             boundRate_ = 0;
             currentAvg_ = 0;
             thresholdArray_ = (uint32_t*)malloc(sizeof(int32_t) * SKETCH_WIDTH);
@@ -62,6 +81,13 @@ class IntuiSim : public TECSim {
         void ProcessHashFile(std::string const inputFileName, 
           std::string const outputFileName); 
 
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+        ///
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
         ~IntuiSim() {
             fprintf(stderr, "Destory Intuitive Simulator.\n");
             free(thresholdArray_);
@@ -0,0 +1,126 @@
+/// \file libted.h
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief define the embeddable interface of TED simulators
+/// \version 0.1
+/// \date 2019-10-30
+///
+/// \copyright Copyright (c) 2019
+///
+
+#ifndef __LIB_TED_H__
+#define __LIB_TED_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "define.h"
+#include "sim.h"
+
+/**the parameters of a simulator */
+typedef struct {
+    /**mle, bted, fted, minhash, ske, mkm */
+    std::string method;
+    /**bted, mkm: the threshold */
+    int threshold;
+    /**fted: the batch size and the storage blowup (>= 1) */
+    size_t batchSize;
+    double blowUpRate;
+    /**bted, fted, mkm: (0) Disable (1) uniform (2) poisson (3) normal (4) geo */
+    int distriType;
+    /**mkm: the number of key managers and the routing scheme (ROUTE_*) */
+    uint32_t managerNum;
+    int routeScheme;
+    /**partition mode: simulate the fingerprints in the hash range of partitionIndex,
+     * [0, partitionNum), partitionNum = 1: disable */
+    uint32_t partitionIndex;
+    uint32_t partitionNum;
+} TEDParam_t;
+
+/**a fingerprint record pushed from memory */
+typedef struct {
+    uint8_t fp[FP_SIZE];
+    uint64_t size;
+} TEDRecord_t;
+
+class TEDLib {
+    private:
+        /**the simulator of the method */
+        Simulator* sim_ = NULL;
+
+        /**the output of ciphertext (NULL: not print) */
+        FILE* cipherOut_ = NULL;
+
+        /**whether the pending records are flushed */
+        bool finished_ = false;
+
+    public:
+        /// \brief Construct a new TEDLib object, exit if the method is not supported
+        ///
+        /// \param param - the parameters of the simulator
+        TEDLib(TEDParam_t const& param);
+
+        /// \brief Destroy the TEDLib object
+        ///
+        ~TEDLib();
+
+        /// \brief check whether a method is supported
+        ///
+        /// \param method - the method name
+        /// \return true - supported
+        static bool IsSupported(std::string const method);
+
+        /// \brief process an input hash file (the same as the TEDSim)
+        ///
+        /// \param inputFileName - the input file name
+        /// \param outputFileName - the output file name
+        void ProcessHashFile(std::string const inputFileName,
+            std::string const outputFileName);
+
+        /// \brief Set the output of time series, must be called before pushing records
+        ///
+        /// \param fileName - the output file name, the time series goes to <fileName>.series.csv
+        void SetTimeSeriesOutput(std::string const fileName);
+
+        /// \brief Set the file of cumulative HyperLogLog state (HLL_COUNT_ENABLE), must be
+        /// called before pushing records
+        ///
+        /// \param fileName - the state file, removed to restart the cumulative estimation
+        void SetCumulativeState(std::string const fileName);
+
+        /// \brief print the ciphertext of pushed records to a file
+        ///
+        /// \param fileName - the output file name
+        /// \return true - success
+        bool OpenCipherOutput(std::string const fileName);
+
+        /// \brief push a batch of records from memory
+        ///
+        /// \param records - the record array
+        /// \param recordNum - the number of records
+        void PushRecords(TEDRecord_t const* records, size_t recordNum);
+
+        /// \brief finish the pushed stream: flush the pending records and print the
+        /// stat, frequency and heavy-hitter files (and the partial stat in partition mode)
+        ///
+        /// \param outputFileName - the output file name
+        void Finish(std::string const outputFileName);
+
+        /// \brief Get the statistics
+        ///
+        /// \param stat - the statistics <return>
+        void GetStat(SimStat_t& stat) { sim_->GetStat(stat); }
+
+        /// \brief Get a snapshot of the chunk frequencies
+        ///
+        /// \param flag - 0: original backup 1: encrypted backup
+        /// \param freqList - the list of (fingerprint, frequency) <return>
+        void GetFreqSnapshot(bool const flag,
+            std::vector<std::pair<std::string, uint64_t> >& freqList) {
+            sim_->GetFreqSnapshot(flag, freqList);
+        }
+};
+
+#endif // !__LIB_TED_H__
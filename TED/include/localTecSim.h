@@ -19,6 +19,22 @@
 
 class LocalTECSim : public Simulator {
     protected:
+        friend class SimDriver<LocalTECSim>;
+
+        /**the ciphertext is the AES of fingerprint under the key of {fp || state} */
+        static const int CIPHER_TYPE = CIPHER_AES;
+
+        /// \brief the key-derivation policy: update the global state, derive the key by the
+        /// threshold of current batch
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived key <return>
+        void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize, uint8_t* key);
+
+        /// \brief solve the threshold of next batch at the end of each batch
+        ///
+        void AfterRecord();
 
         /// \brief key generation process according to different threshold in a region
         ///
@@ -38,19 +54,6 @@ class LocalTECSim : public Simulator {
         void GlobalUpdateState(uint8_t* const chunkHash, 
             size_t chunkHashLen, uint64_t const chunkSize);
 
-        /// \brief update the state according to the incoming chunk in local hash table
-        ///
-        /// \param chunkHash - chunk hash
-        /// \param chunkHashLen - the length of chunk hash
-        /// \param chunkSize - chunk size
-        void LocalUpdateState(uint8_t* const chunkHash,
-            size_t chunkHashLen, uint64_t const chunkSize);
-
-
-        inline void LocalHashTableCleanUp() {
-            localKeyFreqTable_.clear();
-        }
-
         /// \brief simulate the encryption process: directly append the (frequency / T) to the 
         /// end of hash
         ///
@@ -65,17 +68,14 @@ class LocalTECSim : public Simulator {
         /**the size of the region to do optimization*/
         size_t regionSize_;
 
-        /**the hash table for solving the optimization*/
-        spp::sparse_hash_map<std::string, uint64_t> localKeyFreqTable_;
-
         /**the hash table for fast count information*/
         spp::sparse_hash_map<std::string, uint64_t> globalKeyFreqTable_;
 
         /**local logical chunk counter*/
-        size_t localCounter_;
+        size_t localCounter_ = 0;
 
         /**global logical chunk counter*/
-        size_t globalCounter_;
+        size_t globalCounter_ = 0;
 
         /**the batch size of each optimization unit*/
         size_t batchSize_ = 0;
@@ -83,6 +83,9 @@ class LocalTECSim : public Simulator {
         /**the array to store threshold */
         vector<uint32_t> thresholdArray_;
 
+        /**the index of current segment in thresholdArray_ */
+        size_t currentSegIndex_ = 0;
+
         /**storage blowup rate: [0, 1] */
         double blowUpRate_;
 
@@ -110,6 +113,8 @@ class LocalTECSim : public Simulator {
         LocalTECSim() { 
             fprintf(stderr, "Initialize Local Tunable Encryption Simulator.\n");
             cmSketch_ = new CountMinSketch(SKETCH_WIDTH, SKETCH_DEPTH);
+            /**the heavy hitters are tracked alongside the sketch */
+            InitHeavyHitter();
             
         }
 
@@ -136,14 +141,15 @@ class LocalTECSim : public Simulator {
         /// \param inputFileName - the input file name
         /// \param outputFileName - the output file name
         void ProcessHashFile(std::string const inputFileName, 
-          std::string const outputFileName); 
+          std::string const outputFileName);
 
-        /// \brief process an input hash file of encryption incremental local
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
         ///
-        /// \param inputFileName - the input file name
-        /// \param ouputFileName - the output file name
-        void ProcessHashFileLocal(std::string const inputFileName, 
-            std::string const ouputFileName);
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
         
         /// \brief Set the Batch Size object
         ///
@@ -72,7 +72,19 @@ class MinHashSim : public Simulator {
         /// \param inputFileName - the input file name
         /// \param outputFileName - the output file name
         void ProcessHashFile(std::string const inputFileName, 
-          std::string const outputFileName); 
+          std::string const outputFileName);
+
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+        ///
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
+        /// \brief process the pending records at the end of the stream
+        ///
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void FlushRecords(FILE* fpOut);
         
         /// \brief Construct a new Min Hash Sim object
         ///
@@ -0,0 +1,156 @@
+/// \file multiKMSim.h
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief define the interface of the multi-key-manager simulator: the key-generation
+/// requests are routed to several virtual key managers, each of them keeps its own sketch
+/// \version 0.1
+/// \date 2019-11-07
+///
+/// \copyright Copyright (c) 2019
+///
+
+#ifndef __MULTI_KM_SIM_H__
+#define __MULTI_KM_SIM_H__
+
+#include <list>
+#include <unordered_map>
+
+#include "tecSim.h"
+
+/**the statistics of a virtual key manager */
+typedef struct {
+    /**the number and size of routed chunks (the load) */
+    uint64_t logicalChunks = 0;
+    uint64_t logicalSize = 0;
+    /**the frequency of each plaintext / derived key seen by this manager */
+    spp::sparse_hash_map<std::string, uint64_t> plainFreq;
+    spp::sparse_hash_map<std::string, uint64_t> keyFreq;
+    /**frequency-of-frequency histograms and sum of f * log2(f), for the KLD */
+    std::vector<uint64_t> plainHist;
+    std::vector<uint64_t> keyHist;
+    double plainFreqLogSum = 0;
+    double keyFreqLogSum = 0;
+    /**the number of unique chunks in current sketch window (SEGMENT_ENABLE) */
+    uint64_t windowUniqueChunk = 0;
+} KMStat_t;
+
+class MultiKMSim : public TECSim {
+    protected:
+        friend class SimDriver<MultiKMSim>;
+
+        /**the ciphertext is the AES of fingerprint under the key of {fp || state} */
+        static const int CIPHER_TYPE = CIPHER_AES;
+
+        /**the number of key managers and the routing scheme (ROUTE_*) */
+        uint32_t managerNum_ = 1;
+        int routeScheme_ = ROUTE_FP;
+
+        /**the sketch and the statistics of each key manager */
+        std::vector<CountMinSketch*> sketches_;
+        std::vector<KMStat_t> kmStats_;
+
+        /**the key manager of current chunk */
+        uint32_t currentManager_ = 0;
+
+        /**the total number of routed chunks (for ROUTE_RR) */
+        uint64_t totalRouted_ = 0;
+
+        /**LRU cache of fingerprint -> key manager (for ROUTE_ENHANCE) */
+        std::list<std::pair<std::string, uint32_t> > recordList_;
+        std::unordered_map<std::string,
+            std::list<std::pair<std::string, uint32_t> >::iterator> recordIndex_;
+
+        /// \brief the value of a fingerprint: the sum of its bytes (as keyClient)
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \return uint32_t - the value
+        uint32_t ConvertFpToValue(uint8_t* const chunkFp);
+
+        /// \brief check the load of key managers
+        ///
+        /// \return uint32_t - the least loaded key manager if the deviation exceeds
+        /// KM_DEVIATION_THRESHOLD, otherwise managerNum_
+        uint32_t CheckManagerStatus();
+
+        /// \brief the most loaded key manager
+        ///
+        /// \return uint32_t - the index of key manager
+        uint32_t GetMaxManager();
+
+        /// \brief find a fingerprint in the LRU cache, and move it to the front
+        ///
+        /// \param fp - the fingerprint
+        /// \param manager - the cached key manager <return>
+        /// \return true - it is cached
+        bool GetRecord(std::string const& fp, uint32_t& manager);
+
+        /// \brief put a fingerprint into the LRU cache, evict the least recently used one
+        /// if full
+        ///
+        /// \param fp - the fingerprint
+        /// \param manager - the key manager
+        void PutRecord(std::string const& fp, uint32_t manager);
+
+        /// \brief route a chunk to a key manager by the routing scheme (as
+        /// keyClient::keyAssignment)
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \return uint32_t - the index of key manager
+        uint32_t Route(uint8_t* const chunkFp);
+
+        /// \brief update the frequency of a key in the statistics of a key manager
+        ///
+        /// \param freqTable - the frequency table
+        /// \param hist - the frequency-of-frequency histogram
+        /// \param freqLogSum - sum of f * log2(f)
+        /// \param key - the key
+        void CountManagerKey(spp::sparse_hash_map<std::string, uint64_t>& freqTable,
+            std::vector<uint64_t>& hist, double& freqLogSum, std::string const& key);
+
+        /// \brief the key-derivation policy: route the chunk, then update the frequency
+        /// and derive the key by the sketch of the key manager
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived key <return>
+        void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize, uint8_t* key);
+
+        /// \brief rotate the sketch window of the key manager (SEGMENT_ENABLE)
+        ///
+        void AfterRecord();
+
+        /// \brief print the load balance, blowup and KLD of each key manager
+        ///
+        void PrintManagerStat();
+
+    public:
+        /// \brief Construct a new MultiKMSim object
+        ///
+        /// \param managerNum - the number of key managers
+        /// \param routeScheme - the routing scheme (ROUTE_*)
+        MultiKMSim(uint32_t managerNum, int routeScheme);
+
+        /// \brief Destroy the MultiKMSim object
+        ///
+        ~MultiKMSim();
+
+        /// \brief process an input hash file for encryption
+        ///
+        /// \param inputFileName - the input file name
+        /// \param outputFileName - the output file name
+        void ProcessHashFile(std::string const inputFileName,
+            std::string const outputFileName);
+
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+        ///
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
+        /// \brief print the stat, the frequency files, and the stat of key managers
+        ///
+        /// \param outputFileName - the output file name
+        void PrintResult(std::string const outputFileName);
+};
+
+#endif // !__MULTI_KM_SIM_H__
@@ -0,0 +1,124 @@
+/// \file outputSink.h
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief define the interface of buffered output sink with a writer thread
+/// \version 0.1
+/// \date 2019-11-01
+///
+/// \copyright Copyright (c) 2019
+///
+#ifndef __OUTPUT_SINK_H__
+#define __OUTPUT_SINK_H__
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "define.h"
+
+/**the max length of a key in one record */
+#define OUTPUT_MAX_KEY_LEN (255)
+
+class OutputSink {
+    private:
+        /**the output file, not owned by the sink */
+        FILE* fp_;
+
+        /**write binary records instead of text */
+        bool binary_;
+
+        /**double buffering: the producer fills one buffer while the writer thread
+         * writes the other one */
+        char* buffer_[2];
+        int active_ = 0;
+        size_t len_ = 0;
+
+        /**the buffer handed to the writer thread (NULL: the writer is idle) */
+        char* pending_ = NULL;
+        size_t pendingLen_ = 0;
+
+        /**the writer thread */
+        std::thread writerThread_;
+        std::mutex mtx_;
+        std::condition_variable cond_;
+        bool stop_ = false;
+        bool isClosed_ = false;
+
+        /// \brief the main loop of writer thread
+        ///
+        void WriteThread();
+
+        /// \brief hand the active buffer to the writer thread (wait if it is busy)
+        ///
+        void Submit();
+
+        /// \brief make sure the active buffer has enough free space
+        ///
+        /// \param len - the length to append
+        inline void Reserve(size_t len) {
+            if (len_ + len > OUTPUT_BUFFER_SIZE) {
+                Submit();
+            }
+        }
+
+        /// \brief append the hex of bytes separated by ':' (e.g., 3f:60:bf)
+        ///
+        /// \param data - the bytes
+        /// \param len - the number of bytes
+        void AppendHex(const uint8_t* data, size_t len);
+
+        /// \brief append a decimal number
+        ///
+        /// \param value - the number
+        void AppendUInt(uint64_t value);
+
+        /// \brief append a string
+        ///
+        /// \param str - the string
+        /// \param len - the length of string
+        inline void AppendStr(const char* str, size_t len) {
+            memcpy(buffer_[active_] + len_, str, len);
+            len_ += len;
+        }
+
+    public:
+        /// \brief Construct a new Output Sink object and start the writer thread
+        ///
+        /// \param fp - the output file
+        /// \param binary - write binary records instead of text
+        OutputSink(FILE* fp, bool binary = OUTPUT_BINARY_ENABLE);
+
+        /// \brief Destroy the Output Sink object
+        ///
+        ~OutputSink();
+
+        /// \brief Get the output file
+        ///
+        /// \return FILE* - the output file
+        inline FILE* GetFile() { return fp_; }
+
+        /// \brief write a record of ciphertext
+        /// text: hex-key\t\tsize\t\t10, binary: [1-byte key length][key][8-byte size]
+        ///
+        /// \param key - the printed ciphertext
+        /// \param keyLen - the length of printed ciphertext
+        /// \param chunkSize - the chunk size
+        void WriteCipher(const uint8_t* key, size_t keyLen, uint64_t chunkSize);
+
+        /// \brief write a record of frequency
+        /// text: hex-key\t\tcount, binary: [1-byte key length][key][8-byte count]
+        ///
+        /// \param key - the fingerprint
+        /// \param keyLen - the length of fingerprint
+        /// \param count - the frequency
+        void WriteFreq(const uint8_t* key, size_t keyLen, uint64_t count);
+
+        /// \brief flush the buffers and stop the writer thread (the file is not closed)
+        ///
+        void Close();
+};
+
+#endif // !__OUTPUT_SINK_H__
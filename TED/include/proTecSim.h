@@ -14,6 +14,22 @@
 
 class ProTECSim : public TECSim {
     protected:
+        friend class SimDriver<ProTECSim>;
+
+        /**the ciphertext is the fingerprint + the state */
+        static const int CIPHER_TYPE = CIPHER_STATE;
+
+        /// \brief the key-derivation policy: update the frequency, then derive the state
+        /// probabilistically
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived state <return>
+        inline void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize,
+            uint8_t* key) {
+            TECUpdateState(chunkFp, FP_SIZE + 1, chunkSize);
+            ProKeyGen(chunkFp, FP_SIZE + 1, chunkSize, key);
+        }
 
         /// \brief key generation process
         ///
@@ -34,7 +50,11 @@ class ProTECSim : public TECSim {
 
         /// \brief Construct a new Pro TECSim object
         ///
-        ProTECSim() { fprintf(stderr, "Initialize Probabilistic Tunable Encryption Simulator.\n");}
+        ProTECSim() {
+            fprintf(stderr, "Initialize Probabilistic Tunable Encryption Simulator.\n");
+            /**the ciphertext is the fingerprint + 4-byte state */
+            cipherFpLen_ = FP_SIZE + sizeof(int);
+        }
 
         /// \brief Destroy the ProTECSim object
         ///
@@ -57,6 +77,13 @@ class ProTECSim : public TECSim {
         void ProcessHashFile(std::string const inputFileName, 
             std::string const outputFileName);
 
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+        ///
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
 };
 
 
@@ -24,13 +24,51 @@
 #include <string.h>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "cryptoPrimitive.h"
 #include "define.h"
+#include "extCounter.h"
+#include "hyperLogLog.h"
 #include "leveldb/db.h"
+#include "murmurHash3.h"
+#include "outputSink.h"
+#include "spaceSaving.h"
+#include "traceReader.h"
+
+/**the statistics of a simulation, index 0: plaintext, 1: ciphertext */
+typedef struct {
+    uint64_t logicalChunks[2];
+    uint64_t uniqueChunks[2];
+    uint64_t logicalSize[2];
+    uint64_t uniqueSize[2];
+} SimStat_t;
+
+/**the partial statistics of a partition worker, merged by TEDMerge */
+typedef struct {
+    uint32_t partitionIndex;
+    uint32_t partitionNum;
+    SimStat_t stat;
+} PartialStat_t;
+
+/**the form of ciphertext produced by a key-derivation policy (see SimDriver) */
+#define CIPHER_AES 0 /**AES of the fingerprint under a 32-byte key, FP_SIZE bytes */
+#define CIPHER_STATE 1 /**the fingerprint + a 4-byte state, FP_SIZE + sizeof(int) bytes */
+
+/**the max length of derived key */
+#define DERIVED_KEY_SIZE (32)
+
+template <class Policy> class SimDriver;
 
 class Simulator {
 protected:
+    /**the driver runs the per-chunk path of each policy */
+    template <class Policy> friend class SimDriver;
+
+    /// \brief the hook after the ciphertext of a chunk is counted (a policy may hide it)
+    ///
+    inline void AfterRecord() {};
+
     /// \brief count statistic information by leveldb
     ///
     /// \param name - the db file of leveldb
@@ -44,6 +82,37 @@ protected:
     leveldb::DB* mdb_ = NULL;
     leveldb::DB* cdb_ = NULL;
 
+    /**external-memory counters (used when EXTERNAL_COUNT_ENABLE is set) */
+    ExtCounter* mExtCounter_ = NULL;
+    ExtCounter* cExtCounter_ = NULL;
+
+    /**cardinality estimators (used when HLL_COUNT_ENABLE is set) */
+    HyperLogLog* mHLL_ = NULL;
+    HyperLogLog* cHLL_ = NULL;
+
+    /**the cumulative HyperLogLog state across backups (set by SetCumulativeState) */
+    std::string hllStateName_;
+
+    /**frequency-of-frequency histograms: hist[f] is the number of unique chunks of frequency f */
+    std::vector<uint64_t> mFreqHist_;
+    std::vector<uint64_t> cFreqHist_;
+
+    /**sum of f * log2(f) over unique chunks, for the streaming KLD */
+    double mFreqLogSum_ = 0;
+    double cFreqLogSum_ = 0;
+
+    /**the output of time series (set by SetTimeSeriesOutput) */
+    std::string timeSeriesName_;
+    FILE* timeSeriesFp_ = NULL;
+    uint64_t lastEmitChunks_ = 0;
+
+    /**the buffered sink of ciphertext output (bound to the file of PrintCipher) */
+    OutputSink* cipherSink_ = NULL;
+
+    /**heavy-hitter trackers (created by InitHeavyHitter when HEAVY_HITTER_ENABLE is set) */
+    SpaceSaving* mHeavyHitter_ = NULL;
+    SpaceSaving* cHeavyHitter_ = NULL;
+
     /**variables for the number of logical chunks*/
     uint64_t mLogicalChunks_ = 0UL;
     uint64_t cLogicalChunks_ = 0UL;
@@ -60,9 +129,100 @@ protected:
     uint64_t mUniqueSize_ = 0UL;
     uint64_t cUniqueSize_ = 0UL;
 
+    /**the printed length of ciphertext fingerprint */
+    size_t cipherFpLen_ = FP_SIZE;
+
     /**tmp chunk size*/
     uint64_t chunkSize_ = 0UL;
 
+    /**the sampling rate and the corresponding bound of 32-bit hash value */
+    double samplingRate_ = SAMPLING_RATE;
+    uint64_t samplingBound_ = 0UL;
+
+    /**sum of squares for the variance in sampling estimation:
+     * freq: sum(f^2), freqSize: sum((f * s)^2), size: sum(s^2) of unique chunks
+     */
+    double mFreqSquare_ = 0;
+    double cFreqSquare_ = 0;
+    double mFreqSizeSquare_ = 0;
+    double cFreqSizeSquare_ = 0;
+    double mSizeSquare_ = 0;
+    double cSizeSquare_ = 0;
+
+    /// \brief check whether a fingerprint is kept by the consistent sampling
+    ///
+    /// \param chunkHash - the chunk fingerprint
+    /// \param chunkHashLen - the length of fingerprint
+    /// \return true - it is sampled
+    /// \return false - it is dropped
+    bool IsSampled(uint8_t* const chunkHash, size_t chunkHashLen);
+
+    /**the partition of this worker: only the fingerprints with
+     * hash % partitionNum_ == partitionIndex_ are simulated */
+    uint32_t partitionIndex_ = 0;
+    uint32_t partitionNum_ = 1;
+
+    /// \brief check whether a fingerprint is in the hash range of this partition
+    ///
+    /// \param chunkHash - the chunk fingerprint
+    /// \param chunkHashLen - the length of fingerprint
+    /// \return true - it is in this partition
+    /// \return false - it belongs to another partition
+    bool IsInPartition(uint8_t* const chunkHash, size_t chunkHashLen);
+
+    /// \brief check whether a fingerprint is simulated (by sampling and partition)
+    ///
+    /// \param chunkFp - the chunk fingerprint (FP_SIZE)
+    /// \return true - it is simulated
+    inline bool IsSelected(uint8_t* const chunkFp) {
+        /**consistent sampling: all duplicates are kept or dropped together */
+        if (SAMPLING_ENABLE && !IsSampled(chunkFp, FP_SIZE)) {
+            return false;
+        }
+        return partitionNum_ == 1 || IsInPartition(chunkFp, FP_SIZE);
+    }
+
+    /// \brief print the mergeable partial statistics of this partition
+    ///
+    /// \param fileName - the output file name, goes to <fileName>.part
+    void PrintPartialStat(std::string const fileName);
+
+    /// \brief print the scaled estimation with confidence bounds
+    ///
+    /// \param name - the name of the statistic
+    /// \param sampleValue - the value in the sample
+    /// \param squareSum - the sum of squares of per-key contributions
+    void PrintEstimation(const char* name, double sampleValue, double squareSum);
+
+    /// \brief merge this backup into the cumulative HyperLogLog state and print it
+    ///
+    void PrintCumulativeEstimation();
+
+    /// \brief update the frequency-of-frequency histogram after a key reaches a new count
+    ///
+    /// \param hist - the histogram
+    /// \param freqLogSum - sum of f * log2(f)
+    /// \param count - the new count of the key
+    void UpdateFreqHist(std::vector<uint64_t>& hist, double& freqLogSum, uint64_t const count);
+
+    /// \brief compute KLD to the uniform distribution: log2(U) - H
+    ///
+    /// \param uniqueNum - the number of unique chunks
+    /// \param logicalNum - the number of logical chunks
+    /// \param freqLogSum - sum of f * log2(f)
+    /// \return double - the KL divergence
+    double CalKLD(uint64_t uniqueNum, uint64_t logicalNum, double freqLogSum);
+
+    /// \brief append a row of the current KLD, blowup and unique counts to the time series
+    ///
+    void EmitTimeSeries();
+
+    /// \brief print the frequency-of-frequency histogram
+    ///
+    /// \param fileName - the output file name
+    /// \param hist - the histogram
+    void PrintFreqHist(std::string const fileName, std::vector<uint64_t>& hist);
+
     /// \brief pseudo encryption via hashing the (fingerprint + key)
     ///
     /// \param msg - input fingerprint
@@ -90,6 +250,18 @@ protected:
     void PrintChunkFreq(std::string const fileName, size_t FpLength,
         bool const flag);
 
+    /// \brief create the heavy-hitter trackers, updated in CountChunk
+    ///
+    void InitHeavyHitter();
+
+    /// \brief print the top-k chunks with error bounds
+    ///
+    /// \param fileName - the output file name
+    /// \param FpLength - the length of message
+    /// \param flag - 0: original backup 1: encrypted backup
+    void PrintHeavyHitter(std::string const fileName, size_t FpLength,
+        bool const flag);
+
     /// \brief print cipher chunk info
     ///
     /// \param plaintext - plaintext
@@ -138,9 +310,85 @@ public:
     /// \param flag - 0:plaintext, 1:ciphertext
     void PrintBackupStat();
 
+    /// \brief Set the output of time series, must be called before processing
+    ///
+    /// \param fileName - the output file name, the time series goes to <fileName>.series.csv
+    void SetTimeSeriesOutput(std::string const fileName);
+
+    /// \brief Set the file of cumulative HyperLogLog state, each backup is merged into it
+    /// (HLL_COUNT_ENABLE), must be called before processing
+    ///
+    /// \param fileName - the state file, removed to restart the cumulative estimation
+    void SetCumulativeState(std::string const fileName);
+
+    /// \brief open the output of ciphertext, printed via a buffered sink
+    ///
+    /// \param fileName - the output file name
+    /// \return FILE* - the output file (NULL: fail)
+    FILE* OpenCipherOutput(std::string const fileName);
+
+    /// \brief flush the buffered ciphertext and close the output
+    ///
+    /// \param fpOut - the output file
+    void CloseCipherOutput(FILE* fpOut);
+
+    /// \brief print the statistics, and the storage saving and loss ratios
+    ///
+    /// \param stat - the statistics
+    static void PrintStat(SimStat_t const& stat);
+
+    /// \brief Set the partition of this worker, must be called before processing
+    ///
+    /// \param partitionIndex - the index of this partition, [0, partitionNum)
+    /// \param partitionNum - the number of partitions (1: disable)
+    void SetPartition(uint32_t partitionIndex, uint32_t partitionNum);
+
+    /// \brief Set the sampling rate (used when SAMPLING_ENABLE is set)
+    ///
+    /// \param samplingRate - the fraction of fingerprints kept, (0, 1]
+    void SetSamplingRate(double samplingRate);
+
     virtual void ProcessHashFile(std::string const inputFileName,
         std::string const outputFileName)
         = 0;
+
+    /// \brief feed a parsed fingerprint record: apply the sampling and partition, then
+    /// process it
+    ///
+    /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+    /// \param chunkSize - the chunk size
+    /// \param fpOut - the output of ciphertext (NULL: not print)
+    void FeedRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
+    /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+    ///
+    /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+    /// \param chunkSize - the chunk size
+    /// \param fpOut - the output of ciphertext (NULL: not print)
+    virtual void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
+    /// \brief process the pending records at the end of the stream
+    ///
+    /// \param fpOut - the output of ciphertext (NULL: not print)
+    virtual void FlushRecords(FILE* fpOut) {};
+
+    /// \brief print the stat, and the frequency and heavy-hitter files
+    ///
+    /// \param outputFileName - the output file name
+    virtual void PrintResult(std::string const outputFileName);
+
+    /// \brief Get the statistics (the unique stat of external/HyperLogLog counting is
+    /// only ready after PrintBackupStat)
+    ///
+    /// \param stat - the statistics <return>
+    void GetStat(SimStat_t& stat);
+
+    /// \brief Get a snapshot of the chunk frequencies (leveldb counting only)
+    ///
+    /// \param flag - 0: original backup 1: encrypted backup
+    /// \param freqList - the list of (fingerprint, frequency) <return>
+    void GetFreqSnapshot(bool const flag,
+        std::vector<std::pair<std::string, uint64_t> >& freqList);
 };
 
 #endif // !__
@@ -0,0 +1,132 @@
+/// \file simDriver.h
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief define the simulation driver shared by simulators, templated on the
+/// key-derivation policy
+/// \version 0.1
+/// \date 2019-11-03
+///
+/// \copyright Copyright (c) 2019
+///
+#ifndef __SIM_DRIVER_H__
+#define __SIM_DRIVER_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "define.h"
+#include "sim.h"
+#include "traceReader.h"
+
+/// the policy is the simulator class itself. ProcessHashFile calls its ProcessRecord and
+/// FlushRecords statically; a per-chunk policy forwards ProcessRecord to the driver, and
+/// provides (as a friend of the driver):
+///   static const int CIPHER_TYPE - CIPHER_AES or CIPHER_STATE
+///   void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize, uint8_t* key)
+///       - update the policy state by the chunk, and derive its key
+///   void AfterRecord() - (optional) the hook after the ciphertext is counted
+/// a policy deciding the key of a whole segment (e.g., MinHashSim) overrides ProcessRecord
+/// and FlushRecords instead.
+template <class Policy>
+class SimDriver {
+    public:
+        /// \brief parse the input trace, apply the sampling and partition, and hand
+        /// each record to a handler
+        ///
+        /// \param sim - the simulator
+        /// \param inputFileName - the input file name
+        /// \param handle - the handler of (chunkFp, chunkSize)
+        template <class Handler>
+        static void ReadTrace(Policy& sim, std::string const inputFileName,
+            Handler handle) {
+            uint8_t chunkFp[FP_SIZE + 1];
+            memset(chunkFp, 0, FP_SIZE + 1);
+            uint64_t size = 0;
+
+            TraceReader traceReader;
+            if (traceReader.Open(inputFileName)) {
+                fprintf(stderr, "Open data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+            } else {
+                fprintf(stderr, "Open data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+                exit(1);
+            }
+
+            /**simulate the data stream come from here (text trace or hashfile) */
+            while (traceReader.ReadRecord(chunkFp, FP_SIZE, size)) {
+                /**consistent sampling and partition: all duplicates go together */
+                if (!sim.IsSelected(chunkFp)) {
+                    continue;
+                }
+                handle(chunkFp, size);
+            }
+            traceReader.Close();
+        }
+
+        /// \brief process an input hash file: parse, simulate, and print the results
+        ///
+        /// \param sim - the simulator
+        /// \param inputFileName - the input file name
+        /// \param outputFileName - the output file name
+        static void ProcessHashFile(Policy& sim, std::string const inputFileName,
+            std::string const outputFileName) {
+            FILE* fpOut = sim.OpenCipherOutput(outputFileName);
+
+            /**the qualified calls bind to the policy statically (no virtual dispatch) */
+            ReadTrace(sim, inputFileName, [&](uint8_t* const chunkFp, uint64_t const size) {
+                sim.Policy::ProcessRecord(chunkFp, size, fpOut);
+            });
+            sim.Policy::FlushRecords(fpOut);
+            sim.CloseCipherOutput(fpOut);
+
+            /**print out the stat and frequency information */
+            sim.PrintResult(outputFileName);
+        }
+
+        /// \brief the per-chunk path: count, derive the key, encrypt, count, and print
+        ///
+        /// \param sim - the simulator
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        static inline void ProcessRecord(Policy& sim, uint8_t* const chunkFp,
+            uint64_t const chunkSize, FILE* fpOut) {
+            /**count the chunk information in global leveldb */
+            sim.CountChunk(chunkFp, FP_SIZE + 1, chunkSize, 0);
+
+            /**key generation */
+            uint8_t key[DERIVED_KEY_SIZE];
+            sim.DeriveKey(chunkFp, chunkSize, key);
+
+            /**encryption (simulation) */
+            uint8_t cipher[FP_SIZE + sizeof(int) + 1];
+            size_t cipherLen = 0;
+            if (Policy::CIPHER_TYPE == CIPHER_STATE) {
+                /**directly append the state to the end of hash */
+                memcpy(cipher, chunkFp, FP_SIZE);
+                memcpy(cipher + FP_SIZE, key, sizeof(int));
+                cipherLen = FP_SIZE + sizeof(int);
+            } else {
+                uint8_t alignedCipher[16] = {0};
+                uint8_t alignedChunkFp[16] = {0};
+                memcpy(alignedChunkFp, chunkFp, FP_SIZE);
+                sim.cryptoObj_->encryptWithKey(alignedChunkFp, 16, key, alignedCipher);
+                memcpy(cipher, alignedCipher, FP_SIZE);
+                cipherLen = FP_SIZE;
+            }
+            cipher[cipherLen] = '\0';
+
+            /**count the encrypted chunk */
+            sim.CountChunk(cipher, cipherLen + 1, chunkSize, 1);
+
+            sim.AfterRecord();
+
+            /**print the message ciphertext */
+            if (fpOut != NULL) {
+                sim.PrintCipher(chunkFp, FP_SIZE, cipher, cipherLen, chunkSize, fpOut);
+            }
+        }
+};
+
+#endif // !__SIM_DRIVER_H__
@@ -24,6 +24,22 @@ class SKESim : public Simulator {
         /**random key seed */
         int keySeed_;
 
+        friend class SimDriver<SKESim>;
+
+        /**the ciphertext is the AES of fingerprint under a random key */
+        static const int CIPHER_TYPE = CIPHER_AES;
+
+        /// \brief the key-derivation policy: a fresh random key for each chunk
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived key <return>
+        inline void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize,
+            uint8_t* key) {
+            SKEKeyGen();
+            memcpy(key, encryptKey_, 32);
+        }
+
     public:
         /// \brief Construct a new SKESim object
         ///
@@ -33,6 +49,8 @@ class SKESim : public Simulator {
             encryptKey_ = (uint8_t*) malloc(32 * sizeof(uint8_t));
             memset(encryptKey_, 0, 32 * sizeof(uint8_t));
             keySeed_ = 0;
+            /**for random key generation */
+            srand(time(NULL));
         }
 
         /// \brief Generate random encryption key (SKE)
@@ -52,6 +70,13 @@ class SKESim : public Simulator {
         /// \param outputFileName - the output file name 
         void ProcessHashFile(std::string const inputFileName,
             std::string const outputFileName);
+
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+        ///
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
 };
 
 
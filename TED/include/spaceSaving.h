@@ -0,0 +1,98 @@
+/// \file spaceSaving.h
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief define the interface of SpaceSaving heavy-hitter tracker
+/// \version 0.1
+/// \date 2019-10-25
+///
+/// \copyright Copyright (c) 2019
+///
+#ifndef __SPACE_SAVING_H__
+#define __SPACE_SAVING_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "define.h"
+
+/**a monitored key: the true frequency is in [count - error, count] */
+typedef struct {
+    std::string key;
+    uint64_t count;
+    uint64_t error;
+} HeavyHitter_t;
+
+class SpaceSaving {
+    private:
+        /**the max number of monitored keys */
+        size_t capacity_;
+
+        /**the total number of updates */
+        uint64_t total_ = 0;
+
+        /**the monitored keys */
+        std::vector<HeavyHitter_t> entries_;
+
+        /**min-heap of entry index on count, and the heap position of each entry */
+        std::vector<uint32_t> heap_;
+        std::vector<uint32_t> heapPos_;
+
+        /**key -> entry index */
+        std::unordered_map<std::string, uint32_t> keyIndex_;
+
+        /// \brief move a heap node down after its count increases
+        ///
+        /// \param pos - the position in heap
+        void SiftDown(size_t pos);
+
+        /// \brief move a heap node up after insertion
+        ///
+        /// \param pos - the position in heap
+        void SiftUp(size_t pos);
+
+        /// \brief swap two heap nodes
+        ///
+        /// \param a - the position of first node
+        /// \param b - the position of second node
+        void Swap(size_t a, size_t b);
+
+    public:
+        /// \brief Construct a new Space Saving object
+        ///
+        /// \param capacity - the max number of monitored keys
+        SpaceSaving(size_t capacity);
+
+        /// \brief Destroy the Space Saving object
+        ///
+        ~SpaceSaving() {};
+
+        /// \brief update a key by one
+        ///
+        /// \param key - the key buffer
+        /// \param keyLen - the length of key
+        void Update(uint8_t* const key, size_t keyLen);
+
+        /// \brief Get the max overestimation of any monitored key
+        ///
+        /// \return uint64_t - the min count if full (<= total / capacity), otherwise 0
+        uint64_t GetMaxError();
+
+        /// \brief Get the top-k keys in the descending order of count
+        ///
+        /// \param k - the number of keys
+        /// \param topK - the result list <return>
+        void GetTopK(size_t k, std::vector<HeavyHitter_t>& topK);
+
+        /// \brief print the top-k keys with their error bounds
+        ///
+        /// \param fp - the output file
+        /// \param k - the number of keys
+        /// \param FpLength - the length of key to print
+        void PrintTopK(FILE* fp, size_t k, size_t FpLength);
+};
+
+#endif // !__SPACE_SAVING_H__
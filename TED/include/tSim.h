@@ -15,6 +15,22 @@
 
 class TSim : public TECSim {
     private:
+        friend class SimDriver<TSim>;
+
+        /**the ciphertext is the fingerprint + the state */
+        static const int CIPHER_TYPE = CIPHER_STATE;
+
+        /// \brief the key-derivation policy: update the frequency, then derive the state
+        /// capped by the threshold base
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived state <return>
+        inline void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize,
+            uint8_t* key) {
+            TECUpdateState(chunkFp, FP_SIZE + 1, chunkSize);
+            ThresholdKeyGen(chunkFp, FP_SIZE + 1, chunkSize, key);
+        }
 
         /// \brief threshold key generation process
         ///
@@ -32,7 +48,11 @@ class TSim : public TECSim {
 
         /// \brief Construct a new TSim object
         ///
-        TSim() { fprintf(stderr, "Initialize Threshold-based Encryption Simulator.\n"); }
+        TSim() {
+            fprintf(stderr, "Initialize Threshold-based Encryption Simulator.\n");
+            /**the ciphertext is the fingerprint + 4-byte state */
+            cipherFpLen_ = FP_SIZE + sizeof(int);
+        }
 
         /// \brief Destroy the TSim object
         ///
@@ -52,5 +72,12 @@ class TSim : public TECSim {
         void ProcessHashFile(std::string const inputFileName, 
             std::string const outputFileName);
 
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+        ///
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
+
 };
 #endif // !__T_SIM_H__
\ No newline at end of file
@@ -18,7 +18,11 @@
 
 class TECSim : public Simulator {
     protected:
-        
+        friend class SimDriver<TECSim>;
+
+        /**the ciphertext is the AES of fingerprint under the key of {fp || state} */
+        static const int CIPHER_TYPE = CIPHER_AES;
+
         /// \brief key generation process
         ///
         /// \param chunkHash - chunk hash
@@ -35,6 +39,21 @@ class TECSim : public Simulator {
         /// \param chunkSize - chunk size
         void TECUpdateState(uint8_t* const chunkHash, size_t chunkHashLen, uint64_t const chunkSize);
 
+        /// \brief the key-derivation policy: update the frequency, then derive the key
+        ///
+        /// \param chunkFp - the chunk fingerprint
+        /// \param chunkSize - the chunk size
+        /// \param key - the derived key <return>
+        inline void DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize,
+            uint8_t* key) {
+            TECUpdateState(chunkFp, FP_SIZE + 1, chunkSize);
+            KeyGen(chunkFp, FP_SIZE + 1, chunkSize, key);
+        }
+
+        /// \brief rotate the sketch window after enough unique chunks (SEGMENT_ENABLE)
+        ///
+        void AfterRecord();
+
         /// \brief simulate the encryption process: directly append the (frequency / T) to the 
         /// end of hash
         ///
@@ -68,7 +87,11 @@ class TECSim : public Simulator {
         ///
         TECSim() { 
             fprintf(stderr, "Initialize Tunable Encryption Simulator.\n");
-            cmSketch_ = new CountMinSketch(SKETCH_WIDTH, SKETCH_DEPTH);
+            /**with SEGMENT_ENABLE, the sketch keeps a sliding window of sub-sketches */
+            cmSketch_ = new CountMinSketch(SKETCH_WIDTH, SKETCH_DEPTH,
+                SEGMENT_ENABLE ? SKETCH_WINDOW_NUM : 1);
+            /**the heavy hitters are tracked alongside the sketch */
+            InitHeavyHitter();
         }
 
         /// \brief Destroy the TECSim object
@@ -85,7 +108,14 @@ class TECSim : public Simulator {
         /// \param inputFileName - the input file name
         /// \param outputFileName - the output file name
         void ProcessHashFile(std::string const inputFileName, 
-          std::string const outputFileName); 
+          std::string const outputFileName);
+
+        /// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+        ///
+        /// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+        /// \param chunkSize - the chunk size
+        /// \param fpOut - the output of ciphertext (NULL: not print)
+        void ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut);
         
         /// \brief enable probalistic key generation
         ///
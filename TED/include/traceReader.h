@@ -0,0 +1,177 @@
+/// \file traceReader.h
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief define the interface of trace reader (plain/gzip/zstd) with a reader thread
+/// \version 0.1
+/// \date 2019-10-23
+///
+/// \copyright Copyright (c) 2019
+///
+#ifndef __TRACE_READER_H__
+#define __TRACE_READER_H__
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+#include "define.h"
+
+/**the format of the input trace */
+#define TRACE_PLAIN 0
+#define TRACE_GZIP 1
+#define TRACE_ZSTD 2
+
+/**the FSL hashfile of fs-hasher (libhashfile version 7, little endian), read
+ * directly instead of the text converted by hf-stat:
+ * header: magic(4) version(4) root path(4096) system id(4096) files(8) chunks(8)
+ *     bytes(8) start/end time(16) chunking method(4) chunking params(20)
+ *     hashing method(4) hash size(4) compression method(4) compression level(4)
+ * each file: file size(8) chunks(8) path length(4) path, metadata (uid, gid, perm,
+ *     atime, mtime, ctime, hard links, device id, inode), then the chunks
+ * each chunk: size(8) compression ratio(1) hash(hash size)
+ */
+#define HASHFILE_MAGIC (0x8D1FC39E)
+#define HASHFILE_VERSION (7)
+#define HASHFILE_HEADER_SIZE (8280)
+#define HASHFILE_HEADER_FILES_OFFSET (8200) /**files, chunks, bytes */
+#define HASHFILE_HEADER_HASH_SIZE_OFFSET (8268)
+#define HASHFILE_FILE_HEADER_SIZE (20) /**file size, chunks, path length */
+#define HASHFILE_FILE_META_SIZE (64)
+#define HASHFILE_CHUNK_HEADER_SIZE (9) /**size, compression ratio */
+#define HASHFILE_MAX_HASH_SIZE (64)
+
+/**a block of decompressed trace data */
+typedef struct {
+    char* data;
+    size_t len;
+} TraceBlock_t;
+
+class TraceReader {
+    private:
+        /**the input file name */
+        std::string fileName_;
+
+        /**the format of input file */
+        int format_ = TRACE_PLAIN;
+
+        /**the reader thread which reads and decompresses the input */
+        std::thread readerThread_;
+
+        /**the blocks filled by the reader thread, and the free blocks */
+        std::queue<TraceBlock_t*> fullQueue_;
+        std::queue<TraceBlock_t*> freeQueue_;
+        std::mutex queueMtx_;
+        std::condition_variable notEmpty_;
+        std::condition_variable notFull_;
+
+        /**the reader thread reaches the end of file */
+        bool readDone_ = false;
+
+        /**ask the reader thread to exit */
+        bool stop_ = false;
+
+        /**the block consumed by ReadLine */
+        TraceBlock_t* current_ = NULL;
+        size_t currentPos_ = 0;
+
+        /**whether the reader is open */
+        bool isOpen_ = false;
+
+        /**whether the (decompressed) content is checked to be a hashfile */
+        bool isContentChecked_ = false;
+        bool isHashFile_ = false;
+
+        /**the hash size of hashfile, and the remaining chunks of the current file */
+        uint32_t hashSize_ = 0;
+        uint64_t fileChunks_ = 0;
+
+        /// \brief check whether the content is a hashfile via the magic, and read
+        /// its header
+        ///
+        void CheckContent();
+
+        /// \brief read bytes from the blocks
+        ///
+        /// \param buffer - the output buffer (NULL: skip the bytes)
+        /// \param len - the number of bytes
+        /// \return size_t - the number of read bytes, less than len at the end of file
+        size_t ReadBytes(uint8_t* buffer, size_t len);
+
+        /// \brief read a line, the same semantic of fgets
+        ///
+        /// \param buffer - the line buffer
+        /// \param size - the size of line buffer
+        /// \return char* - the buffer, NULL if the end of file
+        char* ReadLine(char* buffer, int size);
+
+        /// \brief read a chunk record of hashfile
+        ///
+        /// \param chunkFp - the chunk fingerprint <return>
+        /// \param fpLen - the length of fingerprint
+        /// \param chunkSize - the chunk size <return>
+        /// \return true - success
+        /// \return false - the end of file
+        bool ReadHashFileRecord(uint8_t* chunkFp, size_t fpLen, uint64_t& chunkSize);
+
+        /// \brief detect the format of the input via the magic number
+        ///
+        /// \return int - the format
+        int DetectFormat();
+
+        /// \brief the main loop of reader thread
+        ///
+        void ReadThread();
+
+        /// \brief get a free block (wait if none), return NULL if stopped
+        ///
+        /// \return TraceBlock_t* - the free block
+        TraceBlock_t* GetFreeBlock();
+
+        /// \brief hand a filled block to the consumer
+        ///
+        /// \param block - the filled block
+        void PutFullBlock(TraceBlock_t* block);
+
+        /// \brief switch to the next filled block
+        ///
+        /// \return true - there is a new block
+        /// \return false - the end of file
+        bool NextBlock();
+
+    public:
+        /// \brief Construct a new Trace Reader object
+        ///
+        TraceReader() {};
+
+        /// \brief Destroy the Trace Reader object
+        ///
+        ~TraceReader();
+
+        /// \brief open the input file and start the reader thread
+        ///
+        /// \param fileName - the input file name
+        /// \return true - success
+        /// \return false - fail
+        bool Open(std::string const fileName);
+
+        /// \brief read a chunk record (fingerprint and size) from the text trace or
+        /// the hashfile
+        ///
+        /// \param chunkFp - the chunk fingerprint (fpLen + 1, ends with '\0') <return>
+        /// \param fpLen - the length of fingerprint
+        /// \param chunkSize - the chunk size <return>
+        /// \return true - success
+        /// \return false - the end of file
+        bool ReadRecord(uint8_t* chunkFp, size_t fpLen, uint64_t& chunkSize);
+
+        /// \brief stop the reader thread and close the input
+        ///
+        void Close();
+};
+
+#endif // !__TRACE_READER_H__
@@ -0,0 +1,37 @@
+#!/bin/bash
+# check the hashfile parser of TraceReader with the fixture inFileExample.hashfile: 4 files
+# (one is empty) of the chunks in inFileExample, the first 50 chunks are in two files
+# usage: ./script/checkHashfile.sh [TEDSim] (run in TED/ after ./script/setup.sh)
+TEDSIM=$(readlink -f ${1:-./bin/TEDSim})
+FIXTURE=$(readlink -f ./inFileExample.hashfile)
+
+WORK_DIR=$(mktemp -d)
+cd ${WORK_DIR}
+${TEDSIM} ${FIXTURE} out mle > stat 2> log
+STATUS=$?
+cd - > /dev/null
+
+FAIL=0
+if [ ${STATUS} -ne 0 ]; then
+    echo "TEDSim fails: ${STATUS}"
+    cat ${WORK_DIR}/log
+    FAIL=1
+fi
+check() {
+    VALUE=$(grep "^$1: " ${WORK_DIR}/stat | head -n 1 | awk -F': ' '{print $2}')
+    if [ "${VALUE}" != "$2" ]; then
+        echo "$1: ${VALUE}, expect $2"
+        FAIL=1
+    fi
+}
+check "Logical original chunks number" 334
+check "Unique original chunks number" 284
+check "Logical encrypted chunks size" 2386482
+check "Unique encrypted chunks size" 1942167
+rm -rf ${WORK_DIR}
+
+if [ ${FAIL} -ne 0 ]; then
+    echo "hashfile check fails"
+    exit 1
+fi
+echo "hashfile check passes"
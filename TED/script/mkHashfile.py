@@ -0,0 +1,51 @@
+# build a hashfile (fs-hasher libhashfile version 7) from a text trace, the layout is the
+# one TraceReader reads (include/traceReader.h)
+# usage: python3 mkHashfile.py [text trace] [hashfile] [hash size] [file ranges, e.g., 0-100,100-100]
+import struct
+import sys
+
+HASHFILE_MAGIC = 0x8D1FC39E
+HASHFILE_VERSION = 7
+PATH_SIZE = 4096
+
+TraceFile = sys.argv[1]
+HashFile = sys.argv[2]
+HashSize = int(sys.argv[3])
+Records = []
+for Line in open(TraceFile, "r"):
+    Items = Line.split()
+    if len(Items) < 2:
+        continue
+    Fp = bytes(int(x, 16) for x in Items[0].split(":"))
+    Records.append((Fp[:HashSize].ljust(HashSize, b"\0"), int(Items[1])))
+
+# each file takes a range of the records, a record may be in several files
+Files = []
+if len(sys.argv) > 4:
+    for Range in sys.argv[4].split(","):
+        Start, End = Range.split("-")
+        Files.append(Records[int(Start):int(End)])
+else:
+    Files.append(Records)
+
+Chunks = sum(len(File) for File in Files)
+Bytes = sum(Size for File in Files for (_, Size) in File)
+Out = open(HashFile, "wb")
+# magic, version, root path, system id
+Out.write(struct.pack("<II", HASHFILE_MAGIC, HASHFILE_VERSION))
+Out.write(b"/".ljust(PATH_SIZE, b"\0") + b"ted".ljust(PATH_SIZE, b"\0"))
+# files, chunks, bytes, start/end time
+Out.write(struct.pack("<QQQqq", len(Files), Chunks, Bytes, 0, 0))
+# chunking method (variable) and its params, hashing method (sha256), hash size,
+# compression method and level
+Out.write(struct.pack("<I", 2) + b"\0" * 20 + struct.pack("<IIII", 2, HashSize, 0, 0))
+for Index, File in enumerate(Files):
+    Path = b"/f%d\0" % Index
+    Out.write(struct.pack("<QQI", sum(Size for (_, Size) in File), len(File), len(Path)) + Path)
+    # the metadata (uid, gid, perm, atime, mtime, ctime, hard links, device id, inode)
+    Out.write(b"\0" * 64)
+    for (Fp, Size) in File:
+        # size, compression ratio, hash
+        Out.write(struct.pack("<QB", Size, 10) + Fp)
+Out.close()
+print("%d files, %d chunks, %d bytes" % (len(Files), Chunks, Bytes))
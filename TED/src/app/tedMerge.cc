@@ -0,0 +1,235 @@
+/// \file tedMerge.cc
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief merge the outputs of partition workers of TEDSim into the final stat
+/// and frequency outputs
+/// \version 0.1
+/// \date 2019-11-05
+///
+/// \copyright Copyright (c) 2019
+///
+
+#include <queue>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#include "../../include/define.h"
+#include "../../include/outputSink.h"
+#include "../../include/sim.h"
+
+using namespace std;
+
+/**the line buffer of a text frequency record (hex-key\t\tcount) */
+#define MERGE_LINE_SIZE (OUTPUT_MAX_KEY_LEN * 3 + 32)
+
+/**a sorted frequency file of a partition */
+class FreqReader {
+    private:
+        FILE* fp_ = NULL;
+        bool binary_;
+        char line_[MERGE_LINE_SIZE];
+
+    public:
+        /**the current record */
+        string key_;
+        uint64_t count_ = 0;
+
+        /// \brief Construct a new Freq Reader object
+        ///
+        /// \param fp - the frequency file
+        /// \param binary - read binary records instead of text
+        FreqReader(FILE* fp, bool binary) {
+            fp_ = fp;
+            binary_ = binary;
+        }
+
+        /// \brief Destroy the Freq Reader object
+        ///
+        ~FreqReader() {
+            fclose(fp_);
+        }
+
+        /// \brief read the next record
+        ///
+        /// \return true - success
+        /// \return false - the end of file
+        bool Next() {
+            if (binary_) {
+                /**[1-byte key length][key][8-byte count] */
+                uint8_t len;
+                if (fread(&len, 1, 1, fp_) != 1) {
+                    return false;
+                }
+                key_.resize(len);
+                if (fread(&key_[0], 1, len, fp_) != len ||
+                    fread(&count_, sizeof(uint64_t), 1, fp_) != 1) {
+                    fprintf(stderr, "the frequency file is truncated, %s:%d\n", FILE_NAME,
+                        CURRENT_LIEN);
+                    exit(1);
+                }
+                return true;
+            }
+
+            /**hex-key\t\tcount */
+            if (fgets(line_, sizeof(line_), fp_) == NULL) {
+                return false;
+            }
+            key_.clear();
+            char* item = strtok(line_, ":\t\n");
+            char* next = strtok(NULL, ":\t\n");
+            while (next != NULL) {
+                key_.push_back(static_cast<char>(strtol(item, NULL, 16)));
+                item = next;
+                next = strtok(NULL, ":\t\n");
+            }
+            if (item == NULL) {
+                return Next();
+            }
+            count_ = strtoull(item, NULL, 10);
+            return true;
+        }
+};
+
+void Usage(char* const program) {
+    fprintf(stderr, "./TEDMerge [outputfile] [partition outputfile 1] ... " \
+        "[partition outputfile n]\n" \
+        "merge [partition outputfile].part, .pfreq and .cfreq of the partition workers " \
+        "(./TEDSim -p [index]/[number]), print the merged stat and write " \
+        "[outputfile].pfreq and .cfreq\n");
+}
+
+/// \brief merge the partial statistics of all partitions
+///
+/// \param partNames - the output file names of partitions
+/// \param stat - the merged statistics <return>
+void MergeStat(vector<string> const& partNames, SimStat_t& stat) {
+    memset(&stat, 0, sizeof(SimStat_t));
+    vector<bool> isMerged;
+    for (size_t i = 0; i < partNames.size(); i++) {
+        string name = partNames[i] + PARTITION_STAT_SUFFIX;
+        FILE* fp = fopen(name.c_str(), "rb");
+        if (fp == NULL) {
+            fprintf(stderr, "fail to open the partial stat: %s, %s:%d\n", name.c_str(),
+                FILE_NAME, CURRENT_LIEN);
+            exit(1);
+        }
+        PartialStat_t partialStat;
+        if (fread(&partialStat, sizeof(PartialStat_t), 1, fp) != 1) {
+            fprintf(stderr, "fail to read the partial stat: %s, %s:%d\n", name.c_str(),
+                FILE_NAME, CURRENT_LIEN);
+            exit(1);
+        }
+        fclose(fp);
+
+        /**the partitions should be disjoint and of the same partition number */
+        if (isMerged.empty()) {
+            isMerged.resize(partialStat.partitionNum, false);
+        }
+        if (partialStat.partitionNum != isMerged.size() ||
+            partialStat.partitionIndex >= isMerged.size() ||
+            isMerged[partialStat.partitionIndex]) {
+            fprintf(stderr, "%s is partition %u of %u, which cannot be merged, %s:%d\n",
+                name.c_str(), partialStat.partitionIndex, partialStat.partitionNum,
+                FILE_NAME, CURRENT_LIEN);
+            exit(1);
+        }
+        isMerged[partialStat.partitionIndex] = true;
+
+        for (int flag = 0; flag < 2; flag++) {
+            stat.logicalChunks[flag] += partialStat.stat.logicalChunks[flag];
+            stat.uniqueChunks[flag] += partialStat.stat.uniqueChunks[flag];
+            stat.logicalSize[flag] += partialStat.stat.logicalSize[flag];
+            stat.uniqueSize[flag] += partialStat.stat.uniqueSize[flag];
+        }
+    }
+
+    for (size_t i = 0; i < isMerged.size(); i++) {
+        if (!isMerged[i]) {
+            fprintf(stderr, "warning: partition %lu is missing, the stat is partial\n", i);
+        }
+    }
+}
+
+/// \brief k-way merge the sorted frequency files of all partitions, the counts of the
+/// same key are summed
+///
+/// \param partNames - the output file names of partitions
+/// \param outputFileName - the output file name
+/// \param suffix - .pfreq or .cfreq
+void MergeFreq(vector<string> const& partNames, string const outputFileName,
+    string const suffix) {
+    vector<FreqReader*> readers;
+    for (size_t i = 0; i < partNames.size(); i++) {
+        string name = partNames[i] + suffix;
+        FILE* fp = fopen(name.c_str(), OUTPUT_BINARY_ENABLE ? "rb" : "r");
+        if (fp == NULL) {
+            fprintf(stderr, "no frequency file: %s, skip %s\n", name.c_str(), suffix.c_str());
+            for (size_t j = 0; j < readers.size(); j++) {
+                delete readers[j];
+            }
+            return ;
+        }
+        readers.push_back(new FreqReader(fp, OUTPUT_BINARY_ENABLE));
+    }
+
+    /**min-heap of (key, reader index) */
+    typedef pair<string, size_t> HeapItem_t;
+    priority_queue<HeapItem_t, vector<HeapItem_t>, greater<HeapItem_t> > heap;
+    for (size_t i = 0; i < readers.size(); i++) {
+        if (readers[i]->Next()) {
+            heap.push(make_pair(readers[i]->key_, i));
+        }
+    }
+
+    string name = outputFileName + suffix;
+    FILE* fp = fopen(name.c_str(), "w");
+    if (fp == NULL) {
+        fprintf(stderr, "fail to open the output: %s, %s:%d\n", name.c_str(), FILE_NAME,
+            CURRENT_LIEN);
+        exit(1);
+    }
+    OutputSink* sink = new OutputSink(fp);
+    while (!heap.empty()) {
+        string key = heap.top().first;
+        uint64_t count = 0;
+        while (!heap.empty() && heap.top().first == key) {
+            size_t index = heap.top().second;
+            heap.pop();
+            count += readers[index]->count_;
+            if (readers[index]->Next()) {
+                heap.push(make_pair(readers[index]->key_, index));
+            }
+        }
+        sink->WriteFreq((const uint8_t*)key.data(), key.size(), count);
+    }
+    delete sink;
+    fclose(fp);
+
+    for (size_t i = 0; i < readers.size(); i++) {
+        delete readers[i];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    string outputFile = string(argv[1]);
+    vector<string> partNames;
+    for (int i = 2; i < argc; i++) {
+        partNames.push_back(string(argv[i]));
+    }
+
+    /**the unique stat is additive since the partitions are disjoint in fingerprints */
+    SimStat_t stat;
+    MergeStat(partNames, stat);
+    Simulator::PrintStat(stat);
+
+    MergeFreq(partNames, outputFile, ".pfreq");
+    MergeFreq(partNames, outputFile, ".cfreq");
+    return 0;
+}
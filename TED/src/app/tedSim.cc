@@ -12,19 +12,11 @@
 #include <stdio.h>
 #include <sstream>
 #include <string>
+#include <string.h>
 #include <time.h>
 
-#include "../../include/sim.h"
-#include "../../include/convSim.h"
+#include "../../include/libted.h"
 #include "../../include/statsRecord.h"
-#include "../../include/tecSim.h"
-#include "../../include/localTecSim.h"
-#include "../../include/proTecSim.h"
-#include "../../include/tSim.h"
-#include "../../include/intuiSim.h"
-#include "../../include/minHashSim.h"
-#include "../../include/globalTecSim.h"
-#include "../../include/skeSim.h"
 
 using namespace std;
 
@@ -36,15 +28,85 @@ void Usage(char* const program, int operand) {
             "3, minhash: ./TEDSim [inputfile] [outputfile]\n" \
             "4, mle: ./TEDSim [inputfile] [outputfile]\n" \
             "5, ske: ./TEDSim [inputfile] [outputfile]\n" \
+            "6, mkm (bTED with multiple key managers): ./TEDSim [inputfile] [outputfile] " \
+            "[threshold] [distribution-type] [key-manager-number] [routing-scheme]\n" \
             "[distribution-type (0) Disable (1)uniform-distribution" \
             "(2)poisson-distribution (3)normal-distribution " \
-            "(4)geo-distribution]\n", program);
+            "(4)geo-distribution]\n" \
+            "[routing-scheme (1)basic (2)enhance (3)fp (4)rr]\n" \
+            "option: -p [index]/[number] (partition mode) simulate the fingerprints in the " \
+            "hash range of a partition, and merge the outputs by ./TEDMerge. " \
+            "Run each partition in its own working directory. mle, bted and ske are exact; " \
+            "fted solves each partition by itself (use [batch-size] / [number] to keep the " \
+            "span of a batch), and minhash segments each partition by itself.\n" \
+            "SAMPLING_ENABLE (define.h) keeps the fingerprints under the sampling rate: mle, " \
+            "bted and ske are exact for the kept keys; fted solves a batch of sampled chunks " \
+            "(use [batch-size] * rate to keep the span of a batch), and minhash segments the " \
+            "sampled stream.\n" \
+            "option: -c [state file] (HyperLogLog mode) merge this backup into the cumulative " \
+            "state of a backup series and print the cumulative estimation, remove the file " \
+            "to restart the series.\n", program);
+}
+
+/// \brief remove the partition option "-p index/number" from the arguments
+///
+/// \param argc - the number of arguments <return>
+/// \param argv - the arguments <return>
+/// \param param - the parameters <return>
+void ParsePartition(int& argc, char* argv[], TEDParam_t& param) {
+    param.partitionIndex = 0;
+    param.partitionNum = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") != 0) {
+            continue;
+        }
+        if (i + 1 >= argc || sscanf(argv[i + 1], "%u/%u", &param.partitionIndex,
+            &param.partitionNum) != 2 || param.partitionNum == 0 ||
+            param.partitionIndex >= param.partitionNum) {
+            fprintf(stderr, "the partition should be index/number, %s:%d\n", FILE_NAME,
+                CURRENT_LIEN);
+            exit(1);
+        }
+        for (int j = i; j + 2 < argc; j++) {
+            argv[j] = argv[j + 2];
+        }
+        argc -= 2;
+        return ;
+    }
+}
+
+/// \brief remove the cumulative state option "-c file" from the arguments
+///
+/// \param argc - the number of arguments <return>
+/// \param argv - the arguments <return>
+/// \param stateFile - the state file (empty: disable) <return>
+void ParseCumulativeState(int& argc, char* argv[], string& stateFile) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") != 0) {
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "please enter the cumulative state file, %s:%d\n", FILE_NAME,
+                CURRENT_LIEN);
+            exit(1);
+        }
+        stateFile = string(argv[i + 1]);
+        for (int j = i; j + 2 < argc; j++) {
+            argv[j] = argv[j + 2];
+        }
+        argc -= 2;
+        return ;
+    }
 }
 
 int main(int argc, char* argv[]) {
     
     fprintf(stderr, "Start simulation.\n");
 
+    TEDParam_t param;
+    ParsePartition(argc, argv, param);
+    string stateFile;
+    ParseCumulativeState(argc, argv, stateFile);
     if (argc < 4) {
         Usage(argv[0], argc);
         return 1;
@@ -53,93 +115,85 @@ int main(int argc, char* argv[]) {
     string inputFile = string(argv[1]);
     string outputFile = string(argv[2]);
     string method = string(argv[3]);
-/**start to test */
-    struct timeval startTime;
-    gettimeofday(&startTime, NULL);
-    StatsRecorder::GetInstance()->OpenStatistics(startTime);
 
-    if (method == "mle") {
-        ConvSim* mySim;
-        mySim = new ConvSim();
-        STAT_TIME_PROCESS(mySim->ProcessHashFile(inputFile, outputFile), 
-            StatusType::SIMULATOR_TIME);
-        delete mySim;
-    } else if (method == "bted") {
-        TECSim* mySim;
-        mySim = new TECSim();
+    /**parse the parameters of each method */
+    param.method = method;
+    param.threshold = 0;
+    param.batchSize = 0;
+    param.blowUpRate = 0;
+    param.distriType = 0;
+    param.managerNum = 1;
+    param.routeScheme = ROUTE_FP;
+    if (method == "bted") {
         if (argc < 5) {
             fprintf(stderr, "please enter the threshold, %s:%d\n", FILE_NAME, CURRENT_LIEN);
             exit(1);
         }
-        int threshold = atoi(argv[4]);
-        mySim->SetThreshold(threshold);
+        param.threshold = atoi(argv[4]);
         if (argc < 6) {
             fprintf(stderr, "please enter the distribution type.\n ");            
             Usage(argv[0], argc);
             exit(1);
         }
-        int distriType = atoi(argv[5]);
-        if (distriType != 0) {
-            mySim->EnablePro();
-            mySim->SetDistri(distriType);
-        } 
-        STAT_TIME_PROCESS(mySim->ProcessHashFile(inputFile, outputFile),
-            StatusType::SIMULATOR_TIME);
-        delete mySim;
+        param.distriType = atoi(argv[5]);
     } else if (method == "fted") {
-        LocalTECSim* mySim;
-        mySim = new LocalTECSim();
         if (argc < 5) {
             fprintf(stderr, "please enter the batch size, %s:%d\n", FILE_NAME, CURRENT_LIEN);
             Usage(argv[0], argc);
             exit(1);
         }
-        size_t batchSize = atol(argv[4]);
-        mySim->SetBatchSize(batchSize);
+        param.batchSize = atol(argv[4]);
 
         if (argc < 6) {
             fprintf(stderr, "please enter the blowup rate, %s:%d\n", FILE_NAME, CURRENT_LIEN);
             Usage(argv[0],argc);
             exit(1);
         }
-        double blowupRate = atof(argv[5]);
-        mySim->SetBlowUpRate(blowupRate);
+        param.blowUpRate = atof(argv[5]);
         
         if (argc < 7) {
             fprintf(stderr, "please enter the distribution type.\n ");            
             Usage(argv[0], argc);
             exit(1);
         }
-
-        int distriType = atoi(argv[6]);
-        if (distriType != 0) {
-            mySim->EnablePro();
-            mySim->SetDistri(distriType);
-        } 
-
-        STAT_TIME_PROCESS(mySim->ProcessHashFile(inputFile, outputFile),
-            StatusType::SIMULATOR_TIME);
-        delete mySim;
-
-    } else if (method == "minhash") {
-        MinHashSim* mySim;
-        mySim = new MinHashSim();
-        STAT_TIME_PROCESS(mySim->ProcessHashFile(inputFile, outputFile),
-            StatusType::SIMULATOR_TIME);
-        delete mySim;
-    } else if (method == "ske") {
-        SKESim* mySim;
-        mySim = new SKESim();
-        STAT_TIME_PROCESS(mySim->ProcessHashFile(inputFile, outputFile),
-            StatusType::SIMULATOR_TIME);
-        delete mySim;
-    } else {
+        param.distriType = atoi(argv[6]);
+    } else if (method == "mkm") {
+        if (argc < 8) {
+            fprintf(stderr, "please enter the threshold, distribution type, key manager "
+                "number and routing scheme, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+            Usage(argv[0], argc);
+            exit(1);
+        }
+        param.threshold = atoi(argv[4]);
+        param.distriType = atoi(argv[5]);
+        param.managerNum = atoi(argv[6]);
+        param.routeScheme = atoi(argv[7]);
+    } else if (!TEDLib::IsSupported(method)) {
         fprintf(stderr,"method:%s cannot support, %s:%d\n", method.c_str(), FILE_NAME,      
             CURRENT_LIEN);
         Usage(argv[0], argc);
         exit(1);
     }
 
+    if (SAMPLING_ENABLE && (method == "fted" || method == "minhash")) {
+        fprintf(stderr, "%s runs on the sampled stream: its batches or segments are not the "
+            "ones of the full trace\n", method.c_str());
+    }
+
+/**start to test */
+    struct timeval startTime;
+    gettimeofday(&startTime, NULL);
+    StatsRecorder::GetInstance()->OpenStatistics(startTime);
+
+    TEDLib* mySim = new TEDLib(param);
+    mySim->SetTimeSeriesOutput(outputFile);
+    if (!stateFile.empty()) {
+        mySim->SetCumulativeState(stateFile);
+    }
+    STAT_TIME_PROCESS(mySim->ProcessHashFile(inputFile, outputFile),
+        StatusType::SIMULATOR_TIME);
+    delete mySim;
+
     double simulateSecond = (StatsRecorder::GetInstance()->GetTime(StatusType::SIMULATOR_TIME)) / 1000000.0;
     fprintf(stderr, "analysis time: %lf\n", simulateSecond);
 
@@ -0,0 +1,154 @@
+/// \file libted.cc
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief implement the embeddable interface of TED simulators
+/// \version 0.1
+/// \date 2019-10-30
+///
+/// \copyright Copyright (c) 2019
+///
+
+#include "../../include/libted.h"
+
+#include "../../include/convSim.h"
+#include "../../include/localTecSim.h"
+#include "../../include/minHashSim.h"
+#include "../../include/multiKMSim.h"
+#include "../../include/skeSim.h"
+#include "../../include/tecSim.h"
+
+/// \brief Construct a new TEDLib object, exit if the method is not supported
+///
+/// \param param - the parameters of the simulator
+TEDLib::TEDLib(TEDParam_t const& param) {
+    if (param.method == "mle") {
+        sim_ = new ConvSim();
+    } else if (param.method == "bted") {
+        TECSim* tecSim = new TECSim();
+        tecSim->SetThreshold(param.threshold);
+        if (param.distriType != 0) {
+            tecSim->EnablePro();
+            tecSim->SetDistri(param.distriType);
+        }
+        sim_ = tecSim;
+    } else if (param.method == "fted") {
+        LocalTECSim* localTecSim = new LocalTECSim();
+        localTecSim->SetBatchSize(param.batchSize);
+        localTecSim->SetBlowUpRate(param.blowUpRate);
+        if (param.distriType != 0) {
+            localTecSim->EnablePro();
+            localTecSim->SetDistri(param.distriType);
+        }
+        sim_ = localTecSim;
+    } else if (param.method == "mkm") {
+        MultiKMSim* multiKMSim = new MultiKMSim(param.managerNum, param.routeScheme);
+        multiKMSim->SetThreshold(param.threshold);
+        if (param.distriType != 0) {
+            multiKMSim->EnablePro();
+            multiKMSim->SetDistri(param.distriType);
+        }
+        sim_ = multiKMSim;
+    } else if (param.method == "minhash") {
+        sim_ = new MinHashSim();
+    } else if (param.method == "ske") {
+        sim_ = new SKESim();
+    } else {
+        fprintf(stderr, "method:%s cannot support, %s:%d\n", param.method.c_str(),
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    if (param.partitionNum > 1) {
+        sim_->SetPartition(param.partitionIndex, param.partitionNum);
+    }
+}
+
+/// \brief Destroy the TEDLib object
+///
+TEDLib::~TEDLib() {
+    if (cipherOut_ != NULL) {
+        sim_->CloseCipherOutput(cipherOut_);
+    }
+    delete sim_;
+}
+
+/// \brief check whether a method is supported
+///
+/// \param method - the method name
+/// \return true - supported
+bool TEDLib::IsSupported(std::string const method) {
+    return method == "mle" || method == "bted" || method == "fted" ||
+        method == "minhash" || method == "ske" || method == "mkm";
+}
+
+/// \brief process an input hash file (the same as the TEDSim)
+///
+/// \param inputFileName - the input file name
+/// \param outputFileName - the output file name
+void TEDLib::ProcessHashFile(std::string const inputFileName,
+    std::string const outputFileName) {
+    sim_->ProcessHashFile(inputFileName, outputFileName);
+    finished_ = true;
+}
+
+/// \brief Set the output of time series, must be called before pushing records
+///
+/// \param fileName - the output file name, the time series goes to <fileName>.series.csv
+void TEDLib::SetTimeSeriesOutput(std::string const fileName) {
+    sim_->SetTimeSeriesOutput(fileName);
+}
+
+/// \brief Set the file of cumulative HyperLogLog state (HLL_COUNT_ENABLE), must be
+/// called before pushing records
+///
+/// \param fileName - the state file, removed to restart the cumulative estimation
+void TEDLib::SetCumulativeState(std::string const fileName) {
+    sim_->SetCumulativeState(fileName);
+}
+
+/// \brief print the ciphertext of pushed records to a file
+///
+/// \param fileName - the output file name
+/// \return true - success
+bool TEDLib::OpenCipherOutput(std::string const fileName) {
+    if (cipherOut_ != NULL) {
+        sim_->CloseCipherOutput(cipherOut_);
+    }
+    cipherOut_ = sim_->OpenCipherOutput(fileName);
+    return cipherOut_ != NULL;
+}
+
+/// \brief push a batch of records from memory
+///
+/// \param records - the record array
+/// \param recordNum - the number of records
+void TEDLib::PushRecords(TEDRecord_t const* records, size_t recordNum) {
+    if (finished_) {
+        fprintf(stderr, "cannot push records after finishing, %s:%d\n", FILE_NAME,
+            CURRENT_LIEN);
+        exit(1);
+    }
+
+    /**the simulators expect a fingerprint ends with '\0' */
+    uint8_t chunkFp[FP_SIZE + 1];
+    chunkFp[FP_SIZE] = '\0';
+    for (size_t i = 0; i < recordNum; i++) {
+        memcpy(chunkFp, records[i].fp, FP_SIZE);
+        sim_->FeedRecord(chunkFp, records[i].size, cipherOut_);
+    }
+}
+
+/// \brief finish the pushed stream: flush the pending records and print the
+/// stat, frequency and heavy-hitter files (and the partial stat in partition mode)
+///
+/// \param outputFileName - the output file name
+void TEDLib::Finish(std::string const outputFileName) {
+    if (finished_) {
+        return ;
+    }
+    sim_->FlushRecords(cipherOut_);
+    if (cipherOut_ != NULL) {
+        sim_->CloseCipherOutput(cipherOut_);
+        cipherOut_ = NULL;
+    }
+    sim_->PrintResult(outputFileName);
+    finished_ = true;
+}
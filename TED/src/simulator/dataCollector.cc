@@ -17,41 +17,32 @@
 void DataCollector::ProcessHashFile(std::string const inputFileName, 
     std::string const outputFileName) {
     
-    /**assume size of input file is large than 32 bytes */
-    char readBuffer[256];
-    char* readFlag;
-    char* item;
     uint8_t chunkFp[FP_SIZE + 1];
     memset(chunkFp, 0 , FP_SIZE + 1);
+    uint64_t size = 0;
 
-    FILE* fpIn = NULL;
+    TraceReader traceReader;
     FILE* fpOut = NULL;
-    if ((fpIn = fopen(inputFileName.c_str(), "r")) != NULL) {
+    if (traceReader.Open(inputFileName)) {
         fprintf(stderr, "Open plaintext data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
     } else {
         fprintf(stderr, "Open plaintext data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        exit(1);
     }
 
     fpOut = fopen(outputFileName.c_str(), "w");
 
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
-        /**read chunk information into chunk buffer */    
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < FP_SIZE); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            item = strtok(NULL, ":\t\n ");
+    while (traceReader.ReadRecord(chunkFp, FP_SIZE, size)) {
+        /**consistent sampling: all duplicates are kept or dropped together */
+        if (SAMPLING_ENABLE && !IsSampled(chunkFp, FP_SIZE)) {
+            continue;
         }
-        chunkFp[FP_SIZE] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
 
         /**count the chunk information in global leveldb */
         CountChunk(chunkFp, FP_SIZE + 1, size, 0);
 
     }
-    fclose(fpIn);
+    traceReader.Close();
     fclose(fpOut);
     PrintChunkFreq(outputFileName, FP_SIZE, 0);
 
@@ -63,41 +54,32 @@ void DataCollector::ProcessHashFile(std::string const inputFileName,
 /// \param outputFileName - the output file name
 void DataCollector::ProcessCipherHashFile(std::string const inputFileName, 
     std::string const outputFileName) {
-    /**assume size of input file is large than 32 bytes */
-    char readBuffer[256];
-    char* readFlag;
-    char* item;
     uint8_t chunkFp[fpLen_ + 1];
     memset(chunkFp, 0 , fpLen_ + 1);
+    uint64_t size = 0;
 
-    FILE* fpIn = NULL;
+    TraceReader traceReader;
     FILE* fpOut = NULL;
-    if ((fpIn = fopen(inputFileName.c_str(), "r")) != NULL) {
+    if (traceReader.Open(inputFileName)) {
         fprintf(stderr, "Open ciphertext data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
     } else {
         fprintf(stderr, "Open ciphertext data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        exit(1);
     }
 
     fpOut = fopen(outputFileName.c_str(), "w");
 
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
-        /**read chunk information into chunk buffer */    
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < fpLen_); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            item = strtok(NULL, ":\t\n ");
+    while (traceReader.ReadRecord(chunkFp, fpLen_, size)) {
+        /**consistent sampling: all duplicates are kept or dropped together */
+        if (SAMPLING_ENABLE && !IsSampled(chunkFp, fpLen_)) {
+            continue;
         }
-        chunkFp[fpLen_] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
 
         /**count the chunk information in global leveldb */
         CountChunk(chunkFp, fpLen_ + 1, size, 1);
 
     }
-    fclose(fpIn);
+    traceReader.Close();
     fclose(fpOut);
     PrintChunkFreq(outputFileName, fpLen_, 1);
     PrintBackupStat();
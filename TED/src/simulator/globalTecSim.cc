@@ -8,6 +8,7 @@
 ///
 
 #include "../../include/globalTecSim.h"
+#include "../../include/simDriver.h"
 
 long inline calDiff(struct timeval &timestart, struct timeval &timeend) {
     long diff = 1000000 * (timeend.tv_sec - timestart.tv_sec) + timeend.tv_usec - timestart.tv_usec;
@@ -23,26 +24,11 @@ void GlobalTECSim::ProcessHashFile(std::string const inputFileName,
     
     struct timeval stime, etime;
 
-    /**assume size of input file is large than 32 bytes */
-    char readBuffer[256];
-    char* readFlag;
-    char* item;
-    uint8_t chunkFp[FP_SIZE + 1];
-    memset(chunkFp, 0 , FP_SIZE + 1);
-
-    /**init the input file and output file */
-    FILE* fpIn = NULL;
-    FILE* fpOut = NULL;
-    if ((fpIn = fopen(inputFileName.c_str(), "r")) != NULL) {
-        fprintf(stderr, "Open data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    } else {
-        fprintf(stderr, "Open data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    }
+    FILE* fpOut = OpenCipherOutput(outputFileName);
 
-    fpOut = fopen(outputFileName.c_str(), "w");
-    
-    /**encryption key */
-    uint8_t key[sizeof(int)]; 
+    /**the spill file of the first pass cache */
+    passCacheName_ = outputFileName + ".pass";
+    passCache_.clear();
 
 
     /****************first pass *************
@@ -50,22 +36,14 @@ void GlobalTECSim::ProcessHashFile(std::string const inputFileName,
     * **************************************
     */
 
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
-        /**read chunk information into chunk buffer */
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < FP_SIZE); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            item = strtok(NULL, ":\t\n ");
-        }
-        chunkFp[FP_SIZE] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
-
+    SimDriver<GlobalTECSim>::ReadTrace(*this, inputFileName,
+        [&](uint8_t* const chunkFp, uint64_t const size) {
         /**record the state in hashtable or sketch */
         GlobalUpdateState(chunkFp, FP_SIZE + 1, size);
-    }
+
+        /**keep the parsed record for the second pass */
+        CacheRecord(chunkFp, size);
+    });
 
     /**start to solve the optimization problem */
     fprintf(stderr, "Start to solve the optimization problem.\n");
@@ -117,51 +95,76 @@ void GlobalTECSim::ProcessHashFile(std::string const inputFileName,
     */
 
     fprintf(stderr, "start the second pass of the workload.\n");
-    fseek(fpIn, 0, SEEK_SET);
 
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
-        /**read chunk information into chunk buffer */    
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < FP_SIZE); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            item = strtok(NULL, ":\t\n ");
+    /**iterate the cached records instead of parsing the input file again */
+    size_t recordLen = FP_SIZE + sizeof(uint64_t);
+    if (passCacheFile_ == NULL) {
+        ProcessCacheBlock(passCache_.data(), passCache_.size(), fpOut);
+    } else {
+        /**flush the remaining records, then read back the spill file in blocks */
+        fwrite(passCache_.data(), 1, passCache_.size(), passCacheFile_);
+        fflush(passCacheFile_);
+        fseek(passCacheFile_, 0, SEEK_SET);
+        size_t blockCap = (PASS_CACHE_SIZE / recordLen) * recordLen;
+        passCache_.resize(blockCap);
+        size_t readLen = 0;
+        while ((readLen = fread(passCache_.data(), 1, blockCap, passCacheFile_)) > 0) {
+            ProcessCacheBlock(passCache_.data(), readLen, fpOut);
         }
-        chunkFp[FP_SIZE] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
-
-        /**record the information in global leveldb (for message)*/
-        CountChunk(chunkFp, FP_SIZE + 1, size, 0);
-
-        /**update the state in in-memory hash table*/
-        GlobalUpdateState(chunkFp, FP_SIZE + 1, size);
-
-        /**key generateion */
-        KeyGen(chunkFp, FP_SIZE + 1, size, key);
-
-        /**encryption (simulation) */
-        uint8_t cipher[FP_SIZE + sizeof(key) + 1];
+        fclose(passCacheFile_);
+        passCacheFile_ = NULL;
+        remove(passCacheName_.c_str());
+    }
+    std::vector<uint8_t>().swap(passCache_);
 
-        SimTECEncrypt(chunkFp, FP_SIZE, key, sizeof(key), cipher);
+    CloseCipherOutput(fpOut);
 
-        /**count the encrypted chunk */
-        CountChunk(cipher, FP_SIZE + sizeof(key) + 1, size, 1);
+    /**print out the stat and frequency information */
+    PrintResult(outputFileName);
+}
 
-        /**print the message ciphertext */
-        PrintCipher(chunkFp, FP_SIZE, cipher, FP_SIZE + sizeof(key), size, fpOut);
+/// \brief append a parsed record to the first pass cache
+///
+/// \param chunkHash - the chunk fingerprint (FP_SIZE)
+/// \param chunkSize - the chunk size
+void GlobalTECSim::CacheRecord(uint8_t* const chunkHash, uint64_t const chunkSize) {
+    size_t recordLen = FP_SIZE + sizeof(uint64_t);
+    if (passCache_.size() + recordLen > PASS_CACHE_SIZE) {
+        /**spill the cache to disk */
+        if (passCacheFile_ == NULL) {
+            passCacheFile_ = fopen(passCacheName_.c_str(), "w+b");
+            if (passCacheFile_ == NULL) {
+                fprintf(stderr, "fail to open the cache file: %s, %s:%d\n",
+                    passCacheName_.c_str(), FILE_NAME, CURRENT_LIEN);
+                exit(1);
+            }
+            fprintf(stderr, "spill the first pass cache to %s\n", passCacheName_.c_str());
+        }
+        fwrite(passCache_.data(), 1, passCache_.size(), passCacheFile_);
+        passCache_.clear();
     }
-    
-    fclose(fpIn);
-    fclose(fpOut);
+    uint8_t record[recordLen];
+    memcpy(record, chunkHash, FP_SIZE);
+    memcpy(record + FP_SIZE, &chunkSize, sizeof(uint64_t));
+    passCache_.insert(passCache_.end(), record, record + recordLen);
+}
 
-    /**print out the stat information */
-    PrintBackupStat();
+/// \brief process a block of cached records in second pass
+///
+/// \param block - the record block
+/// \param blockLen - the length of the block
+/// \param fpOut - the output file
+void GlobalTECSim::ProcessCacheBlock(uint8_t* const block, size_t blockLen, FILE* fpOut) {
+    size_t recordLen = FP_SIZE + sizeof(uint64_t);
+    uint8_t chunkFp[FP_SIZE + 1];
+    uint64_t size = 0;
+    for (size_t offset = 0; offset + recordLen <= blockLen; offset += recordLen) {
+        memcpy(chunkFp, block + offset, FP_SIZE);
+        chunkFp[FP_SIZE] = '\0';
+        memcpy(&size, block + offset + FP_SIZE, sizeof(uint64_t));
 
-    /**print out the frequency information */
-    PrintChunkFreq(outputFileName, FP_SIZE, 0);
-    PrintChunkFreq(outputFileName, FP_SIZE + sizeof(key), 1);
+        SimDriver<GlobalTECSim>::ProcessRecord(*this, chunkFp, size, fpOut);
+    }
 }
 
 void GlobalTECSim::GlobalUpdateState(uint8_t* const chunkHash,
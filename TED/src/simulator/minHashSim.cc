@@ -8,6 +8,7 @@
 ///
 
 #include "../../include/minHashSim.h"
+#include "../../include/simDriver.h"
 
 
 ChunkInfo::ChunkInfo() {
@@ -33,6 +34,8 @@ ChunkInfo::~ChunkInfo() {
 MinHashSim::MinHashSim() {
     /* initialize minChunk */
     fprintf(stderr, "Initialize a MinHash Simulator.\n");
+    /**the ciphertext is the fingerprint + 4-byte key */
+    cipherFpLen_ = FP_SIZE + sizeof(int);
     memset(minChunk_, 0xff, FP_SIZE+1);
     minChunk_[FP_SIZE] = 0;
 }
@@ -87,110 +90,58 @@ bool MinHashSim::EndOfSegment(uint8_t* const chunkHash, uint64_t const chunkSize
 /// \param outputFileName - the output file name
 void MinHashSim::ProcessHashFile(std::string const inputFileName, 
     std::string const outputFileName) {
-    
-    /**assume size of input file is large than 32 bytes */
-    char readBuffer[256];
-    char* readFlag;
-    char* item;
-    uint8_t chunkFp[FP_SIZE + 1];
-    memset(chunkFp, 0 , FP_SIZE + 1);
-
-    /**init the input file and output file */
-    FILE* fpIn = NULL;
-    FILE* fpOut = NULL;
-    if ((fpIn = fopen(inputFileName.c_str(), "r")) != NULL) {
-        fprintf(stderr, "Open data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    } else {
-        fprintf(stderr, "Open data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    }
-
-    fpOut = fopen(outputFileName.c_str(), "w");
-    
-    /**encryption key */
-    uint8_t key[sizeof(int)]; 
-
-    /**simulate the data stream come from here */
-
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
+    SimDriver<MinHashSim>::ProcessHashFile(*this, inputFileName, outputFileName);
+}
 
-        /**read chunk information into chunk buffer */    
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < FP_SIZE); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            item = strtok(NULL, ":\t\n ");
-        }
-        chunkFp[FP_SIZE] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
-
-        /**count the chunk information in global leveldb */
-        CountChunk(chunkFp, FP_SIZE + 1, size, 0);
-
-        /**update the minHash */
-        MinHashUpdateState(chunkFp, size);
-
-        if (EndOfSegment(chunkFp, size) == true) {
-            /**generate real key */
-            uint8_t key[FP_SIZE + 1];
-            MinHashKeyGen(NULL, key);
-            int32_t realKey = 0;
-            memcpy(&realKey, key, sizeof(int32_t));
-
-            while (chunkQueue_.empty() == false) {
-                /**de-queue */
-                ChunkInfo info(chunkQueue_.front());
-                chunkQueue_.pop();
-                /**encryption */
-                uint8_t cipher[FP_SIZE + sizeof(realKey) + 1];
-                memcpy(cipher, info.fp, FP_SIZE);
-                memcpy(cipher + FP_SIZE, &realKey, sizeof(realKey));
-                cipher[FP_SIZE + sizeof(realKey)] = '\0'; 
-
-                /**count the encrypted chunk */
-                CountChunk(cipher, FP_SIZE + sizeof(realKey) + 1, info.size, 1);
-
-                /**print the message ciphertext */
-                PrintCipher(chunkFp, FP_SIZE, cipher, FP_SIZE + sizeof(key), info.size, fpOut);
-            }
-        }
+/// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+///
+/// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+/// \param chunkSize - the chunk size
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void MinHashSim::ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut) {
+    /**count the chunk information in global leveldb */
+    CountChunk(chunkFp, FP_SIZE + 1, chunkSize, 0);
+
+    /**update the minHash */
+    MinHashUpdateState(chunkFp, chunkSize);
+
+    if (EndOfSegment(chunkFp, chunkSize) == true) {
+        FlushRecords(fpOut);
     }
+}
 
-    /* process rest chunks */
-    if (chunkQueue_.empty() == false) {
-        /* generate real key */ 
-        uint8_t key[FP_SIZE + 1];
-        MinHashKeyGen(NULL, key);
-        int32_t realKey = 0;
-        memcpy(&realKey, key, sizeof(int32_t));
-
-        while (chunkQueue_.empty() == false) {
-            /* de-queue */
-            ChunkInfo info(chunkQueue_.front());
-            chunkQueue_.pop();
-
-            /* encryption */
-            uint8_t cipher[FP_SIZE + sizeof(realKey) + 1];
-            memcpy(cipher, info.fp, FP_SIZE);
-            memcpy(cipher + FP_SIZE, &realKey, sizeof(realKey));
-            cipher[FP_SIZE + sizeof(realKey)] = '\0'; 
-            /**count the encrypted chunk */
-            CountChunk(cipher, FP_SIZE + sizeof(realKey) + 1, info.size, 1);
-
-            /**print the message ciphertext */
-            PrintCipher(chunkFp, FP_SIZE, cipher, FP_SIZE + sizeof(key), info.size, fpOut);
-        }
+/// \brief process the pending records at the end of the stream
+///
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void MinHashSim::FlushRecords(FILE* fpOut) {
+    if (chunkQueue_.empty() == true) {
+        return ;
     }
-    fclose(fpIn);
-    fclose(fpOut);
 
-    /**print out the stat information */
-    PrintBackupStat();
+    /**generate real key */
+    uint8_t key[FP_SIZE + 1];
+    MinHashKeyGen(NULL, key);
+    int32_t realKey = 0;
+    memcpy(&realKey, key, sizeof(int32_t));
 
-    /**print out the frequency information */
-    PrintChunkFreq(outputFileName, FP_SIZE, 0);
-    PrintChunkFreq(outputFileName, FP_SIZE + sizeof(key), 1);
+    while (chunkQueue_.empty() == false) {
+        /**de-queue */
+        ChunkInfo info(chunkQueue_.front());
+        chunkQueue_.pop();
+        /**encryption */
+        uint8_t cipher[FP_SIZE + sizeof(realKey) + 1];
+        memcpy(cipher, info.fp, FP_SIZE);
+        memcpy(cipher + FP_SIZE, &realKey, sizeof(realKey));
+        cipher[FP_SIZE + sizeof(realKey)] = '\0'; 
+
+        /**count the encrypted chunk */
+        CountChunk(cipher, FP_SIZE + sizeof(realKey) + 1, info.size, 1);
+
+        /**print the message ciphertext */
+        if (fpOut != NULL) {
+            PrintCipher(info.fp, FP_SIZE, cipher, FP_SIZE + sizeof(realKey), info.size, fpOut);
+        }
+    }
 }
 
 /// \brief add chunk into queue
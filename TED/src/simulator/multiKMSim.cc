@@ -0,0 +1,294 @@
+/// \file multiKMSim.cc
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief implement the interfaces defined in MultiKMSim
+/// \version 0.1
+/// \date 2019-11-07
+///
+/// \copyright Copyright (c) 2019
+///
+
+#include "../../include/multiKMSim.h"
+#include "../../include/simDriver.h"
+
+/// \brief Construct a new MultiKMSim object
+///
+/// \param managerNum - the number of key managers
+/// \param routeScheme - the routing scheme (ROUTE_*)
+MultiKMSim::MultiKMSim(uint32_t managerNum, int routeScheme) {
+    if (!SKETCH_ENABLE) {
+        fprintf(stderr, "the key managers need their own sketches (SKETCH_ENABLE), %s:%d\n",
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    if (managerNum == 0 || routeScheme < ROUTE_BASIC || routeScheme > ROUTE_RR) {
+        fprintf(stderr, "wrong key manager number: %u or routing scheme: %d, %s:%d\n",
+            managerNum, routeScheme, FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    fprintf(stderr, "Initialize Multi-Key-Manager Simulator with %u key managers.\n",
+        managerNum);
+    managerNum_ = managerNum;
+    routeScheme_ = routeScheme;
+
+    /**the first key manager takes the sketch of TECSim */
+    sketches_.push_back(cmSketch_);
+    for (uint32_t i = 1; i < managerNum_; i++) {
+        sketches_.push_back(new CountMinSketch(SKETCH_WIDTH, SKETCH_DEPTH,
+            SEGMENT_ENABLE ? SKETCH_WINDOW_NUM : 1));
+    }
+    kmStats_.resize(managerNum_);
+}
+
+/// \brief Destroy the MultiKMSim object
+///
+MultiKMSim::~MultiKMSim() {
+    fprintf(stderr, "Destory Multi-Key-Manager Simulator.\n");
+    /**the first sketch is deleted by TECSim */
+    cmSketch_ = sketches_[0];
+    for (uint32_t i = 1; i < managerNum_; i++) {
+        delete sketches_[i];
+    }
+}
+
+/// \brief process an input hash file for encryption
+///
+/// \param inputFileName - the input file name
+/// \param outputFileName - the output file name
+void MultiKMSim::ProcessHashFile(std::string const inputFileName,
+    std::string const outputFileName) {
+    SimDriver<MultiKMSim>::ProcessHashFile(*this, inputFileName, outputFileName);
+}
+
+/// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+///
+/// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+/// \param chunkSize - the chunk size
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void MultiKMSim::ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize,
+    FILE* fpOut) {
+    SimDriver<MultiKMSim>::ProcessRecord(*this, chunkFp, chunkSize, fpOut);
+}
+
+/// \brief the value of a fingerprint: the sum of its bytes (as keyClient)
+///
+/// \param chunkFp - the chunk fingerprint
+/// \return uint32_t - the value
+uint32_t MultiKMSim::ConvertFpToValue(uint8_t* const chunkFp) {
+    uint32_t res = 0;
+    for (size_t i = 0; i < FP_SIZE; i++) {
+        res += chunkFp[i];
+    }
+    return res;
+}
+
+/// \brief check the load of key managers
+///
+/// \return uint32_t - the least loaded key manager if the deviation exceeds
+/// KM_DEVIATION_THRESHOLD, otherwise managerNum_
+uint32_t MultiKMSim::CheckManagerStatus() {
+    uint32_t minIndex = 0;
+    uint64_t minLoad = kmStats_[0].logicalChunks;
+    uint64_t maxLoad = kmStats_[0].logicalChunks;
+    for (uint32_t i = 1; i < managerNum_; i++) {
+        if (kmStats_[i].logicalChunks < minLoad) {
+            minLoad = kmStats_[i].logicalChunks;
+            minIndex = i;
+        }
+        maxLoad = std::max(maxLoad, kmStats_[i].logicalChunks);
+    }
+
+    if (maxLoad - minLoad <= KM_DEVIATION_THRESHOLD) {
+        return managerNum_;
+    }
+    return minIndex;
+}
+
+/// \brief the most loaded key manager
+///
+/// \return uint32_t - the index of key manager
+uint32_t MultiKMSim::GetMaxManager() {
+    uint32_t maxIndex = 0;
+    for (uint32_t i = 1; i < managerNum_; i++) {
+        if (kmStats_[i].logicalChunks > kmStats_[maxIndex].logicalChunks) {
+            maxIndex = i;
+        }
+    }
+    return maxIndex;
+}
+
+/// \brief find a fingerprint in the LRU cache, and move it to the front
+///
+/// \param fp - the fingerprint
+/// \param manager - the cached key manager <return>
+/// \return true - it is cached
+bool MultiKMSim::GetRecord(std::string const& fp, uint32_t& manager) {
+    auto findResult = recordIndex_.find(fp);
+    if (findResult == recordIndex_.end()) {
+        return false;
+    }
+    recordList_.splice(recordList_.begin(), recordList_, findResult->second);
+    manager = findResult->second->second;
+    return true;
+}
+
+/// \brief put a fingerprint into the LRU cache, evict the least recently used one
+/// if full
+///
+/// \param fp - the fingerprint
+/// \param manager - the key manager
+void MultiKMSim::PutRecord(std::string const& fp, uint32_t manager) {
+    auto findResult = recordIndex_.find(fp);
+    if (findResult != recordIndex_.end()) {
+        findResult->second->second = manager;
+        recordList_.splice(recordList_.begin(), recordList_, findResult->second);
+        return ;
+    }
+    recordList_.push_front(std::make_pair(fp, manager));
+    recordIndex_[fp] = recordList_.begin();
+    if (recordIndex_.size() > KM_RECORD_CACHE_SIZE) {
+        recordIndex_.erase(recordList_.back().first);
+        recordList_.pop_back();
+    }
+}
+
+/// \brief route a chunk to a key manager by the routing scheme (as
+/// keyClient::keyAssignment)
+///
+/// \param chunkFp - the chunk fingerprint
+/// \return uint32_t - the index of key manager
+uint32_t MultiKMSim::Route(uint8_t* const chunkFp) {
+    uint32_t fpValue = ConvertFpToValue(chunkFp);
+    uint32_t manager = 0;
+    uint32_t status = 0;
+    switch (routeScheme_) {
+        case ROUTE_FP:
+            manager = fpValue % managerNum_;
+            break;
+        case ROUTE_RR:
+            manager = totalRouted_ % managerNum_;
+            break;
+        case ROUTE_BASIC:
+            status = CheckManagerStatus();
+            manager = (status == managerNum_) ? fpValue % managerNum_ : status;
+            break;
+        case ROUTE_ENHANCE: {
+            status = CheckManagerStatus();
+            if (status == managerNum_) {
+                manager = fpValue % managerNum_;
+                break;
+            }
+            /**unbalanced: a cached fingerprint stays with its manager, unless that
+             * manager is the most loaded one */
+            std::string fp((const char*)chunkFp, FP_SIZE);
+            if (GetRecord(fp, manager)) {
+                if (manager == GetMaxManager()) {
+                    manager = status;
+                    PutRecord(fp, manager);
+                }
+            } else {
+                manager = status;
+                PutRecord(fp, manager);
+            }
+            break;
+        }
+    }
+    totalRouted_++;
+    return manager;
+}
+
+/// \brief update the frequency of a key in the statistics of a key manager
+///
+/// \param freqTable - the frequency table
+/// \param hist - the frequency-of-frequency histogram
+/// \param freqLogSum - sum of f * log2(f)
+/// \param key - the key
+void MultiKMSim::CountManagerKey(spp::sparse_hash_map<std::string, uint64_t>& freqTable,
+    std::vector<uint64_t>& hist, double& freqLogSum, std::string const& key) {
+    uint64_t count = ++freqTable[key];
+    UpdateFreqHist(hist, freqLogSum, count);
+}
+
+/// \brief the key-derivation policy: route the chunk, then update the frequency
+/// and derive the key by the sketch of the key manager
+///
+/// \param chunkFp - the chunk fingerprint
+/// \param chunkSize - the chunk size
+/// \param key - the derived key <return>
+void MultiKMSim::DeriveKey(uint8_t* const chunkFp, uint64_t const chunkSize,
+    uint8_t* key) {
+    currentManager_ = Route(chunkFp);
+    KMStat_t& kmStat = kmStats_[currentManager_];
+    kmStat.logicalChunks++;
+    kmStat.logicalSize += chunkSize;
+
+    /**the key manager only sees the frequency of chunks routed to it */
+    cmSketch_ = sketches_[currentManager_];
+    currentUniqueChunk_ = kmStat.windowUniqueChunk;
+    TECSim::DeriveKey(chunkFp, chunkSize, key);
+
+    /**the derived key identifies {fp || state}, i.e., the ciphertext */
+    CountManagerKey(kmStat.plainFreq, kmStat.plainHist, kmStat.plainFreqLogSum,
+        std::string((const char*)chunkFp, FP_SIZE));
+    CountManagerKey(kmStat.keyFreq, kmStat.keyHist, kmStat.keyFreqLogSum,
+        std::string((const char*)key, KM_KEY_ID_SIZE));
+}
+
+/// \brief rotate the sketch window of the key manager (SEGMENT_ENABLE)
+///
+void MultiKMSim::AfterRecord() {
+    TECSim::AfterRecord();
+    kmStats_[currentManager_].windowUniqueChunk = currentUniqueChunk_;
+}
+
+/// \brief print the stat, the frequency files, and the stat of key managers
+///
+/// \param outputFileName - the output file name
+void MultiKMSim::PrintResult(std::string const outputFileName) {
+    Simulator::PrintResult(outputFileName);
+    PrintManagerStat();
+}
+
+/// \brief print the load balance, blowup and KLD of each key manager
+///
+void MultiKMSim::PrintManagerStat() {
+    const char* schemeName[] = {"", "basic", "enhance", "fp", "rr"};
+    printf("============== Key Managers ================\n");
+    printf("Key manager number: %u\n", managerNum_);
+    printf("Routing scheme: %s\n", schemeName[routeScheme_]);
+
+    uint64_t totalLoad = 0;
+    uint64_t maxLoad = 0;
+    uint64_t totalUnique = 0;
+    for (uint32_t i = 0; i < managerNum_; i++) {
+        KMStat_t& kmStat = kmStats_[i];
+        uint64_t uniquePlain = kmStat.plainFreq.size();
+        uint64_t uniqueKey = kmStat.keyFreq.size();
+        totalLoad += kmStat.logicalChunks;
+        maxLoad = std::max(maxLoad, kmStat.logicalChunks);
+        totalUnique += uniquePlain;
+
+        printf("Key manager %u: load %lu, unique original %lu, unique encrypted %lu, "
+            "blowup %.6lf, original KLD %.6lf, encrypted KLD %.6lf\n", i,
+            kmStat.logicalChunks, uniquePlain, uniqueKey,
+            uniquePlain == 0 ? 0 :
+            static_cast<double>(uniqueKey - uniquePlain) / uniquePlain,
+            CalKLD(uniquePlain, kmStat.logicalChunks, kmStat.plainFreqLogSum),
+            CalKLD(uniqueKey, kmStat.logicalChunks, kmStat.keyFreqLogSum));
+    }
+
+    /**load balance: max / mean load and the coefficient of variation */
+    double meanLoad = static_cast<double>(totalLoad) / managerNum_;
+    double squareSum = 0;
+    for (uint32_t i = 0; i < managerNum_; i++) {
+        double diff = kmStats_[i].logicalChunks - meanLoad;
+        squareSum += diff * diff;
+    }
+    printf("Load imbalance (max / mean): %.6lf\n",
+        meanLoad == 0 ? 0 : maxLoad / meanLoad);
+    printf("Load coefficient of variation: %.6lf\n",
+        meanLoad == 0 ? 0 : sqrt(squareSum / managerNum_) / meanLoad);
+
+    /**a fingerprint routed to several managers is counted by each of them */
+    printf("Fingerprint spread (sum of per-manager unique / unique): %.6lf\n",
+        mUniqueChunks_ == 0 ? 0 : static_cast<double>(totalUnique) / mUniqueChunks_);
+}
@@ -8,6 +8,7 @@
 ///
 
 #include "../../include/proTecSim.h"
+#include "../../include/simDriver.h"
 
 
 /// \brief key generation process
@@ -62,70 +63,14 @@ void ProTECSim::ProKeyGen(uint8_t* const chunkHash, size_t chunkHashLen,
 /// \param outputFileName - the output file name
 void ProTECSim::ProcessHashFile(std::string const inputFileName, 
     std::string const outputFileName) {
-    
-    /**assume size of input file is large than 32 bytes */
-    char readBuffer[256];
-    char* readFlag;
-    char* item;
-    uint8_t chunkFp[FP_SIZE + 1];
-    memset(chunkFp, 0, FP_SIZE + 1);
-
-    /**init the input file and output file */
-    FILE* fpIn = NULL;
-    FILE* fpOut = NULL;
-    if ((fpIn = fopen(inputFileName.c_str(), "r")) != NULL) {
-        fprintf(stderr, "Open data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    } else {
-        fprintf(stderr, "Open data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    }
-
-    fpOut = fopen(outputFileName.c_str(), "w");
-
-    /**encryption key */
-    uint8_t key[sizeof(int)];
-
-    /**simulate the data stream come from here */
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
-
-        /**read chunk information into chunk buffer */
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < FP_SIZE); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            item = strtok(NULL, ":\t\n ");
-        }
-        chunkFp[FP_SIZE] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
-
-        /**count the chunk information in global leveldb */
-        CountChunk(chunkFp, FP_SIZE + 1, size, 0);
-
-        /**update the state in in-memory hashtable */
-        TECUpdateState(chunkFp, FP_SIZE + 1, size);
-
-        /**probabilistic key generation */
-        ProKeyGen(chunkFp, FP_SIZE + 1, size, key);
-
-        /**encryption (simulation) */
-        uint8_t cipher[FP_SIZE + sizeof(key) + 1];
-
-        SimTECEncrypt(chunkFp, FP_SIZE, key, sizeof(key), cipher);
-
-        /**count the encrypted chunk */
-        CountChunk(cipher, FP_SIZE + sizeof(key) + 1, size, 1);
-
-        /**print the message ciphertext */
-        PrintCipher(chunkFp, FP_SIZE, cipher, FP_SIZE + sizeof(key), size, fpOut);
-    }
-    fclose(fpIn);
-    fclose(fpOut);
-
-    /**print out the state information */
-    PrintBackupStat();
+    SimDriver<ProTECSim>::ProcessHashFile(*this, inputFileName, outputFileName);
+}
 
-    /**print out the frequency information */
-    PrintChunkFreq(outputFileName, FP_SIZE, 0);
-    PrintChunkFreq(outputFileName, FP_SIZE + sizeof(key), 1);
-}   
\ No newline at end of file
+/// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+///
+/// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+/// \param chunkSize - the chunk size
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void ProTECSim::ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut) {
+    SimDriver<ProTECSim>::ProcessRecord(*this, chunkFp, chunkSize, fpOut);
+}
@@ -27,8 +27,16 @@ leveldb::DB *Simulator::InitStat(const char * name) {
 /// \brief Construct a new Simulator object
 ///
 Simulator::Simulator() {
-    mdb_ = InitStat("mstat");
-    cdb_ = InitStat("cstat");
+    if (HLL_COUNT_ENABLE) {
+        mHLL_ = new HyperLogLog(HLL_PRECISION);
+        cHLL_ = new HyperLogLog(HLL_PRECISION);
+    } else if (EXTERNAL_COUNT_ENABLE) {
+        mExtCounter_ = new ExtCounter("mstat");
+        cExtCounter_ = new ExtCounter("cstat");
+    } else {
+        mdb_ = InitStat("mstat");
+        cdb_ = InitStat("cstat");
+    }
 
     if (!CryptoPrimitive::opensslLockSetup()) {
         fprintf(stderr, "fail to set up OpenSSL locks\n");
@@ -49,21 +57,120 @@ Simulator::Simulator() {
     } else {
         fprintf(stderr, "Using Hashtable to count.\n");
     }
+
+    SetSamplingRate(SAMPLING_RATE);
+}
+
+/// \brief Set the sampling rate (used when SAMPLING_ENABLE is set)
+///
+/// \param samplingRate - the fraction of fingerprints kept, (0, 1]
+void Simulator::SetSamplingRate(double samplingRate) {
+    if (samplingRate <= 0 || samplingRate > 1) {
+        fprintf(stderr, "the sampling rate should be in (0, 1], %s:%d\n", FILE_NAME,
+            CURRENT_LIEN);
+        exit(1);
+    }
+    samplingRate_ = samplingRate;
+    samplingBound_ = static_cast<uint64_t>(samplingRate_ * 4294967296.0);
+    if (SAMPLING_ENABLE) {
+        fprintf(stderr, "Using consistent sampling, rate: %lf\n", samplingRate_);
+    }
+}
+
+/// \brief check whether a fingerprint is kept by the consistent sampling
+///
+/// \param chunkHash - the chunk fingerprint
+/// \param chunkHashLen - the length of fingerprint
+/// \return true - it is sampled
+/// \return false - it is dropped
+bool Simulator::IsSampled(uint8_t* const chunkHash, size_t chunkHashLen) {
+    uint32_t hashVal = 0;
+    MurmurHash3_x86_32(chunkHash, chunkHashLen, SAMPLING_SEED, &hashVal);
+    return static_cast<uint64_t>(hashVal) < samplingBound_;
+}
+
+/// \brief Set the partition of this worker, must be called before processing
+///
+/// \param partitionIndex - the index of this partition, [0, partitionNum)
+/// \param partitionNum - the number of partitions (1: disable)
+void Simulator::SetPartition(uint32_t partitionIndex, uint32_t partitionNum) {
+    if (partitionNum == 0 || partitionIndex >= partitionNum) {
+        fprintf(stderr, "the partition index should be in [0, %u), %s:%d\n", partitionNum,
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    partitionIndex_ = partitionIndex;
+    partitionNum_ = partitionNum;
+    fprintf(stderr, "simulate the partition %u of %u\n", partitionIndex_, partitionNum_);
+}
+
+/// \brief check whether a fingerprint is in the hash range of this partition
+///
+/// \param chunkHash - the chunk fingerprint
+/// \param chunkHashLen - the length of fingerprint
+/// \return true - it is in this partition
+/// \return false - it belongs to another partition
+bool Simulator::IsInPartition(uint8_t* const chunkHash, size_t chunkHashLen) {
+    uint32_t hashVal = 0;
+    MurmurHash3_x86_32(chunkHash, chunkHashLen, PARTITION_SEED, &hashVal);
+    return hashVal % partitionNum_ == partitionIndex_;
+}
+
+/// \brief print the mergeable partial statistics of this partition
+///
+/// \param fileName - the output file name, goes to <fileName>.part
+void Simulator::PrintPartialStat(std::string const fileName) {
+    PartialStat_t partialStat;
+    partialStat.partitionIndex = partitionIndex_;
+    partialStat.partitionNum = partitionNum_;
+    GetStat(partialStat.stat);
+
+    std::string name = fileName + PARTITION_STAT_SUFFIX;
+    FILE* fp = fopen(name.c_str(), "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "fail to open the partial stat output: %s, %s:%d\n", name.c_str(),
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    if (fwrite(&partialStat, sizeof(PartialStat_t), 1, fp) != 1) {
+        fprintf(stderr, "fail to write the partial stat, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    fclose(fp);
 }
 
 /// \brief Destroy the Simulator object
 ///
 Simulator::~Simulator() {
     fprintf(stderr, "Start to destory base simulator\n");
-    fprintf(stderr, "Start to destory the levelDB\n");
-    delete mdb_;
-    delete cdb_;
     delete cryptoObj_;
-    leveldb::Options optionsMDB;
-    leveldb::Options optionsCDB;
-    leveldb::Status statusMDB = leveldb::DestroyDB("mstat", optionsMDB);
-    leveldb::Status statusCDB = leveldb::DestroyDB("cstat", optionsCDB);
-    assert(statusMDB.ok() && statusCDB.ok());
+    if (timeSeriesFp_ != NULL) {
+        fclose(timeSeriesFp_);
+    }
+    if (cipherSink_ != NULL) {
+        delete cipherSink_;
+    }
+    if (mHeavyHitter_ != NULL) {
+        delete mHeavyHitter_;
+        delete cHeavyHitter_;
+    }
+    if (HLL_COUNT_ENABLE) {
+        delete mHLL_;
+        delete cHLL_;
+    } else if (EXTERNAL_COUNT_ENABLE) {
+        fprintf(stderr, "Start to destory the external counters\n");
+        delete mExtCounter_;
+        delete cExtCounter_;
+    } else {
+        fprintf(stderr, "Start to destory the levelDB\n");
+        delete mdb_;
+        delete cdb_;
+        leveldb::Options optionsMDB;
+        leveldb::Options optionsCDB;
+        leveldb::Status statusMDB = leveldb::DestroyDB("mstat", optionsMDB);
+        leveldb::Status statusCDB = leveldb::DestroyDB("cstat", optionsCDB);
+        assert(statusMDB.ok() && statusCDB.ok());
+    }
 }
 
 
@@ -115,6 +222,35 @@ void Simulator::CountChunk(uint8_t* const chunkHash, size_t chunkHashLen,
         cLogicalSize_ += chunkSize;
     }
 
+    if (mHeavyHitter_ != NULL) {
+        /**track the heavy hitters in the same pass */
+        if (flag == 0) {
+            mHeavyHitter_->Update(chunkHash, chunkHashLen);
+        } else {
+            cHeavyHitter_->Update(chunkHash, chunkHashLen);
+        }
+    }
+
+    if (HLL_COUNT_ENABLE) {
+        /**the unique stat is estimated in PrintBackupStat */
+        if (flag == 0) {
+            mHLL_->Add(chunkHash, chunkHashLen);
+        } else {
+            cHLL_->Add(chunkHash, chunkHashLen);
+        }
+        return ;
+    }
+
+    if (EXTERNAL_COUNT_ENABLE) {
+        /**the unique stat is computed when merging the sorted runs */
+        if (flag == 0) {
+            mExtCounter_->Add(chunkHash, chunkHashLen, chunkSize);
+        } else {
+            cExtCounter_->Add(chunkHash, chunkHashLen, chunkSize);
+        }
+        return ;
+    }
+
     leveldb::Status status = db->Get(leveldb::ReadOptions(), key, &exs);
 
     /**check if it is duplicated */
@@ -128,10 +264,16 @@ void Simulator::CountChunk(uint8_t* const chunkHash, size_t chunkHashLen,
             /**for the original backup */
             mUniqueChunks_++;
             mUniqueSize_ += chunkSize;
+            mFreqSquare_ += 1;
+            mFreqSizeSquare_ += static_cast<double>(chunkSize) * chunkSize;
+            mSizeSquare_ += static_cast<double>(chunkSize) * chunkSize;
         } else if (flag == 1) {
             /**for the encrypted backup */
             cUniqueChunks_++;
             cUniqueSize_ += chunkSize;
+            cFreqSquare_ += 1;
+            cFreqSizeSquare_ += static_cast<double>(chunkSize) * chunkSize;
+            cSizeSquare_ += static_cast<double>(chunkSize) * chunkSize;
         } else {
             fprintf(stderr, "the flag setting is wrong, %s:%d\n", FILE_NAME, CURRENT_LIEN);
             exit(1);
@@ -143,57 +285,332 @@ void Simulator::CountChunk(uint8_t* const chunkHash, size_t chunkHashLen,
         count++;
         countString = std::to_string(count);
         status = db->Put(leveldb::WriteOptions(), key, countString);
+
+        /**f^2 - (f - 1)^2 = 2f - 1 */
+        double delta = 2.0 * count - 1;
+        if (flag == 0) {
+            mFreqSquare_ += delta;
+            mFreqSizeSquare_ += delta * chunkSize * chunkSize;
+        } else {
+            cFreqSquare_ += delta;
+            cFreqSizeSquare_ += delta * chunkSize * chunkSize;
+        }
+    }
+
+    if (timeSeriesFp_ != NULL) {
+        if (flag == 0) {
+            UpdateFreqHist(mFreqHist_, mFreqLogSum_, count);
+        } else {
+            UpdateFreqHist(cFreqHist_, cFreqLogSum_, count);
+            /**the ciphertext of a chunk is counted after its plaintext */
+            if (TIMESERIES_INTERVAL != 0 && cLogicalChunks_ % TIMESERIES_INTERVAL == 0) {
+                EmitTimeSeries();
+            }
+        }
+    }
+}
+
+/// \brief update the frequency-of-frequency histogram after a key reaches a new count
+///
+/// \param hist - the histogram
+/// \param freqLogSum - sum of f * log2(f)
+/// \param count - the new count of the key
+void Simulator::UpdateFreqHist(std::vector<uint64_t>& hist, double& freqLogSum,
+    uint64_t const count) {
+    if (count >= hist.size()) {
+        hist.resize(std::max(count + 1, static_cast<uint64_t>(hist.size() * 2)), 0);
+    }
+    if (count > 1) {
+        hist[count - 1]--;
+        freqLogSum -= (count - 1) * log2(static_cast<double>(count - 1));
+    }
+    hist[count]++;
+    freqLogSum += count * log2(static_cast<double>(count));
+}
+
+/// \brief compute KLD to the uniform distribution: log2(U) - H
+///
+/// \param uniqueNum - the number of unique chunks
+/// \param logicalNum - the number of logical chunks
+/// \param freqLogSum - sum of f * log2(f)
+/// \return double - the KL divergence
+double Simulator::CalKLD(uint64_t uniqueNum, uint64_t logicalNum, double freqLogSum) {
+    if (uniqueNum == 0 || logicalNum == 0) {
+        return 0;
     }
+    /**H = log2(N) - sum(f * log2(f)) / N */
+    double entropy = log2(static_cast<double>(logicalNum)) - freqLogSum / logicalNum;
+    return log2(static_cast<double>(uniqueNum)) - entropy;
+}
+
+/// \brief Set the output of time series, must be called before processing
+///
+/// \param fileName - the output file name, the time series goes to <fileName>.series.csv
+void Simulator::SetTimeSeriesOutput(std::string const fileName) {
+    if (!TIMESERIES_ENABLE) {
+        return ;
+    }
+    if (HLL_COUNT_ENABLE || EXTERNAL_COUNT_ENABLE) {
+        fprintf(stderr, "time series needs the exact counts in leveldb, disable it\n");
+        return ;
+    }
+    timeSeriesName_ = fileName;
+    std::string name = fileName + ".series.csv";
+    timeSeriesFp_ = fopen(name.c_str(), "w");
+    if (timeSeriesFp_ == NULL) {
+        fprintf(stderr, "fail to open the time series: %s, %s:%d\n", name.c_str(),
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    fprintf(timeSeriesFp_, "logical_chunks,unique_plain,unique_cipher,kld_plain,kld_cipher,"
+        "blowup_chunk,blowup_size\n");
+}
+
+/// \brief Set the file of cumulative HyperLogLog state, each backup is merged into it
+/// (HLL_COUNT_ENABLE), must be called before processing
+///
+/// \param fileName - the state file, removed to restart the cumulative estimation
+void Simulator::SetCumulativeState(std::string const fileName) {
+    if (!HLL_COUNT_ENABLE) {
+        fprintf(stderr, "the cumulative state needs HyperLogLog counting, ignore it\n");
+        return ;
+    }
+    hllStateName_ = fileName;
+}
+
+/// \brief append a row of the current KLD, blowup and unique counts to the time series
+///
+void Simulator::EmitTimeSeries() {
+    if (timeSeriesFp_ == NULL || cLogicalChunks_ == lastEmitChunks_ || mUniqueChunks_ == 0) {
+        return ;
+    }
+    lastEmitChunks_ = cLogicalChunks_;
+    fprintf(timeSeriesFp_, "%lu,%lu,%lu,%.6lf,%.6lf,%.6lf,%.6lf\n", cLogicalChunks_,
+        mUniqueChunks_, cUniqueChunks_,
+        CalKLD(mUniqueChunks_, mLogicalChunks_, mFreqLogSum_),
+        CalKLD(cUniqueChunks_, cLogicalChunks_, cFreqLogSum_),
+        static_cast<double>(cUniqueChunks_ - mUniqueChunks_) / mUniqueChunks_,
+        static_cast<double>(cUniqueSize_ - mUniqueSize_) / mUniqueSize_);
+}
+
+/// \brief print the frequency-of-frequency histogram
+///
+/// \param fileName - the output file name
+/// \param hist - the histogram
+void Simulator::PrintFreqHist(std::string const fileName, std::vector<uint64_t>& hist) {
+    FILE* fp = fopen(fileName.c_str(), "w");
+    if (fp == NULL) {
+        fprintf(stderr, "fail to open the histogram output: %s, %s:%d\n", fileName.c_str(),
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    for (size_t i = 1; i < hist.size(); i++) {
+        if (hist[i] != 0) {
+            /**a sampled key stands for 1/rate keys of the same frequency */
+            uint64_t keyNum = SAMPLING_ENABLE ? llround(hist[i] / samplingRate_) : hist[i];
+            fprintf(fp, "%lu\t\t%lu\n", i, keyNum);
+        }
+    }
+    fclose(fp);
 }
 
 /// \brief print the statistic information of this backup
 ///
 /// \param flag - 0:plaintext, 1:ciphertext
 void Simulator::PrintBackupStat() {
+    if (HLL_COUNT_ENABLE) {
+        /**the unique size is estimated by the mean chunk size */
+        mUniqueChunks_ = llround(mHLL_->Estimate());
+        cUniqueChunks_ = llround(cHLL_->Estimate());
+        if (mLogicalChunks_ != 0) {
+            mUniqueSize_ = static_cast<double>(mLogicalSize_) / mLogicalChunks_ * mUniqueChunks_;
+        }
+        if (cLogicalChunks_ != 0) {
+            cUniqueSize_ = static_cast<double>(cLogicalSize_) / cLogicalChunks_ * cUniqueChunks_;
+        }
+    }
+    if (EXTERNAL_COUNT_ENABLE) {
+        /**merge the sorted runs to get the unique stat */
+        mExtCounter_->Finalize(mUniqueChunks_, mUniqueSize_);
+        cExtCounter_->Finalize(cUniqueChunks_, cUniqueSize_);
+        mExtCounter_->GetSquareSum(mFreqSquare_, mFreqSizeSquare_, mSizeSquare_);
+        cExtCounter_->GetSquareSum(cFreqSquare_, cFreqSizeSquare_, cSizeSquare_);
+    }
+
+    SimStat_t stat;
+    GetStat(stat);
+    PrintStat(stat);
+
+    if (SAMPLING_ENABLE) {
+        /**the ratios above are unbiased, scale the absolute numbers */
+        printf("============== Sampling Estimation =========\n");
+        printf("Sampling rate: %lf\n", samplingRate_);
+        printf("Key weight of the frequency files: %lf (the counts of the sampled keys are "
+            "exact, each key stands for 1/rate keys)\n", 1 / samplingRate_);
+        PrintEstimation("Logical original chunks number", mLogicalChunks_, mFreqSquare_);
+        PrintEstimation("Logical original chunks size (GB)", 
+            static_cast<double>(mLogicalSize_) / (B_TO_GB),
+            mFreqSizeSquare_ / (B_TO_GB) / (B_TO_GB));
+        PrintEstimation("Unique original chunks number", mUniqueChunks_, mUniqueChunks_);
+        PrintEstimation("Unique original chunks size (GB)",
+            static_cast<double>(mUniqueSize_) / (B_TO_GB), 
+            mSizeSquare_ / (B_TO_GB) / (B_TO_GB));
+        PrintEstimation("Logical encrypted chunks number", cLogicalChunks_, cFreqSquare_);
+        PrintEstimation("Logical encrypted chunks size (GB)",
+            static_cast<double>(cLogicalSize_) / (B_TO_GB),
+            cFreqSizeSquare_ / (B_TO_GB) / (B_TO_GB));
+        PrintEstimation("Unique encrypted chunks number", cUniqueChunks_, cUniqueChunks_);
+        PrintEstimation("Unique encrypted chunks size (GB)",
+            static_cast<double>(cUniqueSize_) / (B_TO_GB),
+            cSizeSquare_ / (B_TO_GB) / (B_TO_GB));
+    }
+
+    if (HLL_COUNT_ENABLE) {
+        printf("============== HyperLogLog Estimation ======\n");
+        printf("Unique chunks number is estimated, standard error: %lf\n",
+            mHLL_->GetStandardError());
+        if (!hllStateName_.empty()) {
+            PrintCumulativeEstimation();
+        }
+    }
+
+    if (timeSeriesFp_ != NULL) {
+        /**the last row, and the histograms as a compact form of the frequency dumps */
+        EmitTimeSeries();
+        fclose(timeSeriesFp_);
+        timeSeriesFp_ = NULL;
+        printf("============== KL Divergence ===============\n");
+        printf("Original KLD: %.6lf\n", CalKLD(mUniqueChunks_, mLogicalChunks_, mFreqLogSum_));
+        printf("Encrypted KLD: %.6lf\n", CalKLD(cUniqueChunks_, cLogicalChunks_, cFreqLogSum_));
+        PrintFreqHist(timeSeriesName_ + ".pfof", mFreqHist_);
+        PrintFreqHist(timeSeriesName_ + ".cfof", cFreqHist_);
+    }
+}
+
+/// \brief print the statistics, and the storage saving and loss ratios
+///
+/// \param stat - the statistics
+void Simulator::PrintStat(SimStat_t const& stat) {
     printf("============== Original Backup =============\n");
-    printf("Logical original chunks number: %lu\n", mLogicalChunks_);
+    printf("Logical original chunks number: %lu\n", stat.logicalChunks[0]);
     printf("Logical original chunks size: %lfGB\n", 
-       static_cast<double>(mLogicalSize_) / (B_TO_GB));
-    printf("Unique original chunks number: %lu\n", mUniqueChunks_);
+       static_cast<double>(stat.logicalSize[0]) / (B_TO_GB));
+    printf("Unique original chunks number: %lu\n", stat.uniqueChunks[0]);
     printf("Unique original chunks size: %lfGB\n",
-       static_cast<double>(mUniqueSize_) / (B_TO_GB));
+       static_cast<double>(stat.uniqueSize[0]) / (B_TO_GB));
 
     printf("============== Encrypted Backup ============\n");
-    printf("Logical encrypted chunks size: %lu\n", cLogicalSize_);
-    printf("Logical encrypted chunks number: %lu\n", cLogicalChunks_);
+    printf("Logical encrypted chunks size: %lu\n", stat.logicalSize[1]);
+    printf("Logical encrypted chunks number: %lu\n", stat.logicalChunks[1]);
     printf("Logical encrypted chunks size: %lfGB\n",
-       static_cast<double>(cLogicalSize_) / (B_TO_GB));
-    printf("Unique encrypted chunks size: %lu\n", cUniqueSize_);
-    printf("Unique encrypted chunks number: %lu\n", cUniqueChunks_);
+       static_cast<double>(stat.logicalSize[1]) / (B_TO_GB));
+    printf("Unique encrypted chunks size: %lu\n", stat.uniqueSize[1]);
+    printf("Unique encrypted chunks number: %lu\n", stat.uniqueChunks[1]);
     printf("Unique encrypted chunks size: %lfGB\n", 
-       static_cast<double>(cUniqueSize_) / (B_TO_GB));
+       static_cast<double>(stat.uniqueSize[1]) / (B_TO_GB));
 
     printf("============== Storage Saving Ratio ========\n");
     double oriSaveSizeRatio = 
-        static_cast<double>(mLogicalSize_ - mUniqueSize_) / mLogicalSize_;
+        static_cast<double>(stat.logicalSize[0] - stat.uniqueSize[0]) / stat.logicalSize[0];
     printf("Original Storage Saving (Size): %lf\n", oriSaveSizeRatio);
 
     double oriSaveChunkRatio = 
-        static_cast<double>(mLogicalChunks_ - mUniqueChunks_) / mLogicalChunks_;
+        static_cast<double>(stat.logicalChunks[0] - stat.uniqueChunks[0]) / stat.logicalChunks[0];
     printf("Original Storage Saving (Chunk): %lf\n", oriSaveChunkRatio);
 
     double encryptSaveSizeRatio = 
-        static_cast<double>(cLogicalSize_ - cUniqueSize_) / cLogicalSize_;
+        static_cast<double>(stat.logicalSize[1] - stat.uniqueSize[1]) / stat.logicalSize[1];
     printf("Encrypted Storage Saving (Size): %lf\n", encryptSaveSizeRatio);
 
     double encryptSaveChunkRatio = 
-        static_cast<double>(cLogicalChunks_ - cUniqueChunks_) / cLogicalChunks_;
+        static_cast<double>(stat.logicalChunks[1] - stat.uniqueChunks[1]) / stat.logicalChunks[1];
     printf("Encrypted Storage Saving (Chunk): %lf\n", encryptSaveChunkRatio);
 
     printf("============== Comparsion Loss ==============\n");
     printf("Storage Blowup (Size): %.6lf\n",
-       static_cast<double>(cUniqueSize_ - mUniqueSize_) / mUniqueSize_);
+       static_cast<double>(stat.uniqueSize[1] - stat.uniqueSize[0]) / stat.uniqueSize[0]);
     printf("Storage Blowup (Chunk): %.6lf\n",
-       static_cast<double>(cUniqueChunks_ - mUniqueChunks_) / mUniqueChunks_);
+       static_cast<double>(stat.uniqueChunks[1] - stat.uniqueChunks[0]) / stat.uniqueChunks[0]);
     printf("Storage Ration Loss Rate (Size): %.6lf\n",
        (oriSaveSizeRatio - encryptSaveSizeRatio) / oriSaveSizeRatio);
     printf("Storage Ration Loss Rate (Chunk): %.6lf\n",
-       (oriSaveChunkRatio - encryptSaveChunkRatio) / oriSaveChunkRatio);    
+       (oriSaveChunkRatio - encryptSaveChunkRatio) / oriSaveChunkRatio);
+}
+
+/// \brief merge this backup into the cumulative HyperLogLog state and print it
+///
+void Simulator::PrintCumulativeEstimation() {
+    /**the state: backup number, logical stat, and the registers of both sides */
+    uint64_t stat[5] = {0};
+    HyperLogLog mCumulative(HLL_PRECISION);
+    HyperLogLog cCumulative(HLL_PRECISION);
+    FILE* fp = fopen(hllStateName_.c_str(), "rb");
+    if (fp != NULL) {
+        if (fread(stat, sizeof(uint64_t), 5, fp) != 5 || !mCumulative.Load(fp) ||
+            !cCumulative.Load(fp)) {
+            fprintf(stderr, "the cumulative state is broken, restart it: %s\n",
+                hllStateName_.c_str());
+            memset(stat, 0, sizeof(stat));
+            mCumulative.Clear();
+            cCumulative.Clear();
+        }
+        fclose(fp);
+    }
+
+    stat[0]++;
+    stat[1] += mLogicalChunks_;
+    stat[2] += mLogicalSize_;
+    stat[3] += cLogicalChunks_;
+    stat[4] += cLogicalSize_;
+    mCumulative.Merge(*mHLL_);
+    cCumulative.Merge(*cHLL_);
+
+    fp = fopen(hllStateName_.c_str(), "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "fail to save the cumulative state: %s, %s:%d\n",
+            hllStateName_.c_str(), FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    fwrite(stat, sizeof(uint64_t), 5, fp);
+    mCumulative.Save(fp);
+    cCumulative.Save(fp);
+    fclose(fp);
+
+    double mUnique = mCumulative.Estimate();
+    double cUnique = cCumulative.Estimate();
+    printf("Cumulative state: %s\n", hllStateName_.c_str());
+    printf("Cumulative backup number: %lu\n", stat[0]);
+    printf("Cumulative logical original chunks number: %lu\n", stat[1]);
+    printf("Cumulative unique original chunks number: %.0lf\n", mUnique);
+    printf("Cumulative logical encrypted chunks number: %lu\n", stat[3]);
+    printf("Cumulative unique encrypted chunks number: %.0lf\n", cUnique);
+    printf("Cumulative Original Storage Saving (Chunk): %lf\n", 1 - mUnique / stat[1]);
+    printf("Cumulative Encrypted Storage Saving (Chunk): %lf\n", 1 - cUnique / stat[3]);
+    printf("Cumulative Storage Blowup (Chunk): %.6lf\n", (cUnique - mUnique) / mUnique);
+}
+
+/// \brief print the scaled estimation with confidence bounds
+///
+/// \param name - the name of the statistic
+/// \param sampleValue - the value in the sample
+/// \param squareSum - the sum of squares of per-key contributions
+void Simulator::PrintEstimation(const char* name, double sampleValue, double squareSum) {
+    /**Horvitz-Thompson estimator: X / p, Var = (1 - p) / p^2 * sum(x_i^2)
+     * (ciphertexts are treated as independent keys, which is approximate)
+     */
+    double estimation = sampleValue / samplingRate_;
+    if (HLL_COUNT_ENABLE) {
+        /**the square sums are not counted in HyperLogLog mode */
+        printf("Estimated %s: %lf (no bounds in HyperLogLog mode)\n", name, estimation);
+        return ;
+    }
+    double deviation = sqrt((1 - samplingRate_) * squareSum) / samplingRate_;
+    double lowerBound = estimation - SAMPLING_Z_SCORE * deviation;
+    if (lowerBound < sampleValue) {
+        lowerBound = sampleValue;
+    }
+    printf("Estimated %s: %lf [%lf, %lf]\n", name, estimation, lowerBound,
+        estimation + SAMPLING_Z_SCORE * deviation);
 }
 
 
@@ -226,30 +643,157 @@ void Simulator::PrintChunkFreq(std::string const fileName, size_t FpLength,
         exit(1);
     }
 
+    if (HLL_COUNT_ENABLE) {
+        fprintf(stderr, "no per-chunk frequency in HyperLogLog counting mode\n");
+        return ;
+    }
+
     fp = fopen(name.c_str(), "w");
-    leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
+    if (EXTERNAL_COUNT_ENABLE) {
+        /**stream the merged run in the key order */
+        OutputSink* sink = new OutputSink(fp);
+        if (flag == 0) {
+            mExtCounter_->PrintFreq(sink, FpLength);
+        } else {
+            cExtCounter_->PrintFreq(sink, FpLength);
+        }
+        delete sink;
+        fclose(fp);
+        return ;
+    }
 
-    size_t i = 0;   
+    OutputSink* sink = new OutputSink(fp);
+    leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
 
     /**iterate in the leveldb */
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string keyStr = it->key().ToString();
-        std::string valueStr = it->value().ToString();
-
-        for (i = 0; i < FpLength - 1; i++) {
-            fprintf(fp, "%02x:", (uint8_t)keyStr.c_str()[i]);
-        }
-        if (i == FpLength - 1) {
-            fprintf(fp, "%02x\t\t", (unsigned char)keyStr.c_str()[i]);
-        }
-
-        fprintf(fp, "%d\n", atoi(valueStr.c_str()));
+        sink->WriteFreq((const uint8_t*)it->key().data(), std::min(FpLength, it->key().size()),
+            strtoull(it->value().ToString().c_str(), NULL, 10));
     }
+    delete sink;
     fclose(fp);
     it->~Iterator();
     free(it);
 }
 
+/// \brief create the heavy-hitter trackers, updated in CountChunk
+///
+void Simulator::InitHeavyHitter() {
+    if (!HEAVY_HITTER_ENABLE) {
+        return ;
+    }
+    fprintf(stderr, "Track the top-%d heavy hitters, capacity: %d\n", HEAVY_HITTER_TOP_K,
+        HEAVY_HITTER_CAPACITY);
+    mHeavyHitter_ = new SpaceSaving(HEAVY_HITTER_CAPACITY);
+    cHeavyHitter_ = new SpaceSaving(HEAVY_HITTER_CAPACITY);
+}
+
+/// \brief print the top-k chunks with error bounds
+///
+/// \param fileName - the output file name
+/// \param FpLength - the length of message
+/// \param flag - 0: original backup 1: encrypted backup
+void Simulator::PrintHeavyHitter(std::string const fileName, size_t FpLength,
+    bool const flag) {
+    if (mHeavyHitter_ == NULL) {
+        return ;
+    }
+    std::string name = fileName + ((flag == 0) ? ".phh" : ".chh");
+    FILE* fp = fopen(name.c_str(), "w");
+    if (fp == NULL) {
+        fprintf(stderr, "fail to open the heavy-hitter output: %s, %s:%d\n", name.c_str(),
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    if (flag == 0) {
+        mHeavyHitter_->PrintTopK(fp, HEAVY_HITTER_TOP_K, FpLength);
+    } else {
+        cHeavyHitter_->PrintTopK(fp, HEAVY_HITTER_TOP_K, FpLength);
+    }
+    fclose(fp);
+}
+
+/// \brief feed a parsed fingerprint record: apply the sampling and partition, then
+/// process it
+///
+/// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+/// \param chunkSize - the chunk size
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void Simulator::FeedRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut) {
+    if (!IsSelected(chunkFp)) {
+        return ;
+    }
+    ProcessRecord(chunkFp, chunkSize, fpOut);
+}
+
+/// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+///
+/// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+/// \param chunkSize - the chunk size
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void Simulator::ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut) {
+    fprintf(stderr, "this simulator cannot process the records from memory, %s:%d\n",
+        FILE_NAME, CURRENT_LIEN);
+    exit(1);
+}
+
+/// \brief print the stat, and the frequency and heavy-hitter files
+///
+/// \param outputFileName - the output file name
+void Simulator::PrintResult(std::string const outputFileName) {
+    /**print out the stat information */
+    PrintBackupStat();
+    if (partitionNum_ > 1) {
+        PrintPartialStat(outputFileName);
+    }
+
+    /**print out the frequency information */
+    PrintChunkFreq(outputFileName, FP_SIZE, 0);
+    PrintChunkFreq(outputFileName, cipherFpLen_, 1);
+    PrintHeavyHitter(outputFileName, FP_SIZE, 0);
+    PrintHeavyHitter(outputFileName, cipherFpLen_, 1);
+}
+
+/// \brief Get the statistics (the unique stat of external/HyperLogLog counting is
+/// only ready after PrintBackupStat)
+///
+/// \param stat - the statistics <return>
+void Simulator::GetStat(SimStat_t& stat) {
+    stat.logicalChunks[0] = mLogicalChunks_;
+    stat.logicalChunks[1] = cLogicalChunks_;
+    stat.uniqueChunks[0] = mUniqueChunks_;
+    stat.uniqueChunks[1] = cUniqueChunks_;
+    stat.logicalSize[0] = mLogicalSize_;
+    stat.logicalSize[1] = cLogicalSize_;
+    stat.uniqueSize[0] = mUniqueSize_;
+    stat.uniqueSize[1] = cUniqueSize_;
+}
+
+/// \brief Get a snapshot of the chunk frequencies (leveldb counting only)
+///
+/// \param flag - 0: original backup 1: encrypted backup
+/// \param freqList - the list of (fingerprint, frequency) <return>
+void Simulator::GetFreqSnapshot(bool const flag,
+    std::vector<std::pair<std::string, uint64_t> >& freqList) {
+    freqList.clear();
+    if (HLL_COUNT_ENABLE || EXTERNAL_COUNT_ENABLE) {
+        fprintf(stderr, "the frequency snapshot needs the counts in leveldb\n");
+        return ;
+    }
+    leveldb::DB* db = (flag == 0) ? mdb_ : cdb_;
+    leveldb::Iterator* it = db->NewIterator(leveldb::ReadOptions());
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        /**the key is stored with the tailing '\0' */
+        std::string keyStr = it->key().ToString();
+        if (!keyStr.empty()) {
+            keyStr.resize(keyStr.size() - 1);
+        }
+        freqList.push_back(std::make_pair(keyStr,
+            static_cast<uint64_t>(atol(it->value().ToString().c_str()))));
+    }
+    delete it;
+}
+
 /// \brief print cipher chunk info
 ///
 /// \param plaintext - plaintext
@@ -260,23 +804,50 @@ void Simulator::PrintChunkFreq(std::string const fileName, size_t FpLength,
 /// \param fpOut - thefile pointer of output file
 void Simulator::PrintCipher(uint8_t* const plaintext, size_t plainLen, uint8_t* const cipher,
     size_t cipherLen, uint64_t const chunkSize, FILE* fpOut) {
+    if (cipherSink_ == NULL || cipherSink_->GetFile() != fpOut) {
+        /**the output is not opened by OpenCipherOutput */
+        if (cipherSink_ != NULL) {
+            delete cipherSink_;
+        }
+        cipherSink_ = new OutputSink(fpOut);
+    }
     
     /**print the encrypted message */
     if (FULL_CIPHER_TEXT) {
         /**print full cipher text: hash + state */
-        for (size_t i = 0; i < cipherLen - 1; i++) {
-            fprintf(fpOut, "%02x:", cipher[i]);
-        }
-        fprintf(fpOut, "%02x", cipher[cipherLen - 1]);
-    
+        cipherSink_->WriteCipher(cipher, cipherLen, chunkSize);
     } else {
-        for (size_t i = 0; i < cipherLen - plainLen - 1; i++) {
-            fprintf(fpOut, "%02x:", cipher[plainLen + i]);
-        }
-        fprintf(fpOut, "%02x", cipher[cipherLen - 1]);
+        cipherSink_->WriteCipher(cipher + plainLen, cipherLen - plainLen, chunkSize);
+    }
+}
+
+/// \brief open the output of ciphertext, printed via a buffered sink
+///
+/// \param fileName - the output file name
+/// \return FILE* - the output file (NULL: fail)
+FILE* Simulator::OpenCipherOutput(std::string const fileName) {
+    FILE* fpOut = fopen(fileName.c_str(), "w");
+    if (fpOut == NULL) {
+        fprintf(stderr, "fail to open the output file: %s, %s:%d\n", fileName.c_str(),
+            FILE_NAME, CURRENT_LIEN);
+        return NULL;
+    }
+    if (cipherSink_ != NULL) {
+        delete cipherSink_;
+    }
+    cipherSink_ = new OutputSink(fpOut);
+    return fpOut;
+}
+
+/// \brief flush the buffered ciphertext and close the output
+///
+/// \param fpOut - the output file
+void Simulator::CloseCipherOutput(FILE* fpOut) {
+    if (cipherSink_ != NULL && cipherSink_->GetFile() == fpOut) {
+        delete cipherSink_;
+        cipherSink_ = NULL;
     }
-        
-    fprintf(fpOut, "\t\t%lu\t\t10\n", chunkSize);
+    fclose(fpOut);
 }
 
 /// \brief check whether a given chunk fingerprint is unique or not
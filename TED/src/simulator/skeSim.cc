@@ -8,6 +8,7 @@
 ///
 
 #include "../../include/skeSim.h"
+#include "../../include/simDriver.h"
 
 
 /// \brief Generate random encryption key (SKE)
@@ -24,74 +25,14 @@ void SKESim::SKEKeyGen() {
 /// \param outputFileName - the output file name 
 void SKESim::ProcessHashFile(std::string const inputFileName,
     std::string const outputFileName) {
-    
-    /**for random key generation */
-    srand(time(NULL));
-    
-    /**assume size of input file is large than 32 bytes */
-    char readBuffer[256];
-    char* readFlag;
-    char* item;
-    uint8_t chunkFp[FP_SIZE + 1];
-    memset(chunkFp, 0 , FP_SIZE + 1);
-
-    /**init the input file and output file */
-    FILE* fpIn = NULL;
-    FILE* fpOut = NULL;
-    if ((fpIn = fopen(inputFileName.c_str(), "r")) != NULL) {
-        fprintf(stderr, "Open data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    } else {
-        fprintf(stderr, "Open data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    }
-
-    fpOut = fopen(outputFileName.c_str(), "w");
-    
-    /**simulate the data stream come from here */
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
-        /**read chunk information into chunk buffer */    
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < FP_SIZE); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            // fprintf(stderr, "%02x:", chunkFp[index]);
-            item = strtok(NULL, ":\t\n ");
-        }
-        chunkFp[FP_SIZE] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
-
-        /**count the chunk information in global leveldb */
-        CountChunk(chunkFp, FP_SIZE + 1, size, 0);
-
-        /**encrypt the chunk with the unique key via AES-256*/
-        SKEKeyGen();
-        uint8_t cipher[FP_SIZE + sizeof(int)+ 1];
-        memset(cipher, 0, FP_SIZE + sizeof(int) + 1); 
-
-        /**padding with 0*/
-        uint8_t alignedCipher[16] = {0};
-        uint8_t alignedChunkFp[16] = {0};
-        memcpy(alignedChunkFp, chunkFp, FP_SIZE + 1);
-
-        cryptoObj_->encryptWithKey(alignedChunkFp, 16, encryptKey_, alignedCipher);
-
-        memcpy(cipher, alignedCipher, FP_SIZE + 1);
-
-        /**count the encrypted chunk */
-        CountChunk(cipher, FP_SIZE + 1, size, 1);
-
-        /**print the message ciphertext */
-        PrintCipher(chunkFp, FP_SIZE, cipher, FP_SIZE, size, fpOut);
-    }
-    fclose(fpIn);
-    fclose(fpOut);
-
-    /**print out the stat information */
-    PrintBackupStat();
-
-    /**print out the frequency information */
-    PrintChunkFreq(outputFileName, FP_SIZE, 0);
-    PrintChunkFreq(outputFileName, FP_SIZE, 1);
+    SimDriver<SKESim>::ProcessHashFile(*this, inputFileName, outputFileName);
+}
 
-}
\ No newline at end of file
+/// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+///
+/// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+/// \param chunkSize - the chunk size
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void SKESim::ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut) {
+    SimDriver<SKESim>::ProcessRecord(*this, chunkFp, chunkSize, fpOut);
+}
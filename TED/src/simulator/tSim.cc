@@ -14,6 +14,7 @@
 /// \param chunkSize - chunk size
 /// \param key - generated encryption key <return>
 #include "../../include/tSim.h"
+#include "../../include/simDriver.h"
 
 void TSim::ThresholdKeyGen(uint8_t* const chunkHash, size_t chunkHashLen,
     uint64_t const chunkSize,uint8_t key[sizeof(int)]) {
@@ -62,74 +63,14 @@ void TSim::ThresholdKeyGen(uint8_t* const chunkHash, size_t chunkHashLen,
 /// \param outputFileName - the output file name
 void TSim::ProcessHashFile(std::string const inputFileName, 
     std::string const outputFileName) {
-    
-    /**assume size of input file is large than 32 bytes */
-    char readBuffer[256];
-    char* readFlag;
-    char* item;
-    uint8_t chunkFp[FP_SIZE + 1];
-    memset(chunkFp, 0, FP_SIZE + 1);
-
-    /**init the input file and output file */
-    FILE* fpIn = NULL;
-    FILE* fpOut = NULL;
-    
-    if ((fpIn = fopen(inputFileName.c_str(), "r")) != NULL) {
-        fprintf(stderr, "Open data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    } else {
-        fprintf(stderr, "Open data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    }
-
-    fpOut = fopen(outputFileName.c_str(), "w");
-
-    /**encryption key */
-    uint8_t key[sizeof(int)];
-
-    /**simulate the data stream come from here */
-
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
-
-        /**read chunk information into chunk buffer */
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < FP_SIZE); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            item = strtok(NULL, ":\t\n ");
-        }
-        chunkFp[FP_SIZE] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
-
-        /**count the chunk information in global leveldb */
-        CountChunk(chunkFp, FP_SIZE + 1, size, 0);
-
-        /**update the state in in-memory hash-table */
-        TECUpdateState(chunkFp, FP_SIZE + 1, size);
-
-        /**key generation */
-        ThresholdKeyGen(chunkFp, FP_SIZE + 1, size, key);
-
-        /**encryption (simulation) */
-        uint8_t cipher[FP_SIZE + sizeof(int) + 1];
-
-        SimTECEncrypt(chunkFp, FP_SIZE, key, sizeof(key), cipher);
-
-        uint64_t chunkSize = atol((const char*)item);
-
-        /**count the encrypted chunk */
-        CountChunk(cipher, FP_SIZE + sizeof(key) + 1, chunkSize, 1);
-
-        /**Print the message ciphertext */
-        PrintCipher(chunkFp, FP_SIZE, cipher, FP_SIZE + sizeof(key), chunkSize, fpOut);
-    }
-    fclose(fpIn);
-    fclose(fpOut);
-
-    /**print out the stat information */
-    PrintBackupStat();
+    SimDriver<TSim>::ProcessHashFile(*this, inputFileName, outputFileName);
+}
 
-    /**print out the frequency distribution */
-    PrintChunkFreq(outputFileName, FP_SIZE, 0);
-    PrintChunkFreq(outputFileName, FP_SIZE + sizeof(key), 1);
-}
\ No newline at end of file
+/// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+///
+/// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+/// \param chunkSize - the chunk size
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void TSim::ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut) {
+    SimDriver<TSim>::ProcessRecord(*this, chunkFp, chunkSize, fpOut);
+}
@@ -8,6 +8,7 @@
 ///
 
 #include "../../include/tecSim.h"
+#include "../../include/simDriver.h"
 
 /// \brief process an input hash file for encryption
 ///
@@ -15,95 +16,33 @@
 /// \param outputFileName - the output file name
 void TECSim::ProcessHashFile(std::string const inputFileName, 
     std::string const outputFileName) {
-    
-    /**assume size of input file is large than 32 bytes */
-    char readBuffer[256];
-    char* readFlag;
-    char* item;
-    uint8_t chunkFp[FP_SIZE + 1];
-    memset(chunkFp, 0 , FP_SIZE + 1);
-
-    /**init the input file and output file */
-    FILE* fpIn = NULL;
-    FILE* fpOut = NULL;
-    if ((fpIn = fopen(inputFileName.c_str(), "r")) != NULL) {
-        fprintf(stderr, "Open data file success, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    } else {
-        fprintf(stderr, "Open data file fails, %s:%d\n", FILE_NAME, CURRENT_LIEN);
-    }
+    SimDriver<TECSim>::ProcessHashFile(*this, inputFileName, outputFileName);
+}
 
-    fpOut = fopen(outputFileName.c_str(), "w");
-    
-    /**encryption key */
-    uint8_t key[32]; 
-
-    /**simulate the data stream come from here */
-    while ((readFlag = fgets(readBuffer, sizeof(readBuffer), fpIn)) != NULL) {
-        /**read chunk information into chunk buffer */    
-        item = strtok(readBuffer, ":\t\n ");
-        size_t index = 0;
-        for (index = 0; (item != NULL) && (index < FP_SIZE); index++) {
-            chunkFp[index] = strtol(item, NULL, 16);
-            // fprintf(stderr, "%02x:", chunkFp[index]);
-            item = strtok(NULL, ":\t\n ");
-        }
-        chunkFp[FP_SIZE] = '\0';
-
-        /**increment chunk size */
-        uint64_t size = atol((const char*)item);
-
-        /**count the chunk information in global leveldb */
-        CountChunk(chunkFp, FP_SIZE + 1, size, 0);
-
-        /**update the state in in-memory hash-table*/
-        TECUpdateState(chunkFp, FP_SIZE + 1, size);
-
-        /**key generation */
-        KeyGen(chunkFp, FP_SIZE + 1, size, key);
-
-        /**encryption (simulation) */
-        uint8_t cipher[FP_SIZE + 1];
-
-        // SimTECEncrypt(chunkFp, FP_SIZE, key, sizeof(key), cipher);
-        uint8_t alignedCipher[16] = {0};
-        uint8_t alignedChunkFp[16] = {0};
-        memcpy(alignedChunkFp, chunkFp, FP_SIZE);
-        cryptoObj_->encryptWithKey(alignedChunkFp, 16, key, alignedCipher);
-        memcpy(cipher, alignedCipher, FP_SIZE);
-        cipher[FP_SIZE] = '\0';
-
-        uint64_t chunkSize = atol((const char*)item);
-        /**count the encrypted chunk */
-        CountChunk(cipher, FP_SIZE + 1, chunkSize, 1);
-
-        /**print the message ciphertext */
-        PrintCipher(chunkFp, FP_SIZE, cipher, FP_SIZE, chunkSize, fpOut);
-
-        // CheckUniqueTable(chunkFp, FP_SIZE + 1);
-
-        if (SKETCH_ENABLE) {
-            if (SEGMENT_ENABLE) {
-                if (currentUniqueChunk_ >= ACCURACY * SKETCH_WIDTH) {
-                    fprintf(stderr,"current unique chunk number: %lu\n", currentUniqueChunk_);
-                    fprintf(stderr, "start to clean up the sketch,  after receiving %d * SKETCH_WIDTH\n",
-                        ACCURACY);
-                    cmSketch_->ClearUp();
-                    uniqueKeySet_.clear();
-                    currentUniqueChunk_ = 0;
-                }
-            }    
-        }
+/// \brief process a parsed fingerprint record, the per-chunk path of ProcessHashFile
+///
+/// \param chunkFp - the chunk fingerprint (FP_SIZE + 1, ends with '\0')
+/// \param chunkSize - the chunk size
+/// \param fpOut - the output of ciphertext (NULL: not print)
+void TECSim::ProcessRecord(uint8_t* const chunkFp, uint64_t const chunkSize, FILE* fpOut) {
+    SimDriver<TECSim>::ProcessRecord(*this, chunkFp, chunkSize, fpOut);
+}
 
+/// \brief rotate the sketch window after enough unique chunks (SEGMENT_ENABLE)
+///
+void TECSim::AfterRecord() {
+    if (SKETCH_ENABLE) {
+        if (SEGMENT_ENABLE) {
+            if (currentUniqueChunk_ >= ACCURACY * SKETCH_WIDTH / SKETCH_WINDOW_NUM) {
+                fprintf(stderr,"current unique chunk number: %lu\n", currentUniqueChunk_);
+                fprintf(stderr, "start to rotate the sketch window, after receiving %d * SKETCH_WIDTH / %d\n",
+                    ACCURACY, SKETCH_WINDOW_NUM);
+                /**the oldest window ages out lazily, no full clear */
+                cmSketch_->Rotate();
+                currentUniqueChunk_ = 0;
+            }
+        }    
     }
-    fclose(fpIn);
-    fclose(fpOut);
-
-    /**print out the stat information */
-    PrintBackupStat();
-
-    /**print out the frequency information */
-    PrintChunkFreq(outputFileName, FP_SIZE, 0);
-    PrintChunkFreq(outputFileName, FP_SIZE, 1);
 }
 
 /// \brief update the state according to the incoming chunk
@@ -117,7 +56,11 @@ void TECSim::TECUpdateState(uint8_t* const chunkHash, size_t chunkHashLen, uint6
 
     if (SKETCH_ENABLE) {
         /** using sketch */
-        cmSketch_->Update(chunkHash, chunkHashLen, 1);
+        uint32_t windowFreq = cmSketch_->Update(chunkHash, chunkHashLen, 1);
+        if (SEGMENT_ENABLE && windowFreq == 1) {
+            /**the first appearance in current window */
+            currentUniqueChunk_++;
+        }
         
     } else {
         /** using hashtale */
@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <limits>
 #include <ctime>
+#include <string.h>
 
 using namespace std;
 
@@ -19,7 +20,8 @@ using namespace std;
 ///
 /// \param width 
 /// \param depth 
-CountMinSketch::CountMinSketch(uint32_t width, uint32_t depth) {
+/// \param windowNum - the number of sub-sketches in the sliding window (1: disable)
+CountMinSketch::CountMinSketch(uint32_t width, uint32_t depth, uint32_t windowNum) {
     // if (!(0.009 <= eps && eps < 1)) {
     //     fprintf(stderr, "eps must be in this range: [0.01, 1]\n");
     //     exit(EXIT_FAILURE);
@@ -36,13 +38,28 @@ CountMinSketch::CountMinSketch(uint32_t width, uint32_t depth) {
 
     total_ = 0;
 
-    /**initialize counter array */
-    counterArray_ = (uint32_t**) malloc(sizeof(uint32_t*) * depth_);
-    size_t i, j;
-    for (i = 0; i < depth_; i++) {
-        counterArray_[i] = (uint32_t*) malloc(sizeof(uint32_t) * width_);
-        for (j = 0; j < width_; j++) {
-            counterArray_[i][j] = 0;
+    windowNum_ = (windowNum == 0) ? 1 : windowNum;
+    currentWindow_ = 0;
+    counterArray_ = NULL;
+    windowCells_ = NULL;
+    windowEpoch_ = NULL;
+    size_t i;
+
+    if (windowNum_ == 1) {
+        /**initialize counter array */
+        counterArray_ = (uint32_t**) malloc(sizeof(uint32_t*) * depth_);
+        for (i = 0; i < depth_; i++) {
+            counterArray_[i] = (uint32_t*) calloc(width_, sizeof(uint32_t));
+        }
+    } else {
+        /**initialize the windows, epoch 0 of cells is invalid for all windows */
+        fprintf(stderr, "Window number in sketch: %u.\n", windowNum_);
+        windowCells_ = (uint64_t**) malloc(sizeof(uint64_t*) * windowNum_);
+        windowEpoch_ = (uint64_t*) malloc(sizeof(uint64_t) * windowNum_);
+        for (i = 0; i < windowNum_; i++) {
+            windowCells_[i] = (uint64_t*) calloc(static_cast<size_t>(width_) * depth_, 
+                sizeof(uint64_t));
+            windowEpoch_[i] = 1;
         }
     }
 
@@ -72,10 +89,28 @@ uint32_t CountMinSketch::Estimate(uint8_t* const chunkHash, size_t chunkHashLen)
     uint32_t hashVal = 0;
     size_t j = 0;
     size_t pos = 0;
+    if (windowNum_ == 1) {
+        for (j = 0; j < depth_; j++) {
+            MurmurHash3_x86_32(chunkHash, chunkHashLen, hashArray_[j][0], &hashVal);
+            pos = hashVal % width_;
+            minVal = min(minVal, counterArray_[j][pos]);
+        }
+        return minVal;
+    }
+
+    /**window mode: sum the valid cells over all windows */
+    size_t w = 0;
     for (j = 0; j < depth_; j++) {
         MurmurHash3_x86_32(chunkHash, chunkHashLen, hashArray_[j][0], &hashVal);
-        pos = hashVal % width_;
-        minVal = min(minVal, counterArray_[j][pos]);
+        pos = j * width_ + hashVal % width_;
+        uint32_t sum = 0;
+        for (w = 0; w < windowNum_; w++) {
+            uint64_t cell = windowCells_[w][pos];
+            if ((cell >> 32) == windowEpoch_[w]) {
+                sum += static_cast<uint32_t>(cell);
+            }
+        }
+        minVal = min(minVal, sum);
     }
     return minVal;
 }
@@ -112,10 +147,18 @@ CountMinSketch::~CountMinSketch() {
     }
     free(hashArray_);
 
-    for (index = 0; index < depth_; index++) {
-        free(counterArray_[index]);
+    if (windowNum_ == 1) {
+        for (index = 0; index < depth_; index++) {
+            free(counterArray_[index]);
+        }
+        free(counterArray_);
+    } else {
+        for (index = 0; index < windowNum_; index++) {
+            free(windowCells_[index]);
+        }
+        free(windowCells_);
+        free(windowEpoch_);
     }
-    free(counterArray_);
 
 }
 
@@ -131,29 +174,65 @@ uint32_t CountMinSketch::TotalCount() {
 /// \param chunkHash 
 /// \param chunkHashLen 
 /// \param count 
-void CountMinSketch::Update(uint8_t* const chunkHash, size_t chunkHashLen, uint32_t count) {
+/// \return uint32_t - the estimated count after update (in current window if enabled)
+uint32_t CountMinSketch::Update(uint8_t* const chunkHash, size_t chunkHashLen, uint32_t count) {
     total_ += count;
+    uint32_t minVal = numeric_limits<uint32_t>::max();
     uint32_t hashVal = 0;
     size_t j = 0;
     size_t pos = 0;
+    if (windowNum_ == 1) {
+        for (j = 0; j < depth_; j++) {
+           MurmurHash3_x86_32(chunkHash, chunkHashLen, hashArray_[j][0], &hashVal);
+           pos = hashVal % width_;
+           counterArray_[j][pos] += count;
+           minVal = min(minVal, counterArray_[j][pos]);
+        }
+        return minVal;
+    }
+
+    /**window mode: a stale cell (old epoch) is reset when it is touched */
+    uint64_t* cells = windowCells_[currentWindow_];
+    uint64_t epoch = windowEpoch_[currentWindow_];
     for (j = 0; j < depth_; j++) {
-       MurmurHash3_x86_32(chunkHash, chunkHashLen, hashArray_[j][0], &hashVal);
-       pos = hashVal % width_;
-       counterArray_[j][pos] += count;
+        MurmurHash3_x86_32(chunkHash, chunkHashLen, hashArray_[j][0], &hashVal);
+        pos = j * width_ + hashVal % width_;
+        if ((cells[pos] >> 32) != epoch) {
+            cells[pos] = epoch << 32;
+        }
+        cells[pos] += count;
+        minVal = min(minVal, static_cast<uint32_t>(cells[pos]));
     }
+    return minVal;
 }
 
 
 /// \brief clear all buckets in the sketch
 ///
 void CountMinSketch::ClearUp() {
-    size_t indexWidth;
     size_t indexDepth;
-    for (indexWidth = 0; indexWidth < width_; indexWidth++) {
+    if (windowNum_ == 1) {
+        /**clear row by row */
         for (indexDepth = 0; indexDepth < depth_; indexDepth++) {
-            counterArray_[indexDepth][indexWidth] = 0;
+            memset(counterArray_[indexDepth], 0, sizeof(uint32_t) * width_);
         }
+    } else {
+        /**invalidate all windows via epoch */
+        for (indexDepth = 0; indexDepth < windowNum_; indexDepth++) {
+            windowEpoch_[indexDepth]++;
+        }
+    }
+}
+
+/// \brief move to the next window, the oldest window is aged out lazily by epoch
+///
+void CountMinSketch::Rotate() {
+    if (windowNum_ == 1) {
+        ClearUp();
+        return ;
     }
+    currentWindow_ = (currentWindow_ + 1) % windowNum_;
+    windowEpoch_[currentWindow_]++;
 }
 
 /// \brief return the pos of first row
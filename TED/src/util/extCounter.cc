@@ -0,0 +1,355 @@
+/// \file extCounter.cc
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief implement the interfaces of external-memory counter
+/// \version 0.1
+/// \date 2019-10-21
+///
+/// \copyright Copyright (c) 2019
+///
+
+#include "../../include/extCounter.h"
+
+#include <algorithm>
+#include <queue>
+
+using namespace std;
+
+/**the reader of a sorted run in merge */
+struct RunReader {
+    FILE* fp;
+    char* readBuffer;
+    uint8_t* record;
+    bool valid;
+};
+
+/**the comparator of run readers (the min-heap on key, ties by run order) */
+struct RunReaderCompare {
+    vector<RunReader>* readers;
+    size_t keyLen;
+    bool operator()(size_t a, size_t b) const {
+        int ret = memcmp((*readers)[a].record, (*readers)[b].record, keyLen);
+        if (ret != 0) {
+            return ret > 0;
+        }
+        return a > b;
+    }
+};
+
+/// \brief Construct a new Ext Counter object
+///
+/// \param prefix - the prefix of the run files
+/// \param bufferSize - the size of in-memory run buffer
+ExtCounter::ExtCounter(std::string const prefix, size_t bufferSize) {
+    prefix_ = prefix;
+    runBufferSize_ = bufferSize;
+    runBuffer_ = (uint8_t*) malloc(runBufferSize_);
+    if (runBuffer_ == NULL) {
+        fprintf(stderr, "fail to allocate the run buffer, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    mergedName_ = prefix_ + ".merged";
+    fprintf(stderr, "Init the external counter: %s, run buffer: %lfMB.\n", prefix_.c_str(),
+        static_cast<double>(runBufferSize_) / (B_TO_MB));
+}
+
+/// \brief Destroy the Ext Counter object
+///
+ExtCounter::~ExtCounter() {
+    free(runBuffer_);
+    for (auto it = runList_.begin(); it != runList_.end(); it++) {
+        remove(it->c_str());
+    }
+    if (isFinalized_) {
+        remove(mergedName_.c_str());
+    }
+}
+
+/// \brief generate the name of a new run file
+///
+/// \return std::string - the run file name
+std::string ExtCounter::NewRunName() {
+    std::string name = prefix_ + ".run." + to_string(runCount_);
+    runCount_++;
+    return name;
+}
+
+/// \brief add a key to the counter
+///
+/// \param key - the key buffer
+/// \param keyLen - the length of key
+/// \param chunkSize - the size of this chunk
+void ExtCounter::Add(uint8_t* const key, size_t keyLen, uint64_t const chunkSize) {
+    if (isFinalized_) {
+        fprintf(stderr, "the counter has been finalized, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+
+    if (keyLen_ == 0) {
+        keyLen_ = keyLen;
+        memRecordLen_ = keyLen_ + sizeof(uint64_t);
+        diskRecordLen_ = keyLen_ + 2 * sizeof(uint64_t);
+    } else if (keyLen != keyLen_) {
+        fprintf(stderr, "the key length is not fixed (%lu, %lu), %s:%d\n", keyLen_, keyLen,
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+
+    if (runBufferUsed_ + memRecordLen_ > runBufferSize_) {
+        SpillRun();
+    }
+
+    memcpy(runBuffer_ + runBufferUsed_, key, keyLen_);
+    memcpy(runBuffer_ + runBufferUsed_ + keyLen_, &chunkSize, sizeof(uint64_t));
+    runBufferUsed_ += memRecordLen_;
+}
+
+/// \brief sort the in-memory run and write it to disk
+///
+void ExtCounter::SpillRun() {
+    size_t recordNum = runBufferUsed_ / memRecordLen_;
+    if (recordNum == 0) {
+        return ;
+    }
+
+    sortIndex_.resize(recordNum);
+    for (size_t i = 0; i < recordNum; i++) {
+        sortIndex_[i] = i;
+    }
+
+    /**ties are broken by the insert order, keep the size of first appearance */
+    uint8_t* buffer = runBuffer_;
+    size_t keyLen = keyLen_;
+    size_t recordLen = memRecordLen_;
+    sort(sortIndex_.begin(), sortIndex_.end(), [buffer, keyLen, recordLen](uint32_t a, uint32_t b) {
+        int ret = memcmp(buffer + a * recordLen, buffer + b * recordLen, keyLen);
+        if (ret != 0) {
+            return ret < 0;
+        }
+        return a < b;
+    });
+
+    std::string runName = NewRunName();
+    FILE* fpRun = fopen(runName.c_str(), "wb");
+    if (fpRun == NULL) {
+        fprintf(stderr, "fail to open the run file: %s, %s:%d\n", runName.c_str(), FILE_NAME,
+            CURRENT_LIEN);
+        exit(1);
+    }
+    setvbuf(fpRun, NULL, _IOFBF, EXT_READ_BUFFER_SIZE);
+
+    /**aggregate the same keys in this run: key + count + size */
+    uint8_t* prev = NULL;
+    uint64_t count = 0;
+    uint64_t size = 0;
+    for (size_t i = 0; i < recordNum; i++) {
+        uint8_t* current = runBuffer_ + sortIndex_[i] * memRecordLen_;
+        if (prev != NULL && memcmp(prev, current, keyLen_) == 0) {
+            count++;
+            continue;
+        }
+        if (prev != NULL) {
+            fwrite(prev, 1, keyLen_, fpRun);
+            fwrite(&count, sizeof(uint64_t), 1, fpRun);
+            fwrite(&size, sizeof(uint64_t), 1, fpRun);
+        }
+        prev = current;
+        count = 1;
+        memcpy(&size, current + keyLen_, sizeof(uint64_t));
+    }
+    fwrite(prev, 1, keyLen_, fpRun);
+    fwrite(&count, sizeof(uint64_t), 1, fpRun);
+    fwrite(&size, sizeof(uint64_t), 1, fpRun);
+    fclose(fpRun);
+
+    runList_.push_back(runName);
+    runBufferUsed_ = 0;
+}
+
+/// \brief record the statistics of a unique key in final merge
+///
+/// \param count - the count of this key
+/// \param size - the chunk size of this key
+void ExtCounter::AddUniqueStat(uint64_t const count, uint64_t const size) {
+    uniqueChunks_++;
+    uniqueSize_ += size;
+    freqSquare_ += static_cast<double>(count) * count;
+    freqSizeSquare_ += static_cast<double>(count) * count * size * size;
+    sizeSquare_ += static_cast<double>(size) * size;
+}
+
+/// \brief merge a list of sorted runs into one run
+///
+/// \param inputList - the input run files
+/// \param outputName - the output run file
+/// \param countUnique - whether to count the unique statistics
+void ExtCounter::MergeRuns(std::vector<std::string>& inputList, std::string const outputName,
+    bool const countUnique) {
+    vector<RunReader> readers(inputList.size());
+    RunReaderCompare cmp;
+    cmp.readers = &readers;
+    cmp.keyLen = keyLen_;
+    priority_queue<size_t, vector<size_t>, RunReaderCompare> heap(cmp);
+
+    for (size_t i = 0; i < inputList.size(); i++) {
+        readers[i].fp = fopen(inputList[i].c_str(), "rb");
+        if (readers[i].fp == NULL) {
+            fprintf(stderr, "fail to open the run file: %s, %s:%d\n", inputList[i].c_str(),
+                FILE_NAME, CURRENT_LIEN);
+            exit(1);
+        }
+        readers[i].readBuffer = (char*) malloc(EXT_READ_BUFFER_SIZE);
+        setvbuf(readers[i].fp, readers[i].readBuffer, _IOFBF, EXT_READ_BUFFER_SIZE);
+        readers[i].record = (uint8_t*) malloc(diskRecordLen_);
+        readers[i].valid = (fread(readers[i].record, diskRecordLen_, 1, readers[i].fp) == 1);
+        if (readers[i].valid) {
+            heap.push(i);
+        }
+    }
+
+    FILE* fpOut = fopen(outputName.c_str(), "wb");
+    if (fpOut == NULL) {
+        fprintf(stderr, "fail to open the run file: %s, %s:%d\n", outputName.c_str(), FILE_NAME,
+            CURRENT_LIEN);
+        exit(1);
+    }
+    setvbuf(fpOut, NULL, _IOFBF, EXT_READ_BUFFER_SIZE);
+
+    uint8_t current[diskRecordLen_];
+    bool hasCurrent = false;
+    uint64_t count = 0;
+    uint64_t tmpCount = 0;
+    uint64_t size = 0;
+    while (!heap.empty()) {
+        size_t index = heap.top();
+        heap.pop();
+        RunReader& reader = readers[index];
+
+        memcpy(&tmpCount, reader.record + keyLen_, sizeof(uint64_t));
+        if (hasCurrent && memcmp(current, reader.record, keyLen_) == 0) {
+            /**the same key from a later run */
+            count += tmpCount;
+        } else {
+            if (hasCurrent) {
+                memcpy(current + keyLen_, &count, sizeof(uint64_t));
+                fwrite(current, diskRecordLen_, 1, fpOut);
+                if (countUnique) {
+                    memcpy(&size, current + keyLen_ + sizeof(uint64_t), sizeof(uint64_t));
+                    AddUniqueStat(count, size);
+                }
+            }
+            memcpy(current, reader.record, diskRecordLen_);
+            count = tmpCount;
+            hasCurrent = true;
+        }
+
+        reader.valid = (fread(reader.record, diskRecordLen_, 1, reader.fp) == 1);
+        if (reader.valid) {
+            heap.push(index);
+        }
+    }
+
+    if (hasCurrent) {
+        memcpy(current + keyLen_, &count, sizeof(uint64_t));
+        fwrite(current, diskRecordLen_, 1, fpOut);
+        if (countUnique) {
+            memcpy(&size, current + keyLen_ + sizeof(uint64_t), sizeof(uint64_t));
+            AddUniqueStat(count, size);
+        }
+    }
+    fclose(fpOut);
+
+    for (size_t i = 0; i < readers.size(); i++) {
+        fclose(readers[i].fp);
+        free(readers[i].readBuffer);
+        free(readers[i].record);
+        remove(inputList[i].c_str());
+    }
+}
+
+/// \brief merge all runs to get the exact counts, only works for the first call
+///
+/// \param uniqueChunks - the number of unique keys <return>
+/// \param uniqueSize - the size of unique keys <return>
+void ExtCounter::Finalize(uint64_t& uniqueChunks, uint64_t& uniqueSize) {
+    if (isFinalized_) {
+        uniqueChunks = uniqueChunks_;
+        uniqueSize = uniqueSize_;
+        return ;
+    }
+
+    if (keyLen_ != 0) {
+        SpillRun();
+        fprintf(stderr, "%s: merge %lu sorted runs.\n", prefix_.c_str(), runList_.size());
+
+        /**merge in multiple passes if there are too many runs */
+        while (runList_.size() > EXT_MERGE_FAN_IN) {
+            vector<string> nextRunList;
+            for (size_t i = 0; i < runList_.size(); i += EXT_MERGE_FAN_IN) {
+                size_t end = min(runList_.size(), i + EXT_MERGE_FAN_IN);
+                vector<string> inputList(runList_.begin() + i, runList_.begin() + end);
+                string runName = NewRunName();
+                MergeRuns(inputList, runName, false);
+                nextRunList.push_back(runName);
+            }
+            runList_ = nextRunList;
+        }
+
+        MergeRuns(runList_, mergedName_, true);
+    } else {
+        /**no key is added, keep an empty result */
+        FILE* fpOut = fopen(mergedName_.c_str(), "wb");
+        fclose(fpOut);
+    }
+    runList_.clear();
+
+    /**the buffer is not used anymore */
+    free(runBuffer_);
+    runBuffer_ = NULL;
+    isFinalized_ = true;
+
+    uniqueChunks = uniqueChunks_;
+    uniqueSize = uniqueSize_;
+}
+
+/// \brief Get the sum of squares of per-key statistics (after Finalize)
+///
+/// \param freqSquare - sum of count^2 <return>
+/// \param freqSizeSquare - sum of (count * size)^2 <return>
+/// \param sizeSquare - sum of size^2 <return>
+void ExtCounter::GetSquareSum(double& freqSquare, double& freqSizeSquare, double& sizeSquare) {
+    freqSquare = freqSquare_;
+    freqSizeSquare = freqSizeSquare_;
+    sizeSquare = sizeSquare_;
+}
+
+/// \brief print the frequency of each key in the key order
+///
+/// \param sink - the output sink
+/// \param FpLength - the length of key to print
+void ExtCounter::PrintFreq(OutputSink* sink, size_t FpLength) {
+    if (!isFinalized_) {
+        uint64_t uniqueChunks, uniqueSize;
+        Finalize(uniqueChunks, uniqueSize);
+    }
+    if (keyLen_ == 0) {
+        return ;
+    }
+
+    FILE* fpIn = fopen(mergedName_.c_str(), "rb");
+    if (fpIn == NULL) {
+        fprintf(stderr, "fail to open the merged file: %s, %s:%d\n", mergedName_.c_str(),
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    setvbuf(fpIn, NULL, _IOFBF, EXT_READ_BUFFER_SIZE);
+
+    /**keep the same format as the leveldb iteration */
+    size_t printLen = min(FpLength, keyLen_);
+    uint8_t record[diskRecordLen_];
+    uint64_t count;
+    while (fread(record, diskRecordLen_, 1, fpIn) == 1) {
+        memcpy(&count, record + keyLen_, sizeof(uint64_t));
+        sink->WriteFreq(record, printLen, count);
+    }
+    fclose(fpIn);
+}
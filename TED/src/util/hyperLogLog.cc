@@ -0,0 +1,136 @@
+/// \file hyperLogLog.cc
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief implement the interfaces of HyperLogLog cardinality estimator
+/// \version 0.1
+/// \date 2019-10-27
+///
+/// \copyright Copyright (c) 2019
+///
+
+#include "../../include/hyperLogLog.h"
+
+#include <cmath>
+
+/// \brief Construct a new Hyper Log Log object
+///
+/// \param precision - the number of index bits, [4, 18]
+HyperLogLog::HyperLogLog(uint32_t precision) {
+    if (precision < 4 || precision > 18) {
+        fprintf(stderr, "the precision of HyperLogLog should be in [4, 18], %s:%d\n",
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    precision_ = precision;
+    registerNum_ = 1U << precision_;
+    registers_ = (uint8_t*) calloc(registerNum_, sizeof(uint8_t));
+}
+
+/// \brief Destroy the Hyper Log Log object
+///
+HyperLogLog::~HyperLogLog() {
+    free(registers_);
+}
+
+/// \brief add a key to the estimator
+///
+/// \param key - the key buffer
+/// \param keyLen - the length of key
+void HyperLogLog::Add(uint8_t* const key, size_t keyLen) {
+    uint64_t hash[2];
+    MurmurHash3_x64_128(key, keyLen, HLL_SEED, hash);
+
+    /**the high bits select the register, the rank is the position of first 1 in the rest */
+    uint32_t index = hash[0] >> (64 - precision_);
+    uint64_t remain = (hash[0] << precision_) | (1ULL << (precision_ - 1));
+    uint8_t rank = __builtin_clzll(remain) + 1;
+    if (rank > registers_[index]) {
+        registers_[index] = rank;
+    }
+}
+
+/// \brief estimate the number of distinct keys
+///
+/// \return double - the estimated cardinality
+double HyperLogLog::Estimate() {
+    double m = registerNum_;
+    double alpha;
+    switch (registerNum_) {
+        case 16:
+            alpha = 0.673;
+            break;
+        case 32:
+            alpha = 0.697;
+            break;
+        case 64:
+            alpha = 0.709;
+            break;
+        default:
+            alpha = 0.7213 / (1 + 1.079 / m);
+    }
+
+    double sum = 0;
+    uint32_t zeroNum = 0;
+    for (uint32_t i = 0; i < registerNum_; i++) {
+        sum += ldexp(1.0, -registers_[i]);
+        if (registers_[i] == 0) {
+            zeroNum++;
+        }
+    }
+    double estimate = alpha * m * m / sum;
+
+    /**small range correction via linear counting (64-bit hash needs no large range one) */
+    if (estimate <= 2.5 * m && zeroNum != 0) {
+        estimate = m * log(m / zeroNum);
+    }
+    return estimate;
+}
+
+/// \brief merge another estimator (of the same precision) into this one
+///
+/// \param other - the other estimator
+void HyperLogLog::Merge(HyperLogLog const& other) {
+    if (other.precision_ != precision_) {
+        fprintf(stderr, "cannot merge HyperLogLog with different precision, %s:%d\n",
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    for (uint32_t i = 0; i < registerNum_; i++) {
+        if (other.registers_[i] > registers_[i]) {
+            registers_[i] = other.registers_[i];
+        }
+    }
+}
+
+/// \brief reset all registers
+///
+void HyperLogLog::Clear() {
+    memset(registers_, 0, registerNum_);
+}
+
+/// \brief save the registers to a file
+///
+/// \param fp - the output file
+void HyperLogLog::Save(FILE* fp) {
+    fwrite(&precision_, sizeof(uint32_t), 1, fp);
+    fwrite(registers_, sizeof(uint8_t), registerNum_, fp);
+}
+
+/// \brief load the registers from a file
+///
+/// \param fp - the input file
+/// \return true - success
+/// \return false - the file is broken or the precision mismatches
+bool HyperLogLog::Load(FILE* fp) {
+    uint32_t precision = 0;
+    if (fread(&precision, sizeof(uint32_t), 1, fp) != 1 || precision != precision_) {
+        return false;
+    }
+    return fread(registers_, sizeof(uint8_t), registerNum_, fp) == registerNum_;
+}
+
+/// \brief Get the relative standard error of estimation (1.04 / sqrt(m))
+///
+/// \return double - the standard error
+double HyperLogLog::GetStandardError() {
+    return 1.04 / sqrt(static_cast<double>(registerNum_));
+}
@@ -0,0 +1,183 @@
+/// \file outputSink.cc
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief implement the interfaces of buffered output sink with a writer thread
+/// \version 0.1
+/// \date 2019-11-01
+///
+/// \copyright Copyright (c) 2019
+///
+
+#include "../../include/outputSink.h"
+
+/**the lookup table of two hex digits of each byte */
+static struct HexTable {
+    char digits[256][2];
+    HexTable() {
+        const char* hex = "0123456789abcdef";
+        for (int i = 0; i < 256; i++) {
+            digits[i][0] = hex[i >> 4];
+            digits[i][1] = hex[i & 0xf];
+        }
+    }
+} hexTable;
+
+/// \brief Construct a new Output Sink object and start the writer thread
+///
+/// \param fp - the output file
+/// \param binary - write binary records instead of text
+OutputSink::OutputSink(FILE* fp, bool binary) {
+    fp_ = fp;
+    binary_ = binary;
+    buffer_[0] = (char*) malloc(OUTPUT_BUFFER_SIZE);
+    buffer_[1] = (char*) malloc(OUTPUT_BUFFER_SIZE);
+    writerThread_ = std::thread(&OutputSink::WriteThread, this);
+}
+
+/// \brief Destroy the Output Sink object
+///
+OutputSink::~OutputSink() {
+    Close();
+    free(buffer_[0]);
+    free(buffer_[1]);
+}
+
+/// \brief the main loop of writer thread
+///
+void OutputSink::WriteThread() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+        cond_.wait(lock, [this] { return pending_ != NULL || stop_; });
+        if (pending_ == NULL) {
+            /**stopped and nothing to write */
+            return ;
+        }
+
+        /**write without holding the lock, the producer fills the other buffer */
+        char* data = pending_;
+        size_t len = pendingLen_;
+        lock.unlock();
+        if (fwrite(data, 1, len, fp_) != len) {
+            fprintf(stderr, "fail to write the output, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        }
+        lock.lock();
+        pending_ = NULL;
+        cond_.notify_all();
+    }
+}
+
+/// \brief hand the active buffer to the writer thread (wait if it is busy)
+///
+void OutputSink::Submit() {
+    if (len_ == 0) {
+        return ;
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    cond_.wait(lock, [this] { return pending_ == NULL; });
+    pending_ = buffer_[active_];
+    pendingLen_ = len_;
+    cond_.notify_all();
+
+    /**switch to the other buffer */
+    active_ ^= 1;
+    len_ = 0;
+}
+
+/// \brief append the hex of bytes separated by ':' (e.g., 3f:60:bf)
+///
+/// \param data - the bytes
+/// \param len - the number of bytes
+void OutputSink::AppendHex(const uint8_t* data, size_t len) {
+    if (len == 0) {
+        return ;
+    }
+    char* out = buffer_[active_] + len_;
+    for (size_t i = 0; i < len - 1; i++) {
+        out[0] = hexTable.digits[data[i]][0];
+        out[1] = hexTable.digits[data[i]][1];
+        out[2] = ':';
+        out += 3;
+    }
+    out[0] = hexTable.digits[data[len - 1]][0];
+    out[1] = hexTable.digits[data[len - 1]][1];
+    len_ += len * 3 - 1;
+}
+
+/// \brief append a decimal number
+///
+/// \param value - the number
+void OutputSink::AppendUInt(uint64_t value) {
+    char digits[20];
+    size_t num = 0;
+    do {
+        digits[num++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    char* out = buffer_[active_] + len_;
+    for (size_t i = 0; i < num; i++) {
+        out[i] = digits[num - 1 - i];
+    }
+    len_ += num;
+}
+
+/// \brief write a record of ciphertext
+/// text: hex-key\t\tsize\t\t10, binary: [1-byte key length][key][8-byte size]
+///
+/// \param key - the printed ciphertext
+/// \param keyLen - the length of printed ciphertext
+/// \param chunkSize - the chunk size
+void OutputSink::WriteCipher(const uint8_t* key, size_t keyLen, uint64_t chunkSize) {
+    if (binary_) {
+        WriteFreq(key, keyLen, chunkSize);
+        return ;
+    }
+    Reserve(keyLen * 3 + 32);
+    AppendHex(key, keyLen);
+    AppendStr("\t\t", 2);
+    AppendUInt(chunkSize);
+    AppendStr("\t\t10\n", 5);
+}
+
+/// \brief write a record of frequency
+/// text: hex-key\t\tcount, binary: [1-byte key length][key][8-byte count]
+///
+/// \param key - the fingerprint
+/// \param keyLen - the length of fingerprint
+/// \param count - the frequency
+void OutputSink::WriteFreq(const uint8_t* key, size_t keyLen, uint64_t count) {
+    if (keyLen > OUTPUT_MAX_KEY_LEN) {
+        fprintf(stderr, "the key is too long for a record, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    if (binary_) {
+        Reserve(1 + keyLen + sizeof(uint64_t));
+        uint8_t len = keyLen;
+        AppendStr((const char*)&len, 1);
+        AppendStr((const char*)key, keyLen);
+        AppendStr((const char*)&count, sizeof(uint64_t));
+        return ;
+    }
+    Reserve(keyLen * 3 + 24);
+    AppendHex(key, keyLen);
+    AppendStr("\t\t", 2);
+    AppendUInt(count);
+    AppendStr("\n", 1);
+}
+
+/// \brief flush the buffers and stop the writer thread (the file is not closed)
+///
+void OutputSink::Close() {
+    if (isClosed_) {
+        return ;
+    }
+    Submit();
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait(lock, [this] { return pending_ == NULL; });
+        stop_ = true;
+        cond_.notify_all();
+    }
+    writerThread_.join();
+    fflush(fp_);
+    isClosed_ = true;
+}
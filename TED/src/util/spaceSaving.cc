@@ -0,0 +1,172 @@
+/// \file spaceSaving.cc
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief implement the interfaces of SpaceSaving heavy-hitter tracker
+/// \version 0.1
+/// \date 2019-10-25
+///
+/// \copyright Copyright (c) 2019
+///
+
+#include "../../include/spaceSaving.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/// \brief Construct a new Space Saving object
+///
+/// \param capacity - the max number of monitored keys
+SpaceSaving::SpaceSaving(size_t capacity) {
+    if (capacity == 0) {
+        fprintf(stderr, "the capacity of heavy-hitter tracker should be positive, %s:%d\n",
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    capacity_ = capacity;
+    entries_.reserve(capacity_);
+    heap_.reserve(capacity_);
+    heapPos_.reserve(capacity_);
+    keyIndex_.reserve(capacity_);
+}
+
+/// \brief swap two heap nodes
+///
+/// \param a - the position of first node
+/// \param b - the position of second node
+void SpaceSaving::Swap(size_t a, size_t b) {
+    uint32_t tmp = heap_[a];
+    heap_[a] = heap_[b];
+    heap_[b] = tmp;
+    heapPos_[heap_[a]] = a;
+    heapPos_[heap_[b]] = b;
+}
+
+/// \brief move a heap node down after its count increases
+///
+/// \param pos - the position in heap
+void SpaceSaving::SiftDown(size_t pos) {
+    size_t size = heap_.size();
+    while (true) {
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        size_t smallest = pos;
+        if (left < size && entries_[heap_[left]].count < entries_[heap_[smallest]].count) {
+            smallest = left;
+        }
+        if (right < size && entries_[heap_[right]].count < entries_[heap_[smallest]].count) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            return ;
+        }
+        Swap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+/// \brief move a heap node up after insertion
+///
+/// \param pos - the position in heap
+void SpaceSaving::SiftUp(size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (entries_[heap_[parent]].count <= entries_[heap_[pos]].count) {
+            return ;
+        }
+        Swap(pos, parent);
+        pos = parent;
+    }
+}
+
+/// \brief update a key by one
+///
+/// \param key - the key buffer
+/// \param keyLen - the length of key
+void SpaceSaving::Update(uint8_t* const key, size_t keyLen) {
+    std::string keyStr((const char*)key, keyLen);
+    total_++;
+
+    auto findResult = keyIndex_.find(keyStr);
+    if (findResult != keyIndex_.end()) {
+        /**a monitored key */
+        uint32_t index = findResult->second;
+        entries_[index].count++;
+        SiftDown(heapPos_[index]);
+        return ;
+    }
+
+    if (entries_.size() < capacity_) {
+        /**there is a free slot */
+        uint32_t index = entries_.size();
+        HeavyHitter_t entry = {keyStr, 1, 0};
+        entries_.push_back(entry);
+        heap_.push_back(index);
+        heapPos_.push_back(heap_.size() - 1);
+        keyIndex_.insert(std::make_pair(keyStr, index));
+        SiftUp(heap_.size() - 1);
+        return ;
+    }
+
+    /**replace the key with min count, the new key inherits its count as error */
+    uint32_t index = heap_[0];
+    HeavyHitter_t& entry = entries_[index];
+    keyIndex_.erase(entry.key);
+    entry.error = entry.count;
+    entry.count++;
+    entry.key = keyStr;
+    keyIndex_.insert(std::make_pair(keyStr, index));
+    SiftDown(0);
+}
+
+/// \brief Get the max overestimation of any monitored key
+///
+/// \return uint64_t - the min count if full (<= total / capacity), otherwise 0
+uint64_t SpaceSaving::GetMaxError() {
+    if (entries_.size() < capacity_) {
+        return 0;
+    }
+    return entries_[heap_[0]].count;
+}
+
+/// \brief Get the top-k keys in the descending order of count
+///
+/// \param k - the number of keys
+/// \param topK - the result list <return>
+void SpaceSaving::GetTopK(size_t k, std::vector<HeavyHitter_t>& topK) {
+    topK = entries_;
+    k = min(k, topK.size());
+    partial_sort(topK.begin(), topK.begin() + k, topK.end(),
+        [](const HeavyHitter_t& a, const HeavyHitter_t& b) {
+            return a.count > b.count;
+        });
+    topK.resize(k);
+}
+
+/// \brief print the top-k keys with their error bounds
+///
+/// \param fp - the output file
+/// \param k - the number of keys
+/// \param FpLength - the length of key to print
+void SpaceSaving::PrintTopK(FILE* fp, size_t k, size_t FpLength) {
+    std::vector<HeavyHitter_t> topK;
+    GetTopK(k + 1, topK);
+
+    /**a key is surely in the top-k if its lower bound exceeds any count out of the top-k */
+    uint64_t outsideCount = GetMaxError();
+    if (topK.size() > k) {
+        outsideCount = max(outsideCount, topK[k].count);
+        topK.resize(k);
+    }
+
+    fprintf(fp, "# total: %lu, capacity: %lu, max error: %lu\n", total_, capacity_,
+        GetMaxError());
+    fprintf(fp, "# fingerprint\t\tcount\t\terror\t\tguaranteed\n");
+    for (auto it = topK.begin(); it != topK.end(); it++) {
+        size_t len = min(FpLength, it->key.size());
+        for (size_t i = 0; i < len; i++) {
+            fprintf(fp, (i == len - 1) ? "%02x\t\t" : "%02x:", (uint8_t)it->key[i]);
+        }
+        bool guaranteed = (it->count - it->error) >= outsideCount;
+        fprintf(fp, "%lu\t\t%lu\t\t%d\n", it->count, it->error, guaranteed);
+    }
+}
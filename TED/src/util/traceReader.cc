@@ -0,0 +1,450 @@
+/// \file traceReader.cc
+/// \author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+/// \brief implement the interfaces of trace reader
+/// \version 0.1
+/// \date 2019-10-23
+///
+/// \copyright Copyright (c) 2019
+///
+
+#include "../../include/traceReader.h"
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/// \brief Destroy the Trace Reader object
+///
+TraceReader::~TraceReader() {
+    Close();
+}
+
+/// \brief detect the format of the input via the magic number
+///
+/// \return int - the format
+int TraceReader::DetectFormat() {
+    uint8_t magic[4] = {0};
+    FILE* fp = fopen(fileName_.c_str(), "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t len = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+
+    if (len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return TRACE_GZIP;
+    }
+    if (len >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f &&
+        magic[3] == 0xfd) {
+        return TRACE_ZSTD;
+    }
+    return TRACE_PLAIN;
+}
+
+/// \brief open the input file and start the reader thread
+///
+/// \param fileName - the input file name
+/// \return true - success
+/// \return false - fail
+bool TraceReader::Open(std::string const fileName) {
+    Close();
+    fileName_ = fileName;
+    format_ = DetectFormat();
+    if (format_ == -1) {
+        return false;
+    }
+#ifndef HAVE_ZSTD
+    if (format_ == TRACE_ZSTD) {
+        fprintf(stderr, "zstd input is not supported in this build, %s:%d\n", FILE_NAME,
+            CURRENT_LIEN);
+        return false;
+    }
+#endif
+
+    for (size_t i = 0; i < TRACE_BLOCK_NUM; i++) {
+        TraceBlock_t* block = (TraceBlock_t*) malloc(sizeof(TraceBlock_t));
+        block->data = (char*) malloc(TRACE_BLOCK_SIZE);
+        block->len = 0;
+        freeQueue_.push(block);
+    }
+    readDone_ = false;
+    stop_ = false;
+    current_ = NULL;
+    currentPos_ = 0;
+    isContentChecked_ = false;
+    isHashFile_ = false;
+    fileChunks_ = 0;
+
+    readerThread_ = std::thread(&TraceReader::ReadThread, this);
+    isOpen_ = true;
+    return true;
+}
+
+/// \brief get a free block (wait if none), return NULL if stopped
+///
+/// \return TraceBlock_t* - the free block
+TraceBlock_t* TraceReader::GetFreeBlock() {
+    std::unique_lock<std::mutex> lock(queueMtx_);
+    notFull_.wait(lock, [this] { return stop_ || !freeQueue_.empty(); });
+    if (stop_) {
+        return NULL;
+    }
+    TraceBlock_t* block = freeQueue_.front();
+    freeQueue_.pop();
+    return block;
+}
+
+/// \brief hand a filled block to the consumer
+///
+/// \param block - the filled block
+void TraceReader::PutFullBlock(TraceBlock_t* block) {
+    std::unique_lock<std::mutex> lock(queueMtx_);
+    fullQueue_.push(block);
+    notEmpty_.notify_one();
+}
+
+/// \brief the main loop of reader thread
+///
+void TraceReader::ReadThread() {
+    TraceBlock_t* block = NULL;
+
+    if (format_ == TRACE_ZSTD) {
+#ifdef HAVE_ZSTD
+        FILE* fp = fopen(fileName_.c_str(), "rb");
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        size_t inCap = ZSTD_DStreamInSize();
+        char* inBuffer = (char*) malloc(inCap);
+        ZSTD_inBuffer input = {inBuffer, 0, 0};
+        bool inputEnd = false;
+        bool decodeDone = false;
+        size_t ret = 0;
+        while ((block = GetFreeBlock()) != NULL) {
+            ZSTD_outBuffer output = {block->data, TRACE_BLOCK_SIZE, 0};
+            while (output.pos < output.size) {
+                if (input.pos == input.size && !inputEnd) {
+                    input.size = fread(inBuffer, 1, inCap, fp);
+                    input.pos = 0;
+                    inputEnd = (input.size == 0);
+                }
+                size_t lastPos = output.pos;
+                size_t lastInputPos = input.pos;
+                size_t hint = ZSTD_decompressStream(dctx, &output, &input);
+                if (ZSTD_isError(hint)) {
+                    fprintf(stderr, "zstd decompression error: %s, %s:%d\n",
+                        ZSTD_getErrorName(hint), FILE_NAME, CURRENT_LIEN);
+                    exit(1);
+                }
+                if (output.pos != lastPos || input.pos != lastInputPos) {
+                    /**0 if the last frame is complete */
+                    ret = hint;
+                } else if (inputEnd) {
+                    /**the input is used up and the decoder holds no more data */
+                    decodeDone = true;
+                    break;
+                }
+            }
+            block->len = output.pos;
+            PutFullBlock(block);
+            if (decodeDone) {
+                break;
+            }
+        }
+        if (decodeDone && ret != 0) {
+            fprintf(stderr, "truncated zstd frame: %s, %s:%d\n", fileName_.c_str(),
+                FILE_NAME, CURRENT_LIEN);
+            exit(1);
+        }
+        free(inBuffer);
+        ZSTD_freeDCtx(dctx);
+        fclose(fp);
+#endif
+    } else {
+        /**gzip (it also reads the plain file transparently) */
+        gzFile gzIn = gzopen(fileName_.c_str(), "rb");
+        if (gzIn == NULL) {
+            fprintf(stderr, "fail to open the input: %s, %s:%d\n", fileName_.c_str(),
+                FILE_NAME, CURRENT_LIEN);
+            exit(1);
+        }
+        gzbuffer(gzIn, TRACE_BLOCK_SIZE);
+        while ((block = GetFreeBlock()) != NULL) {
+            int len = gzread(gzIn, block->data, TRACE_BLOCK_SIZE);
+            if (len < 0) {
+                int errNum;
+                fprintf(stderr, "gzip decompression error: %s, %s:%d\n",
+                    gzerror(gzIn, &errNum), FILE_NAME, CURRENT_LIEN);
+                exit(1);
+            }
+            block->len = len;
+            PutFullBlock(block);
+            if (len == 0) {
+                break;
+            }
+        }
+        gzclose(gzIn);
+    }
+
+    std::unique_lock<std::mutex> lock(queueMtx_);
+    readDone_ = true;
+    notEmpty_.notify_one();
+}
+
+/// \brief switch to the next filled block
+///
+/// \return true - there is a new block
+/// \return false - the end of file
+bool TraceReader::NextBlock() {
+    std::unique_lock<std::mutex> lock(queueMtx_);
+    if (current_ != NULL) {
+        /**return the consumed block to the reader thread */
+        freeQueue_.push(current_);
+        current_ = NULL;
+        notFull_.notify_one();
+    }
+    notEmpty_.wait(lock, [this] { return readDone_ || !fullQueue_.empty(); });
+    while (!fullQueue_.empty()) {
+        TraceBlock_t* block = fullQueue_.front();
+        fullQueue_.pop();
+        if (block->len != 0) {
+            current_ = block;
+            currentPos_ = 0;
+            return true;
+        }
+        freeQueue_.push(block);
+    }
+    return false;
+}
+
+/// \brief read a line, the same semantic of fgets
+///
+/// \param buffer - the line buffer
+/// \param size - the size of line buffer
+/// \return char* - the buffer, NULL if the end of file
+char* TraceReader::ReadLine(char* buffer, int size) {
+    if (!isOpen_ || size <= 0) {
+        return NULL;
+    }
+
+    size_t lineLen = 0;
+    size_t maxLen = size - 1;
+    while (lineLen < maxLen) {
+        if (current_ == NULL || currentPos_ == current_->len) {
+            if (!NextBlock()) {
+                break;
+            }
+        }
+        char* start = current_->data + currentPos_;
+        size_t remain = current_->len - currentPos_;
+        size_t copyLen = (remain < maxLen - lineLen) ? remain : (maxLen - lineLen);
+        char* newLine = (char*) memchr(start, '\n', copyLen);
+        if (newLine != NULL) {
+            copyLen = newLine - start + 1;
+        }
+        memcpy(buffer + lineLen, start, copyLen);
+        lineLen += copyLen;
+        currentPos_ += copyLen;
+        if (newLine != NULL) {
+            break;
+        }
+    }
+
+    if (lineLen == 0) {
+        return NULL;
+    }
+    buffer[lineLen] = '\0';
+    return buffer;
+}
+
+/// \brief read bytes from the blocks
+///
+/// \param buffer - the output buffer (NULL: skip the bytes)
+/// \param len - the number of bytes
+/// \return size_t - the number of read bytes, less than len at the end of file
+size_t TraceReader::ReadBytes(uint8_t* buffer, size_t len) {
+    if (!isOpen_) {
+        return 0;
+    }
+    size_t readLen = 0;
+    while (readLen < len) {
+        if (current_ == NULL || currentPos_ == current_->len) {
+            if (!NextBlock()) {
+                break;
+            }
+        }
+        size_t remain = current_->len - currentPos_;
+        size_t copyLen = (remain < len - readLen) ? remain : (len - readLen);
+        if (buffer != NULL) {
+            memcpy(buffer + readLen, current_->data + currentPos_, copyLen);
+        }
+        readLen += copyLen;
+        currentPos_ += copyLen;
+    }
+    return readLen;
+}
+
+/// \brief check whether the content is a hashfile via the magic, and read
+/// its header
+///
+void TraceReader::CheckContent() {
+    isContentChecked_ = true;
+    if (!isOpen_) {
+        return ;
+    }
+    if (current_ == NULL && !NextBlock()) {
+        return ;
+    }
+    uint32_t magic = 0;
+    if (current_->len < sizeof(magic)) {
+        return ;
+    }
+    memcpy(&magic, current_->data, sizeof(magic));
+    if (magic != HASHFILE_MAGIC) {
+        return ;
+    }
+
+    uint8_t* header = (uint8_t*) malloc(HASHFILE_HEADER_SIZE);
+    if (ReadBytes(header, HASHFILE_HEADER_SIZE) != HASHFILE_HEADER_SIZE) {
+        fprintf(stderr, "the hashfile header is truncated, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    uint32_t version;
+    uint64_t fileNum;
+    uint64_t chunkNum;
+    memcpy(&version, header + sizeof(magic), sizeof(version));
+    memcpy(&fileNum, header + HASHFILE_HEADER_FILES_OFFSET, sizeof(fileNum));
+    memcpy(&chunkNum, header + HASHFILE_HEADER_FILES_OFFSET + sizeof(fileNum),
+        sizeof(chunkNum));
+    memcpy(&hashSize_, header + HASHFILE_HEADER_HASH_SIZE_OFFSET, sizeof(hashSize_));
+    free(header);
+
+    if (version != HASHFILE_VERSION) {
+        fprintf(stderr, "cannot support the hashfile version: %u, %s:%d\n", version,
+            FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    if (hashSize_ == 0 || hashSize_ > HASHFILE_MAX_HASH_SIZE) {
+        fprintf(stderr, "wrong hash size of hashfile: %u, %s:%d\n", hashSize_, FILE_NAME,
+            CURRENT_LIEN);
+        exit(1);
+    }
+    fprintf(stderr, "read the hashfile: %lu files, %lu chunks, hash size %u\n", fileNum,
+        chunkNum, hashSize_);
+    isHashFile_ = true;
+    fileChunks_ = 0;
+}
+
+/// \brief read a chunk record of hashfile
+///
+/// \param chunkFp - the chunk fingerprint <return>
+/// \param fpLen - the length of fingerprint
+/// \param chunkSize - the chunk size <return>
+/// \return true - success
+/// \return false - the end of file
+bool TraceReader::ReadHashFileRecord(uint8_t* chunkFp, size_t fpLen, uint64_t& chunkSize) {
+    /**skip to the next file which has chunks */
+    while (fileChunks_ == 0) {
+        uint8_t fileHeader[HASHFILE_FILE_HEADER_SIZE];
+        size_t len = ReadBytes(fileHeader, HASHFILE_FILE_HEADER_SIZE);
+        if (len == 0) {
+            return false;
+        }
+        uint32_t pathLen;
+        memcpy(&fileChunks_, fileHeader + sizeof(uint64_t), sizeof(fileChunks_));
+        memcpy(&pathLen, fileHeader + 2 * sizeof(uint64_t), sizeof(pathLen));
+        if (len != HASHFILE_FILE_HEADER_SIZE ||
+            ReadBytes(NULL, pathLen + HASHFILE_FILE_META_SIZE) !=
+            pathLen + HASHFILE_FILE_META_SIZE) {
+            fprintf(stderr, "the hashfile is truncated, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+            exit(1);
+        }
+    }
+
+    uint8_t record[HASHFILE_CHUNK_HEADER_SIZE + HASHFILE_MAX_HASH_SIZE];
+    size_t recordLen = HASHFILE_CHUNK_HEADER_SIZE + hashSize_;
+    if (ReadBytes(record, recordLen) != recordLen) {
+        fprintf(stderr, "the hashfile is truncated, %s:%d\n", FILE_NAME, CURRENT_LIEN);
+        exit(1);
+    }
+    fileChunks_--;
+
+    /**the same as the text: the first fpLen bytes of hash */
+    memcpy(&chunkSize, record, sizeof(uint64_t));
+    size_t copyLen = (hashSize_ < fpLen) ? hashSize_ : fpLen;
+    memcpy(chunkFp, record + HASHFILE_CHUNK_HEADER_SIZE, copyLen);
+    memset(chunkFp + copyLen, 0, fpLen - copyLen);
+    chunkFp[fpLen] = '\0';
+    return true;
+}
+
+/// \brief read a chunk record (fingerprint and size) from the text trace or
+/// the hashfile
+///
+/// \param chunkFp - the chunk fingerprint (fpLen + 1, ends with '\0') <return>
+/// \param fpLen - the length of fingerprint
+/// \param chunkSize - the chunk size <return>
+/// \return true - success
+/// \return false - the end of file
+bool TraceReader::ReadRecord(uint8_t* chunkFp, size_t fpLen, uint64_t& chunkSize) {
+    if (!isOpen_) {
+        return false;
+    }
+    if (!isContentChecked_) {
+        CheckContent();
+    }
+    if (isHashFile_) {
+        return ReadHashFileRecord(chunkFp, fpLen, chunkSize);
+    }
+
+    /**assume size of input file is large than 32 bytes */
+    char readBuffer[256];
+    char* item;
+    while (ReadLine(readBuffer, sizeof(readBuffer)) != NULL) {
+        /**read chunk information into chunk buffer */
+        item = strtok(readBuffer, ":\t\n ");
+        size_t index = 0;
+        for (index = 0; (item != NULL) && (index < fpLen); index++) {
+            chunkFp[index] = strtol(item, NULL, 16);
+            item = strtok(NULL, ":\t\n ");
+        }
+        chunkFp[fpLen] = '\0';
+
+        /**skip the line without chunk size (e.g., an empty line) */
+        if (item == NULL) {
+            continue;
+        }
+        chunkSize = atol((const char*)item);
+        return true;
+    }
+    return false;
+}
+
+/// \brief stop the reader thread and close the input
+///
+void TraceReader::Close() {
+    if (!isOpen_) {
+        return ;
+    }
+    {
+        std::unique_lock<std::mutex> lock(queueMtx_);
+        stop_ = true;
+        notFull_.notify_all();
+    }
+    readerThread_.join();
+
+    if (current_ != NULL) {
+        freeQueue_.push(current_);
+        current_ = NULL;
+    }
+    while (!fullQueue_.empty()) {
+        freeQueue_.push(fullQueue_.front());
+        fullQueue_.pop();
+    }
+    while (!freeQueue_.empty()) {
+        TraceBlock_t* block = freeQueue_.front();
+        freeQueue_.pop();
+        free(block->data);
+        free(block);
+    }
+    isOpen_ = false;
+}
@@ -0,0 +1,51 @@
+#!/bin/bash
+# check the boundary stability of variable-size chunking: insert a few bytes at several offsets of a
+# file, then count the chunks of the original file that are lost in the new one (Rabin vs FastCDC),
+# each chunker should re-synchronise after an insertion and lose only the chunks around it
+# usage: ./checkBoundaryShift.sh [traceGen] (run in bin/ with config.json, the file should be smaller than _ReadSize)
+TRACE_GEN=$(readlink -f ${1:-./traceGen})
+FILE_SIZE=67108864
+INSERT_NUM=16
+INSERT_SIZE=7
+MAX_LOST_PER_INSERT=4
+
+WORK_DIR=$(mktemp -d)
+# the same pseudo-random content in each run
+openssl enc -aes-128-ctr -nosalt -K 00000000000000000000000000000000 -iv 00000000000000000000000000000000 \
+    < /dev/zero 2> /dev/null | head -c ${FILE_SIZE} > ${WORK_DIR}/origin
+SEGMENT_SIZE=$((FILE_SIZE / INSERT_NUM))
+rm -f ${WORK_DIR}/insert
+for ((i = 0; i < INSERT_NUM; i++)); do
+    # the insertion is in the middle of each segment
+    dd if=${WORK_DIR}/origin bs=${SEGMENT_SIZE} skip=${i} count=1 2> /dev/null | head -c $((SEGMENT_SIZE / 2)) >> ${WORK_DIR}/insert
+    head -c ${INSERT_SIZE} /dev/urandom >> ${WORK_DIR}/insert
+    dd if=${WORK_DIR}/origin bs=${SEGMENT_SIZE} skip=${i} count=1 2> /dev/null | tail -c $((SEGMENT_SIZE - SEGMENT_SIZE / 2)) >> ${WORK_DIR}/insert
+done
+
+FAIL=0
+for TYPE in 1 4; do
+    for FILE in origin insert; do
+        if ! ${TRACE_GEN} -t ${TYPE} ${WORK_DIR}/${FILE} ${WORK_DIR}/${FILE}.trace > /dev/null 2>&1; then
+            echo "traceGen fails on ${FILE} with chunking type ${TYPE}"
+            rm -rf ${WORK_DIR}
+            exit 1
+        fi
+        # a chunk is identified by its fingerprint and size
+        awk '{print $1, $2}' ${WORK_DIR}/${FILE}.trace | sort > ${WORK_DIR}/${FILE}.chunks
+    done
+    ORIGIN_CHUNKS=$(wc -l < ${WORK_DIR}/origin.chunks)
+    KEPT_CHUNKS=$(comm -12 ${WORK_DIR}/origin.chunks ${WORK_DIR}/insert.chunks | wc -l)
+    LOST_CHUNKS=$((ORIGIN_CHUNKS - KEPT_CHUNKS))
+    if [ ${TYPE} -eq 1 ]; then
+        NAME="Rabin"
+    else
+        NAME="FastCDC"
+    fi
+    echo "${NAME}: ${ORIGIN_CHUNKS} chunks, ${LOST_CHUNKS} lost after ${INSERT_NUM} insertions of ${INSERT_SIZE} bytes"
+    if [ ${LOST_CHUNKS} -gt $((INSERT_NUM * MAX_LOST_PER_INSERT)) ]; then
+        echo "${NAME}: the cut points do not re-synchronise after an insertion"
+        FAIL=1
+    fi
+done
+rm -rf ${WORK_DIR}
+exit ${FAIL}
@@ -3,27 +3,48 @@
 
 #include "configure.hpp"
 #include "cryptoPrimitive.hpp"
+#include "dataPool.hpp"
 #include "dataStructure.hpp"
 #include "keyClient.hpp"
 #include "messageQueue.hpp"
+#include "threadPool.h"
+#include "traceReader.hpp"
+#include <deque>
+#include <functional>
+
+// the handler of chunks and the recipe when the chunker runs without a key client (e.g., trace generation)
+typedef std::function<bool(Data_t&)> ChunkHandler_t;
 
 class Chunker {
 private:
     CryptoPrimitive* cryptoObj;
-    keyClient* keyClientObj;
+    keyClient* keyClientObj = NULL;
+    DataPool* dataPoolObj = NULL;
+    ChunkHandler_t chunkHandler;
 
-    // Chunker type setting (FIX_SIZE_TYPE or VAR_SIZE_TYPE)
+    // Chunker type setting (FIX_SIZE_TYPE, VAR_SIZE_TYPE or FAST_CDC_TYPE)
     int ChunkerType;
     /*chunk size setting*/
     int avgChunkSize;
     int minChunkSize;
     int maxChunkSize;
 
-    u_char *waitingForChunkingBuffer, *chunkBuffer;
+    u_char *waitingForChunkingBuffer = NULL, *chunkBuffer = NULL;
     uint64_t ReadSize;
     uint64_t totalSize;
     Data_t fileRecipe;
     std::ifstream chunkingFile;
+    std::string chunkingFilePath;
+    /*the mapped chunking file (NULL: read by chunkingFile), the kernel reads the next block ahead*/
+    u_char* mappedFile = NULL;
+    uint64_t mappedSize = 0;
+    uint64_t mappedOffset = 0;
+    uint64_t mappedDropped = 0;
+    uint64_t inputBlockSize = 0;
+    /*the files to chunk in order, the reader threads read the next ones ahead (NULL: a single file)*/
+    vector<string> fileList;
+    size_t prefetchedFileIndex = 0;
+    ThreadPool* readerPool = NULL;
 
     /*VarSize chunking*/
     /*sliding window size*/
@@ -34,29 +55,67 @@ private:
     /*note: to avoid overflow, _polyMOD*255 should be in the range of "uint32_t"*/
     /*      here, 255 is the max value of "unsigned char"                       */
     /*the lookup table for accelerating the power calculation in rolling hash*/
-    uint32_t* powerLUT;
+    uint32_t* powerLUT = NULL;
     /*the lookup table for accelerating the byte remove in rolling hash*/
-    uint32_t* removeLUT;
+    uint32_t* removeLUT = NULL;
     /*the mask for determining an anchor*/
     uint32_t anchorMask;
     /*the value for determining an anchor*/
     uint32_t anchorValue;
+    /*the threads to find anchors in the segments of a read (1: serial chunking)*/
+    int chunkingThreadNum = 1;
+    ThreadPool* chunkingPool = NULL;
+
+    /*fingerprinting stage: the threads hash the chunks in batches (NULL: hash in the chunker thread)*/
+    ThreadPool* fingerprintPool = NULL;
+    size_t fingerprintWindow = 0;
+    vector<Data_t*> fingerprintBatch;
+    /*the batches in flight and their hashing time, in the chunk order*/
+    std::deque<vector<Data_t*>> fingerprintBatchList;
+    std::deque<double> fingerprintTimeList;
+    std::deque<std::future<bool>> fingerprintDoneList;
+    double hashTime = 0;
+
+    /*FastCDC chunking*/
+    /*the random value of each byte in Gear hash*/
+    uint64_t* gearTable = NULL;
+    /*the masks before (more bits, harder to cut) and after (fewer bits) the average size*/
+    uint64_t gearMaskS;
+    uint64_t gearMaskL;
 
-    void fixSizeChunking();
-    void varSizeChunking();
-    void traceDrivenChunkingFSL();
-    void traceDrivenChunkingUBC();
-    void ChunkerInit(string path);
-    bool insertMQToKeyClient(Data_t& newData);
+    bool fixSizeChunking();
+    bool varSizeChunking();
+    bool parallelVarSizeChunking();
+    void findAnchors(const u_char* block, uint64_t start, uint64_t end, vector<uint64_t>& anchorList);
+    bool fastCDCChunking();
+    uint64_t gearCutPoint(const u_char* src, uint64_t len);
+    bool traceDrivenChunkingFSL();
+    bool traceDrivenChunkingUBC();
+    void ChunkerInit();
+    bool insertChunk(Data_t* newChunk);
+    bool insertFingerprintBatch();
+    bool flushFingerprint();
+    void dropFingerprint();
+    static bool hashChunkBatch(vector<Data_t*>* batch, double* hashTime);
+    bool insertMQToKeyClient(Data_t* newData);
+    bool insertRecipeToKeyClient();
     bool setJobDoneFlag();
     void loadChunkFile(string path);
+    void openChunkFile(string path);
+    void prefetchFiles(size_t fileIndex);
+    static void prefetchFile(string path);
+    void mapChunkFile();
+    uint64_t readInput(u_char*& block, uint64_t remainSize, bool& fileEnd);
     std::ifstream& getChunkingFile();
 
 public:
-    Chunker(std::string path, keyClient* keyClientObjTemp);
+    Chunker(vector<string> pathList, keyClient* keyClientObjTemp);
+    Chunker(ChunkHandler_t chunkHandlerTemp);
     ~Chunker();
     bool chunking();
+    bool chunking(std::string path);
     Recipe_t getRecipeHead();
+    static void collectFiles(string path, vector<string>& pathList, bool isRoot = true);
 };
 
 #endif //TEDSTORE_CHUNKER_HPP
@@ -30,17 +30,52 @@ using namespace std;
 #define TRACE_DRIVEN_TEST 1  // set 1 to ignore errors in trace-driven test
 #define MULTI_CLIENT_UPLOAD_TEST 0 // set 1 to add mutex for multi-client test
 #define SINGLE_THREAD_KEY_MANAGER 0 // 0:dual thread key server| 1:single thread key server
+#define SHORT_HASH_FROM_FINGERPRINT 1 // 0:MurmurHash3 over the chunk| 1:the first 128 bits of the chunk fingerprint (all clients must agree)
 
 //macro for the type of chunker
 #define CHUNKER_FIX_SIZE_TYPE 0
 #define CHUNKER_VAR_SIZE_TYPE 1
 #define CHUNKER_TRACE_DRIVEN_TYPE_FSL 2
 #define CHUNKER_TRACE_DRIVEN_TYPE_UBC 3
+#define CHUNKER_FAST_CDC_TYPE 4
+
+#define FINGERPRINT_BATCH_SIZE 64 //macro for the chunks hashed by a fingerprinting thread at a time
+#define FINGERPRINT_WINDOW_PER_THREAD 2 //macro for the batches per fingerprinting thread in flight, the chunks are inserted in order
+#define CHUNKER_INPUT_MMAP 1 //macro for the input of chunking, 1: map the file and read ahead by madvise | 0: ifstream read
+#define CHUNKING_SEGMENT_MIN_SIZE 1048576 //macro for the min bytes of a segment in parallel variable-size chunking
+#define CHUNKER_READER_THREAD_NUMBER 2 //macro for the reader threads of a multi-file backup, they read the next files ahead
+#define CHUNKER_PREFETCH_FILE_NUMBER 16 //macro for the next files read ahead while the current one is chunked
+#define CHUNKER_PREFETCH_SIZE 1048576 //macro for the bytes read ahead from the head of a next file (a small file in whole)
+
+#define GEAR_WINDOW_SIZE 64 //macro for the bytes covered by the Gear hash (the bits of a 64-bit fingerprint)
+#define GEAR_NORMAL_LEVEL 2 //macro for the normalization level of FastCDC (mask bits moved around the average size)
+#define GEAR_TABLE_SEED 0x5445445354524545ULL //macro for the seed of the Gear table, all clients must share it to dedup
 
 #define MIN_CHUNK_SIZE 4096 //macro for the min size of variable-size chunker
 #define AVG_CHUNK_SIZE 8192 //macro for the average size of variable-size chunker
 #define MAX_CHUNK_SIZE 16384 //macro for the max size of variable-size chunker
 
+#define DATA_POOL_BUFFER_NUMBER 8192 //macro for the number of pooled Data_t buffers in the client pipeline (about 128MB) without a memory budget
+
+#define MQ_SPIN_MIN 64 //macro for the bounds of adaptive spin rounds before a message queue parks the thread
+#define MQ_SPIN_MAX 16384
+#define MQ_PARK_TIMEOUT 10 //macro for the max time (ms) of a parked thread before it checks the message queue again
+#define MQ_POP_BATCH_SIZE 64 //macro for the max number of items the sender takes from its message queue at once
+
+#define TRACE_BLOCK_SIZE (4 * 1024 * 1024) //macro for the block size of (decompressed) trace input
+#define TRACE_BLOCK_NUM 4 //macro for the number of blocks between trace reader thread and chunker
+
+#define TRACE_GEN_FP_SIZE 6 //macro for the default fingerprint size of generated traces (48-bit as FSL traces)
+#define TRACE_GEN_FILE_WINDOW 4 //macro for the number of chunked files per thread buffered before written
+#define HASHFILE_MAGIC 0x8D1FC39E //macro for the binary trace (FSL hashfile of fs-hasher, version 7)
+#define HASHFILE_VERSION 7
+#define HASHFILE_PATH_SIZE 4096 //macro for the root path and system id in the hashfile header
+#define HASHFILE_FIXED_CHUNKING 1 //macro for the chunking method in the hashfile header
+#define HASHFILE_VARIABLE_CHUNKING 2
+#define HASHFILE_RABIN_CHUNKING 2 //macro for the variable-size chunking algorithm in the hashfile header
+#define HASHFILE_GEAR_CHUNKING 3
+#define HASHFILE_SHA256_HASH 2 //macro for the hashing method in the hashfile header
+
 #define CHUNK_FINGER_PRINT_SIZE 32
 #define CHUNK_HASH_SIZE 32
 #define CHUNK_ENCRYPT_KEY_SIZE 32
@@ -59,6 +94,10 @@ using namespace std;
 #define KEY_SERVER_NO_RAND 5
 #define KEY_SERVER_RANDOM_TYPE KEY_SERVER_NO_RAND
 
+#define KEY_SERVER_DEDUP_ESTIMATE 1 // set 1 to report the approximate dedup ratio in key server
+#define HLL_PRECISION 14 // 2^14 registers (16KB) per HyperLogLog, about 0.8% standard error
+#define HLL_SEED 0x4c4c // the seed of HyperLogLog hash
+
 #define SIMPLE_KEY_SEED 32
 #define HHASH_KEY_SEED 16
 
@@ -73,6 +112,8 @@ private:
     uint64_t _averageChunkSize;
     uint64_t _slidingWinSize;
     uint64_t _ReadSize; //128M per time
+    uint64_t _chunkingThreadNum; // threads to find the anchors of variable-size chunking
+    uint64_t _fingerprintThreadNum; // threads to hash the chunks (0: in the chunker thread)
 
     // key management settings
     uint64_t _keyServerNumber;
@@ -103,6 +144,8 @@ private:
     int _sendShortHashMaskBitNumber;
     int _keyManagerNum;
     uint64_t _adjustValue;
+    uint64_t _encodeThreadNum; // threads to derive the keys and encrypt the chunks (0: in the key client thread)
+    uint64_t _memoryBudget; // MB for the chunking buffer, the chunks in flight and the send buffer (0: DATA_POOL_BUFFER_NUMBER chunks)
 
     // key manager ip vector
     vector<pair<string, int>> _keyManagerIpArray;
@@ -119,12 +162,15 @@ public:
 
     // chunking settings
     uint64_t getChunkingType();
+    void setChunkingType(uint64_t chunkingType); // override the config file (e.g., by command line)
     uint64_t getMaxChunkSize();
     uint64_t getMinChunkSize();
     uint64_t getAverageChunkSize();
     uint64_t getSlidingWinSize();
     uint64_t getSegmentSize();
     uint64_t getReadSize();
+    uint64_t getChunkingThreadNum();
+    uint64_t getFingerprintThreadNum();
 
     // key management settings
     std::string getKeyServerIP();
@@ -158,6 +204,8 @@ public:
     uint32_t getKeyManagerNumber();
     vector<pair<string, int>> getKeyManagerIPList();
     uint64_t getAdjustValue();
+    uint64_t getEncodeThreadNum();
+    uint64_t getMemoryBudget();
 };
 
 #endif //TEDSTORE_CONFIGURE_HPP
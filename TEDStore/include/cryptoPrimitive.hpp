@@ -44,6 +44,7 @@ public:
     static bool opensslLockSetup();
     static bool opensslLockCleanup();
     bool generateHash(u_char* dataBuffer, const int dataSize, u_char* hash);
+    bool generateChunkHash(u_char* dataBuffer, const int dataSize, u_char* hash); // reuse mdctx_, one object per thread
     bool encryptWithKey(u_char* dataBuffer, const int dataSize, u_char* key, u_char* ciphertext);
     bool decryptWithKey(u_char* ciphertext, const int dataSize, u_char* key, u_char* dataBuffer);
     bool encryptChunk(Chunk_t& chunk);
@@ -0,0 +1,104 @@
+/**
+ * @file dataPool.hpp
+ * @author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+ * @brief define the interface of the pool of reference-counted Data_t buffers, the client
+ * pipeline passes the buffers by pointer through the message queues instead of copying
+ * @version 0.1
+ * @date 2020-10-27
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#ifndef TEDSTORE_DATAPOOL_HPP
+#define TEDSTORE_DATAPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "configure.hpp"
+#include "dataStructure.hpp"
+
+class DataPool;
+
+// a pooled buffer, the data is the first member so that a Data_t* maps back to its buffer
+typedef struct {
+    Data_t data;
+    DataPool* pool;
+    std::atomic<int> refCount;
+} PooledData_t;
+
+class DataPool {
+private:
+    // the slab of buffers, a buffer is initialized when it is handed out the first time
+    PooledData_t* slab_ = NULL;
+    uint32_t bufferNumber_ = 0;
+    uint32_t initializedNumber_ = 0;
+    // the most buffers in use at a time
+    uint32_t highWaterNumber_ = 0;
+
+    // the indexes of released buffers
+    std::vector<uint32_t> freeList_;
+    std::mutex poolMtx_;
+    std::condition_variable notEmpty_;
+
+    /**
+     * @brief put a buffer back to the free list
+     *
+     * @param buffer the buffer
+     */
+    void recycle(PooledData_t* buffer);
+
+public:
+    /**
+     * @brief Construct a new Data Pool object
+     *
+     * @param bufferNumber the number of buffers, the producer waits when all are in use
+     */
+    DataPool(uint32_t bufferNumber);
+
+    /**
+     * @brief Destroy the Data Pool object, all buffers should be released
+     *
+     */
+    ~DataPool();
+
+    /**
+     * @brief get a buffer with the reference count of 1 (wait if none is free)
+     *
+     * @return Data_t* the buffer
+     */
+    Data_t* get();
+
+    /**
+     * @brief add a reference to a buffer (e.g., hand it to one more stage)
+     *
+     * @param data the buffer
+     */
+    static void retain(Data_t* data);
+
+    /**
+     * @brief drop a reference to a buffer, it goes back to its pool at the last one
+     *
+     * @param data the buffer
+     */
+    static void release(Data_t* data);
+
+    /**
+     * @brief get the number of buffers, i.e., the chunks the pipeline holds at most
+     *
+     * @return uint32_t the number of buffers
+     */
+    uint32_t getBufferNumber();
+
+    /**
+     * @brief get the most buffers in use at a time
+     *
+     * @return uint32_t the high-water mark
+     */
+    uint32_t getHighWaterNumber();
+};
+
+#endif // TEDSTORE_DATAPOOL_HPP
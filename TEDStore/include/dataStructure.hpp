@@ -71,6 +71,8 @@ typedef struct {
         Recipe_t recipe;
     };
     int dataType;
+    // the order in the client stream, the sender restores it after the parallel encoding
+    uint64_t seq;
 } Data_t;
 
 typedef struct {
@@ -0,0 +1,73 @@
+/**
+ * @file hyperLogLog.hpp
+ * @author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+ * @brief define the interface of HyperLogLog cardinality estimator
+ * @version 0.1
+ * @date 2020-10-27
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#ifndef TEDSTORE_HYPERLOGLOG_HPP
+#define TEDSTORE_HYPERLOGLOG_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "configure.hpp"
+#include "murmurHash3.hpp"
+
+class HyperLogLog {
+private:
+    // the number of index bits, and the number of registers (2^precision)
+    uint32_t precision_;
+    uint32_t registerNum_;
+
+    // the max rank observed in each register
+    uint8_t* registers_;
+
+public:
+    /**
+     * @brief Construct a new Hyper Log Log object
+     *
+     * @param precision the number of index bits, [4, 18]
+     */
+    HyperLogLog(uint32_t precision = HLL_PRECISION);
+
+    /**
+     * @brief Destroy the Hyper Log Log object
+     *
+     */
+    ~HyperLogLog();
+
+    /**
+     * @brief add a key to the estimator
+     *
+     * @param key the key buffer
+     * @param keyLen the length of key
+     */
+    void add(const u_char* key, size_t keyLen);
+
+    /**
+     * @brief estimate the number of distinct keys
+     *
+     * @return double the estimated cardinality
+     */
+    double estimate();
+
+    /**
+     * @brief merge another estimator (of the same precision) into this one
+     *
+     * @param other the other estimator
+     */
+    void merge(HyperLogLog const& other);
+
+    /**
+     * @brief reset all registers
+     *
+     */
+    void clear();
+};
+
+#endif //TEDSTORE_HYPERLOGLOG_HPP
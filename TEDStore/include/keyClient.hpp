@@ -14,6 +14,8 @@
 #include <map>
 #include <utility>
 #include <gmp.h>
+#include <atomic>
+#include <functional>
 #include "threadPool.h"
 
 #define KEYMANGER_PUBLIC_KEY_FILE "key/serverpub.key"
@@ -28,10 +30,24 @@
 
 
 using namespace std;
+
+// the state of an encoding thread: its crypto contexts and the buffers of secret recovery
+typedef struct EncodeState {
+    CryptoPrimitive cryptoObj;
+    HHash hHash;
+    mpz_t share[K_PARA];
+    mpz_t secret;
+    EncodeState();
+    ~EncodeState();
+} EncodeState_t;
+
+// derive the key of the index-th chunk of a batch by the key seeds of the batch
+typedef std::function<bool(int, Data_t*, EncodeState_t&)> KeyDeriver_t;
+
 class keyClient {
 private:
     CryptoPrimitive* cryptoObj_;
-    messageQueue<Data_t>* inputMQ_;
+    messageQueue<Data_t*>* inputMQ_;
     Sender* senderObj_;
     int keyBatchSize_;
     ssl* keySecurityChannel_;
@@ -79,6 +95,69 @@ private:
     uint64_t adjustValue_;
     u_char* shareIndexArrayBuffer_;
 
+    // the encoding threads derive the keys and encrypt the chunks of a batch (NULL: in the key client thread)
+    ThreadPool* encodePool_ = NULL;
+    int encodeThreadNum_ = 0;
+    std::atomic<bool> encodeErrorFlag_;
+    // the sequence number of the next item to the sender
+    uint64_t sendSeq_ = 0;
+
+    /**
+     * @brief derive the key of a chunk by the key seed from the key server (single key server)
+     * 
+     * @param newChunk the chunk
+     * @param keySeed the key seed
+     * @param cryptoObj the crypto contexts of current thread
+     * @return true if the key is derived
+     */
+    bool deriveKey(Data_t* newChunk, u_char* keySeed, CryptoPrimitive* cryptoObj);
+
+    /**
+     * @brief derive the key of a chunk by the xor of key seeds from all key managers
+     * 
+     * @param newChunk the chunk
+     * @param index the index of chunk in the batch
+     * @param cryptoObj the crypto contexts of current thread
+     * @return true if the key is derived
+     */
+    bool deriveKeySimple(Data_t* newChunk, int index, CryptoPrimitive* cryptoObj);
+
+    /**
+     * @brief derive the key of a chunk by the secret recovered from the shares of key managers
+     * 
+     * @param newChunk the chunk
+     * @param index the index of chunk in the batch
+     * @param cryptoObj the crypto contexts of current thread
+     * @param hHash the homomorphic hash of current thread
+     * @param share the buffers of shares
+     * @param secret the buffer of recovered secret
+     * @return true if the key is derived
+     */
+    bool deriveKeySS(Data_t* newChunk, int index, CryptoPrimitive* cryptoObj, HHash* hHash, mpz_t share[K_PARA], mpz_t secret);
+
+    /**
+     * @brief derive the keys and encode the chunks of a batch by the encoding threads, a chunk
+     * goes to the sender once it is encoded, the sender restores the order
+     * 
+     * @param batchList the chunks of batch
+     * @param batchNumber the number of chunks
+     * @param deriveKey derive the key of a chunk
+     * @return true if all keys are derived, the key seeds of the batch can be reused
+     */
+    bool encodeBatch(vector<Data_t*>& batchList, int batchNumber, KeyDeriver_t deriveKey);
+
+    /**
+     * @brief wait for the chunks in the encoding threads, before the job done flag of sender
+     * 
+     * @return true if all chunks are encoded
+     */
+    bool waitEncodeDone();
+
+    /**
+     * @brief stop the sender after an encoding error, the chunks behind the failed ones are released
+     */
+    void abortEncode();
+
 public:
     keyClient(Sender* senderObjTemp);
     keyClient(uint64_t keyGenNumber);
@@ -90,9 +169,11 @@ public:
     // 
     void runKeyGenSimulator();
     bool encodeChunk(Data_t& newChunk);
-    bool insertMQFromChunker(Data_t& newChunk);
-    bool extractMQFromChunker(Data_t& newChunk);
-    bool insertMQToSender(Data_t& newChunk);
+    bool encodeChunk(Data_t& newChunk, CryptoPrimitive* cryptoObj);
+    bool insertMQFromChunker(Data_t* newChunk);
+    bool extractMQFromChunker(Data_t*& newChunk);
+    bool insertMQToSender(Data_t* newChunk);
+    bool insertRecipeToSender(Data_t* newRecipe);
     bool editJobDoneFlag();
     bool setJobDoneFlag();
     bool keyExchange(u_char* batchHashList, int batchNumber, u_char* batchKeyList, int& batchkeyNumber);
@@ -104,6 +185,15 @@ public:
 
     
 
+    /**
+     * @brief generate the short hash of a chunk sent to the key managers
+     * 
+     * @param newChunk the chunk (the fingerprint is computed by the chunker)
+     * @param maskInt the mask of each 32-bit word
+     * @param shortHash the short hash (4 * sizeof(int)) <return>
+     */
+    void generateShortHash(Data_t* newChunk, uint32_t maskInt, u_char* shortHash);
+
     /**
      * @brief convert the chunk fp to a value
      * 
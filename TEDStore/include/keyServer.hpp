@@ -5,6 +5,7 @@
 #include "cryptoPrimitive.hpp"
 #include "dataStructure.hpp"
 #include "hHash.hpp"
+#include "hyperLogLog.hpp"
 #include "messageQueue.hpp"
 #include "openssl/bn.h"
 #include "optimalSolver.hpp"
@@ -35,6 +36,15 @@ private:
     // for multiple key managers
     uint64_t secretValue_;
 
+    // the approximate unique counting across all backups
+    HyperLogLog cumulativePlainHLL_;
+    HyperLogLog cumulativeCipherHLL_;
+    uint64_t cumulativeLogicalChunks_;
+    std::mutex multiThreadEditHLLMutex_;
+
+    void countChunk(HyperLogLog& plainHLL, HyperLogLog& cipherHLL, const u_char* chunkHash, int param);
+    void reportDedupEstimate(HyperLogLog& plainHLL, HyperLogLog& cipherHLL, uint64_t logicalChunks);
+
 public:
 #if OLD_VERSION == 1
     keyServer(ssl* keySecurityChannelTemp);
@@ -7,38 +7,184 @@
 #include <boost/lockfree/queue.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
+// a bounded lock-free queue, the blocking operations spin for a while and then park the thread
 template <class T>
 class messageQueue {
     boost::lockfree::queue<T, boost::lockfree::capacity<10000>> lockFreeQueue_;
 
+    // the parked consumers (wait for data) and producers (wait for space)
+    std::mutex parkMtx_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    boost::atomic<int> waitingConsumers_;
+    boost::atomic<int> waitingProducers_;
+
+    // the adaptive spin rounds before parking
+    boost::atomic<int> spinLimit_;
+
+    // the queued items (may be off by the in-flight operations) and its high-water mark
+    boost::atomic<long> size_;
+    boost::atomic<long> highWater_;
+
+    static inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        boost::this_thread::yield();
+#endif
+    }
+
+    // wait until ready() holds, the spin grows if it pays off and shrinks if the thread parks
+    template <class Ready>
+    void waitFor(Ready ready, std::condition_variable& cond, boost::atomic<int>& waiting)
+    {
+        int spinLimit = spinLimit_.load(boost::memory_order_relaxed);
+        for (int i = 0; i < spinLimit; i++) {
+            if (ready()) {
+                if (spinLimit < MQ_SPIN_MAX) {
+                    spinLimit_.store(spinLimit * 2, boost::memory_order_relaxed);
+                }
+                return;
+            }
+            cpuRelax();
+        }
+        if (spinLimit > MQ_SPIN_MIN) {
+            spinLimit_.store(spinLimit / 2, boost::memory_order_relaxed);
+        }
+        std::unique_lock<std::mutex> lock(parkMtx_);
+        // announce before the last check, wake() reads it after publishing
+        waiting.fetch_add(1);
+        while (!ready()) {
+            cond.wait_for(lock, std::chrono::milliseconds(MQ_PARK_TIMEOUT));
+        }
+        waiting.fetch_sub(1);
+    }
+
+    // count the pushed items and raise the high-water mark
+    void countPush(long num)
+    {
+        long size = size_.fetch_add(num, boost::memory_order_relaxed) + num;
+        long highWater = highWater_.load(boost::memory_order_relaxed);
+        while (size > highWater && !highWater_.compare_exchange_weak(highWater, size, boost::memory_order_relaxed)) {
+        }
+    }
+
+    // wake the parked threads of the other side, if any
+    void wake(std::condition_variable& cond, boost::atomic<int>& waiting)
+    {
+        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+        if (waiting.load() > 0) {
+            std::lock_guard<std::mutex> lock(parkMtx_);
+            cond.notify_all();
+        }
+    }
+
 public:
     boost::atomic<bool> done_;
     messageQueue()
     {
         done_ = false;
+        waitingConsumers_ = 0;
+        waitingProducers_ = 0;
+        spinLimit_ = MQ_SPIN_MIN;
+        size_ = 0;
+        highWater_ = 0;
     }
     ~messageQueue()
     {
     }
+    // blocking push, wait while the queue is full
     bool push(T& data)
     {
-        while (!lockFreeQueue_.push(data))
-            ;
+        if (!lockFreeQueue_.push(data)) {
+            waitFor([&] { return lockFreeQueue_.push(data); }, notFull_, waitingProducers_);
+        }
+        countPush(1);
+        wake(notEmpty_, waitingConsumers_);
         return true;
     }
+    // blocking push of a batch, the consumers are woken once
+    size_t pushBatch(T* data, size_t num)
+    {
+        for (size_t i = 0; i < num; i++) {
+            if (!lockFreeQueue_.push(data[i])) {
+                // let the consumers drain the queue before waiting for space
+                wake(notEmpty_, waitingConsumers_);
+                waitFor([&] { return lockFreeQueue_.push(data[i]); }, notFull_, waitingProducers_);
+            }
+        }
+        countPush(num);
+        wake(notEmpty_, waitingConsumers_);
+        return num;
+    }
+    // non-blocking pop
     bool pop(T& data)
     {
-        return lockFreeQueue_.pop(data);
+        if (lockFreeQueue_.pop(data)) {
+            size_.fetch_sub(1, boost::memory_order_relaxed);
+            wake(notFull_, waitingProducers_);
+            return true;
+        }
+        return false;
     }
-    bool setJobDoneFlag()
+    // blocking pop, return false only if the queue is closed and drained
+    bool popWait(T& data)
+    {
+        bool popped = false;
+        waitFor([&] {
+            popped = lockFreeQueue_.pop(data);
+            return popped || (done_ && lockFreeQueue_.empty());
+        },
+            notEmpty_, waitingConsumers_);
+        if (popped) {
+            size_.fetch_sub(1, boost::memory_order_relaxed);
+            wake(notFull_, waitingProducers_);
+        }
+        return popped;
+    }
+    // blocking pop of at most maxNum items (wait for the first one only), return 0 only if the
+    // queue is closed and drained
+    size_t popBatch(T* data, size_t maxNum)
+    {
+        if (maxNum == 0 || !popWait(data[0])) {
+            return 0;
+        }
+        size_t num = 1;
+        while (num < maxNum && lockFreeQueue_.pop(data[num])) {
+            num++;
+        }
+        if (num > 1) {
+            size_.fetch_sub(num - 1, boost::memory_order_relaxed);
+            wake(notFull_, waitingProducers_);
+        }
+        return num;
+    }
+    // no more push, wake the consumers to drain the queue
+    void close()
     {
         done_ = true;
+        std::lock_guard<std::mutex> lock(parkMtx_);
+        notEmpty_.notify_all();
+    }
+    bool setJobDoneFlag()
+    {
+        close();
+        return true;
     }
     bool isEmpty()
     {
         return lockFreeQueue_.empty();
     }
+    // the most items queued at a time
+    size_t getHighWater()
+    {
+        return highWater_.load();
+    }
 };
 
-#endif //TEDSTORE_MESSAGEQUEUE_HPP
\ No newline at end of file
+#endif //TEDSTORE_MESSAGEQUEUE_HPP
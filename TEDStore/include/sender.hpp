@@ -3,6 +3,7 @@
 
 #include "configure.hpp"
 #include "cryptoPrimitive.hpp"
+#include "dataPool.hpp"
 #include "dataStructure.hpp"
 #include "messageQueue.hpp"
 #include "protocol.hpp"
@@ -13,9 +14,24 @@ private:
     std::mutex mutexSocket_;
     Socket socket_;
     int clientID_;
-    messageQueue<Data_t>* inputMQ_;
+    messageQueue<Data_t*>* inputMQ_;
+    // the chunks taken from the message queue in a batch
+    Data_t* popBuffer_[MQ_POP_BATCH_SIZE];
+    size_t popNum_ = 0;
+    size_t popPos_ = 0;
+    // the reorder buffer: the chunks encoded ahead of their turn, by the sequence number
+    std::mutex reorderMtx_;
+    std::map<uint64_t, Data_t*> reorderBuffer_;
+    uint64_t nextSeq_ = 0;
+    size_t reorderHighWater_ = 0;
+    // the recipe heads, copied out of their buffers: they keep their order among themselves only,
+    // the chunks are matched to them by count
+    std::mutex recipeMtx_;
+    std::deque<Recipe_t> recipeQueue_;
     CryptoPrimitive* cryptoObj_;
 
+    void takeRecipes(std::deque<Recipe_t>& fileRecipeList);
+
 public:
     Sender();
 
@@ -32,9 +48,11 @@ public:
     //general send data
     bool sendData(u_char* request, int requestSize, u_char* respond, int& respondSize, bool recv);
     bool sendEndFlag();
-    bool insertMQFromKeyClient(Data_t& newChunk);
-    bool extractMQFromKeyClient(Data_t& newChunk);
+    bool insertMQFromKeyClient(Data_t* newChunk);
+    bool insertRecipeFromKeyClient(Data_t* newRecipe);
+    bool extractMQFromKeyClient(Data_t*& newChunk);
     bool editJobDoneFlag();
+    bool abortJob();
 };
 
 #endif //TEDSTORE_SENDER_HPP
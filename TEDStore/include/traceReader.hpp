@@ -0,0 +1,147 @@
+/**
+ * @file traceReader.hpp
+ * @author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+ * @brief define the interface of trace reader (plain/gzip/zstd) with a reader thread
+ * @version 0.1
+ * @date 2020-10-23
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#ifndef TEDSTORE_TRACEREADER_HPP
+#define TEDSTORE_TRACEREADER_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+#include "configure.hpp"
+
+// the format of the input trace
+#define TRACE_PLAIN 0
+#define TRACE_GZIP 1
+#define TRACE_ZSTD 2
+
+// a block of decompressed trace data
+typedef struct {
+    char* data;
+    size_t len;
+} TraceBlock_t;
+
+class TraceReader {
+private:
+    // the input file name
+    std::string fileName_;
+
+    // the format of input file
+    int format_ = TRACE_PLAIN;
+
+    // the reader thread which reads and decompresses the input
+    std::thread readerThread_;
+
+    // the blocks filled by the reader thread, and the free blocks
+    std::queue<TraceBlock_t*> fullQueue_;
+    std::queue<TraceBlock_t*> freeQueue_;
+    std::mutex queueMtx_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+
+    // the reader thread reaches the end of file
+    bool readDone_ = false;
+
+    // ask the reader thread to exit
+    bool stop_ = false;
+
+    // the block consumed by readLine
+    TraceBlock_t* current_ = NULL;
+    size_t currentPos_ = 0;
+
+    // whether the reader is open
+    bool isOpen_ = false;
+
+    /**
+     * @brief detect the format of the input via the magic number
+     * 
+     * @return int the format
+     */
+    int detectFormat();
+
+    /**
+     * @brief the main loop of reader thread
+     * 
+     */
+    void readThread();
+
+    /**
+     * @brief get a free block (wait if none), return NULL if stopped
+     * 
+     * @return TraceBlock_t* the free block
+     */
+    TraceBlock_t* getFreeBlock();
+
+    /**
+     * @brief hand a filled block to the consumer
+     * 
+     * @param block the filled block
+     */
+    void putFullBlock(TraceBlock_t* block);
+
+    /**
+     * @brief switch to the next filled block
+     * 
+     * @return true there is a new block
+     * @return false the end of file
+     */
+    bool nextBlock();
+
+public:
+    /**
+     * @brief Construct a new Trace Reader object
+     * 
+     */
+    TraceReader() {};
+
+    /**
+     * @brief Destroy the Trace Reader object
+     * 
+     */
+    ~TraceReader();
+
+    /**
+     * @brief open the input file and start the reader thread
+     * 
+     * @param fileName the input file name
+     * @return true success
+     * @return false fail
+     */
+    bool open(std::string const fileName);
+
+    /**
+     * @brief read a line, the same semantic of fgets
+     * 
+     * @param buffer the line buffer
+     * @param size the size of line buffer
+     * @return char* the buffer, NULL if the end of file
+     */
+    char* readLine(char* buffer, int size);
+
+    /**
+     * @brief restart from the begin of the input
+     * 
+     */
+    void rewind();
+
+    /**
+     * @brief stop the reader thread and close the input
+     * 
+     */
+    void close();
+};
+
+#endif // TEDSTORE_TRACEREADER_HPP
@@ -1,5 +1,10 @@
 #include "chunker.hpp"
 #include "sys/time.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 extern Configure config;
 
 struct timeval timestartChunker;
@@ -9,34 +14,85 @@ struct timeval timeendChunker_VarSizeInsert;
 struct timeval timestartChunker_VarSizeHash;
 struct timeval timeendChunker_VarSizeHash;
 
-Chunker::Chunker(std::string path, keyClient* keyClientObjTemp)
+Chunker::Chunker(vector<string> pathList, keyClient* keyClientObjTemp)
 {
-    loadChunkFile(path);
-    ChunkerInit(path);
+    fileList = pathList;
     cryptoObj = new CryptoPrimitive();
+    ChunkerInit();
+    if (fileList.size() > 1) {
+        readerPool = new ThreadPool(CHUNKER_READER_THREAD_NUMBER);
+    }
     keyClientObj = keyClientObjTemp;
+    // the key client holds a batch of chunks before the key exchange, the fingerprinting stage holds its window,
+    // a recipe is copied out of its buffer when it leaves the key client
+    uint64_t minBufferNumber = 2 * config.getKeyBatchSize() + (fingerprintWindow + 1) * FINGERPRINT_BATCH_SIZE;
+    uint64_t bufferNumber = max(DATA_POOL_BUFFER_NUMBER, 2 * config.getKeyBatchSize()) + (fingerprintWindow + 1) * FINGERPRINT_BATCH_SIZE;
+    if (config.getMemoryBudget() != 0) {
+        // the chunking buffer and the send buffer are fixed, the chunks in flight take the rest of the budget,
+        // the chunker waits for a free buffer once they are used up
+        uint64_t budgetSize = config.getMemoryBudget() * 1024 * 1024;
+        uint64_t fixedSize = config.getSendChunkBatchSize() * (CHUNK_HASH_SIZE + MAX_CHUNK_SIZE + sizeof(int));
+        if (waitingForChunkingBuffer != NULL) {
+            fixedSize += ReadSize;
+        }
+        if (budgetSize < fixedSize + minBufferNumber * sizeof(PooledData_t)) {
+            cerr << "Chunker : memory budget of " << config.getMemoryBudget() << " MB is too small, need at least "
+                 << (fixedSize + minBufferNumber * sizeof(PooledData_t) + 1024 * 1024 - 1) / (1024 * 1024) << " MB" << endl;
+            exit(1);
+        }
+        bufferNumber = (budgetSize - fixedSize) / sizeof(PooledData_t);
+        cout << "Chunker : memory budget = " << config.getMemoryBudget() << " MB, " << bufferNumber << " chunks in flight at most" << endl;
+    }
+    dataPoolObj = new DataPool(min(bufferNumber, (uint64_t)UINT32_MAX));
+}
+
+Chunker::Chunker(ChunkHandler_t chunkHandlerTemp)
+{
+    cryptoObj = new CryptoPrimitive();
+    ChunkerInit();
+    chunkHandler = chunkHandlerTemp;
+    // the handler consumes each chunk before the next one, the fingerprinting stage holds its window
+    dataPoolObj = new DataPool(1 + (fingerprintWindow + 1) * FINGERPRINT_BATCH_SIZE);
 }
 
 Chunker::~Chunker()
 {
     if (powerLUT != NULL) {
-        delete powerLUT;
+        free(powerLUT);
     }
     if (removeLUT != NULL) {
-        delete removeLUT;
+        free(removeLUT);
+    }
+    if (gearTable != NULL) {
+        free(gearTable);
+    }
+    if (chunkingPool != NULL) {
+        delete chunkingPool;
+    }
+    if (fingerprintPool != NULL) {
+        delete fingerprintPool;
+    }
+    if (readerPool != NULL) {
+        delete readerPool;
     }
     if (waitingForChunkingBuffer != NULL) {
-        delete waitingForChunkingBuffer;
+        delete[] waitingForChunkingBuffer;
     }
     if (chunkBuffer != NULL) {
-        delete chunkBuffer;
+        delete[] chunkBuffer;
     }
     if (cryptoObj != NULL) {
         delete cryptoObj;
     }
+    if (dataPoolObj != NULL) {
+        delete dataPoolObj;
+    }
     if (chunkingFile.is_open()) {
         chunkingFile.close();
     }
+    if (mappedFile != NULL) {
+        munmap(mappedFile, mappedSize);
+    }
 }
 
 std::ifstream& Chunker::getChunkingFile()
@@ -53,6 +109,7 @@ void Chunker::loadChunkFile(std::string path)
     if (chunkingFile.is_open()) {
         chunkingFile.close();
     }
+    chunkingFilePath = path;
     chunkingFile.open(path, std::ios::binary);
     if (!chunkingFile.is_open()) {
         cerr << "Chunker : open file: " << path << "error, client exit now" << endl;
@@ -60,15 +117,159 @@ void Chunker::loadChunkFile(std::string path)
     }
 }
 
-void Chunker::ChunkerInit(string path)
+void Chunker::mapChunkFile()
+{
+#if CHUNKER_INPUT_MMAP == 1
+    int fd = open(chunkingFilePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat fileStat;
+    /*only a non-empty regular file is mapped, otherwise read by chunkingFile*/
+    if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+        void* mapped = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            mappedFile = (u_char*)mapped;
+            mappedSize = fileStat.st_size;
+            madvise(mappedFile, mappedSize, MADV_SEQUENTIAL);
+            madvise(mappedFile, min(mappedSize, ReadSize), MADV_WILLNEED);
+        }
+    }
+    close(fd);
+#endif
+}
+
+uint64_t Chunker::readInput(u_char*& block, uint64_t remainSize, bool& fileEnd)
+{
+    /*the last remainSize bytes of the previous block are not chunked yet, the new block starts with them*/
+    if (mappedFile != NULL) {
+        mappedOffset -= remainSize;
+        block = mappedFile + mappedOffset;
+        uint64_t len = min(ReadSize, mappedSize - mappedOffset);
+        uint64_t pageSize = sysconf(_SC_PAGESIZE);
+        /*drop the chunked pages from the mapping, and read the next block ahead while this one is chunked*/
+        uint64_t chunkedEnd = mappedOffset / pageSize * pageSize;
+        if (chunkedEnd > mappedDropped) {
+            madvise(mappedFile + mappedDropped, chunkedEnd - mappedDropped, MADV_DONTNEED);
+            mappedDropped = chunkedEnd;
+        }
+        mappedOffset += len;
+        fileEnd = (mappedOffset == mappedSize);
+        if (!fileEnd) {
+            uint64_t nextStart = mappedOffset / pageSize * pageSize;
+            madvise(mappedFile + nextStart, min(ReadSize, mappedSize - nextStart), MADV_WILLNEED);
+        }
+        return len;
+    }
+    std::ifstream& fin = getChunkingFile();
+    if (remainSize != 0) {
+        memmove(waitingForChunkingBuffer, waitingForChunkingBuffer + inputBlockSize - remainSize, remainSize);
+    }
+    fin.read((char*)waitingForChunkingBuffer + remainSize, sizeof(unsigned char) * (ReadSize - remainSize));
+    inputBlockSize = remainSize + fin.gcount();
+    fileEnd = fin.eof();
+    block = waitingForChunkingBuffer;
+    return inputBlockSize;
+}
+
+void Chunker::openChunkFile(string path)
 {
+    loadChunkFile(path);
     u_char filePathHash[FILE_NAME_HASH_SIZE];
     cryptoObj->generateHash((u_char*)&path[0], path.length(), filePathHash);
     memcpy(fileRecipe.recipe.fileRecipeHead.fileNameHash, filePathHash, FILE_NAME_HASH_SIZE);
     memcpy(fileRecipe.recipe.keyRecipeHead.fileNameHash, filePathHash, FILE_NAME_HASH_SIZE);
 
+    if (mappedFile != NULL) {
+        munmap(mappedFile, mappedSize);
+        mappedFile = NULL;
+    }
+    mappedSize = mappedOffset = mappedDropped = inputBlockSize = 0;
+    if (ChunkerType == CHUNKER_FIX_SIZE_TYPE || ChunkerType == CHUNKER_VAR_SIZE_TYPE || ChunkerType == CHUNKER_FAST_CDC_TYPE) {
+        mapChunkFile();
+    }
+}
+
+void Chunker::prefetchFile(string path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    /*a small file is read in whole, a large one only at its head (the rest is read ahead while chunking)*/
+    posix_fadvise(fd, 0, CHUNKER_PREFETCH_SIZE, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+void Chunker::prefetchFiles(size_t fileIndex)
+{
+    if (readerPool == NULL) {
+        return;
+    }
+    size_t prefetchEnd = min(fileList.size(), fileIndex + 1 + CHUNKER_PREFETCH_FILE_NUMBER);
+    if (prefetchedFileIndex <= fileIndex) {
+        prefetchedFileIndex = fileIndex + 1;
+    }
+    for (; prefetchedFileIndex < prefetchEnd; prefetchedFileIndex++) {
+        readerPool->enqueue(&Chunker::prefetchFile, fileList[prefetchedFileIndex]);
+    }
+}
+
+void Chunker::collectFiles(string path, vector<string>& pathList, bool isRoot)
+{
+    // follow the symbolic links to files, and the root if it links to a directory
+    struct stat pathStat;
+    if (stat(path.c_str(), &pathStat) != 0) {
+        cerr << "Chunker : cannot access " << path << endl;
+        return;
+    }
+    if (S_ISREG(pathStat.st_mode)) {
+        if (access(path.c_str(), R_OK) == 0) {
+            pathList.push_back(path);
+        } else {
+            cerr << "Chunker : skip the unreadable file " << path << endl;
+        }
+        return;
+    }
+    if (!S_ISDIR(pathStat.st_mode)) {
+        return;
+    }
+    // a linked directory under the root may lead to a loop
+    struct stat linkStat;
+    if (!isRoot && lstat(path.c_str(), &linkStat) == 0 && S_ISLNK(linkStat.st_mode)) {
+        cerr << "Chunker : skip the linked directory " << path << endl;
+        return;
+    }
+    DIR* dir = opendir(path.c_str());
+    if (dir == NULL) {
+        cerr << "Chunker : cannot open the directory " << path << endl;
+        return;
+    }
+    vector<string> nameList;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            nameList.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    sort(nameList.begin(), nameList.end());
+    for (size_t i = 0; i < nameList.size(); i++) {
+        collectFiles(path + "/" + nameList[i], pathList, false);
+    }
+}
+
+void Chunker::ChunkerInit()
+{
     ChunkerType = (int)config.getChunkingType();
 
+    int fingerprintThreadNum = (int)config.getFingerprintThreadNum();
+    if (fingerprintThreadNum > 0) {
+        fingerprintPool = new ThreadPool(fingerprintThreadNum);
+        fingerprintWindow = fingerprintThreadNum * FINGERPRINT_WINDOW_PER_THREAD;
+        fingerprintBatch.reserve(FINGERPRINT_BATCH_SIZE);
+    }
+
     if (ChunkerType == CHUNKER_VAR_SIZE_TYPE) {
         int numOfMaskBits;
         avgChunkSize = (int)config.getAverageChunkSize();
@@ -92,6 +293,10 @@ void Chunker::ChunkerInit(string path)
             cerr << "Chunker : maxChunkSize should be larger than avgChunkSize!" << endl;
             exit(1);
         }
+        if ((uint64_t)maxChunkSize >= ReadSize) {
+            cerr << "Chunker : ReadSize should be larger than maxChunkSize!" << endl;
+            exit(1);
+        }
 
         /*initialize the base and modulus for calculating the fingerprint of a window*/
         /*these two values were employed in open-vcdiff: "http://code.google.com/p/open-vcdiff/"*/
@@ -128,6 +333,14 @@ void Chunker::ChunkerInit(string path)
         anchorMask = (1 << numOfMaskBits) - 1;
         /*initialize the value for depolytermining an anchor*/
         anchorValue = 0;
+
+        /*the anchors can be found in parallel only if the window is always full at the anchor checks*/
+        chunkingThreadNum = (int)config.getChunkingThreadNum();
+        if (chunkingThreadNum > 1 && slidingWinSize < minChunkSize) {
+            chunkingPool = new ThreadPool(chunkingThreadNum);
+        } else {
+            chunkingThreadNum = 1;
+        }
     } else if (ChunkerType == CHUNKER_FIX_SIZE_TYPE) {
 
         avgChunkSize = (int)config.getAverageChunkSize();
@@ -170,6 +383,52 @@ void Chunker::ChunkerInit(string path)
         if (ReadSize % avgChunkSize != 0) {
             cerr << "Chunker : Setting fixed size chunking error : ReadSize not compat with average chunk size" << endl;
         }
+    } else if (ChunkerType == CHUNKER_FAST_CDC_TYPE) {
+        int numOfMaskBits;
+        avgChunkSize = (int)config.getAverageChunkSize();
+        minChunkSize = (int)config.getMinChunkSize();
+        maxChunkSize = (int)config.getMaxChunkSize();
+        ReadSize = config.getReadSize();
+        ReadSize = ReadSize * 1024 * 1024;
+        waitingForChunkingBuffer = new u_char[ReadSize];
+
+        if (waitingForChunkingBuffer == NULL) {
+            cerr << "Chunker : Memory malloc error" << endl;
+            exit(1);
+        }
+        if (minChunkSize >= avgChunkSize) {
+            cerr << "Chunker : minChunkSize should be smaller than avgChunkSize!" << endl;
+            exit(1);
+        }
+        if (maxChunkSize <= avgChunkSize) {
+            cerr << "Chunker : maxChunkSize should be larger than avgChunkSize!" << endl;
+            exit(1);
+        }
+        if ((uint64_t)maxChunkSize >= ReadSize) {
+            cerr << "Chunker : ReadSize should be larger than maxChunkSize!" << endl;
+            exit(1);
+        }
+
+        /*initialize the Gear table by splitmix64 with a fixed seed, so that the cut points are the same on all clients*/
+        gearTable = (uint64_t*)malloc(sizeof(uint64_t) * 256); /*256 for unsigned char*/
+        uint64_t seed = GEAR_TABLE_SEED;
+        for (int i = 0; i < 256; i++) {
+            uint64_t value = (seed += 0x9e3779b97f4a7c15ULL);
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+            gearTable[i] = value ^ (value >> 31);
+        }
+
+        /*normalized chunking: power(2, numOfMaskBits) = avgChunkSize, use more mask bits before avgChunkSize and fewer after it*/
+        /*the mask takes the high bits of the fingerprint, which depend on the last GEAR_WINDOW_SIZE bytes*/
+        numOfMaskBits = 1;
+        while ((avgChunkSize >> numOfMaskBits) != 1) {
+            numOfMaskBits++;
+        }
+        int numOfMaskBitsS = numOfMaskBits + GEAR_NORMAL_LEVEL;
+        int numOfMaskBitsL = max(numOfMaskBits - GEAR_NORMAL_LEVEL, 1);
+        gearMaskS = ((1ULL << numOfMaskBitsS) - 1) << (GEAR_WINDOW_SIZE - numOfMaskBitsS);
+        gearMaskL = ((1ULL << numOfMaskBitsL) - 1) << (GEAR_WINDOW_SIZE - numOfMaskBitsL);
     } else if (ChunkerType == CHUNKER_TRACE_DRIVEN_TYPE_FSL) {
         maxChunkSize = (int)config.getMaxChunkSize();
         chunkBuffer = new u_char[maxChunkSize + 6];
@@ -181,42 +440,79 @@ void Chunker::ChunkerInit(string path)
 
 bool Chunker::chunking()
 {
-    /*fixed-size Chunker*/
-    if (ChunkerType == CHUNKER_FIX_SIZE_TYPE) {
-        fixSizeChunking();
-    }
-    /*variable-size Chunker*/
-    if (ChunkerType == CHUNKER_VAR_SIZE_TYPE) {
-        varSizeChunking();
-    }
+    /*the files share the pipeline, each of them is followed by its own recipe*/
+    bool status = true;
+    for (size_t fileIndex = 0; fileIndex < fileList.size() && status; fileIndex++) {
+        openChunkFile(fileList[fileIndex]);
+        prefetchFiles(fileIndex);
+
+        /*fixed-size Chunker*/
+        if (ChunkerType == CHUNKER_FIX_SIZE_TYPE) {
+            status = fixSizeChunking();
+        }
+        /*variable-size Chunker*/
+        if (ChunkerType == CHUNKER_VAR_SIZE_TYPE) {
+            if (chunkingThreadNum > 1) {
+                status = parallelVarSizeChunking();
+            } else {
+                status = varSizeChunking();
+            }
+        }
+
+        /*FastCDC Chunker*/
+        if (ChunkerType == CHUNKER_FAST_CDC_TYPE) {
+            status = fastCDCChunking();
+        }
+
+        if (ChunkerType == CHUNKER_TRACE_DRIVEN_TYPE_FSL) {
+            status = traceDrivenChunkingFSL();
+        }
 
-    if (ChunkerType == CHUNKER_TRACE_DRIVEN_TYPE_FSL) {
-        traceDrivenChunkingFSL();
+        if (ChunkerType == CHUNKER_TRACE_DRIVEN_TYPE_UBC) {
+            status = traceDrivenChunkingUBC();
+        }
+        if (!status) {
+            // the sender matches the chunks to the recipes by count, no later file can be sent
+            cerr << "Chunker : chunking " << fileList[fileIndex] << " fails, stop the session" << endl;
+            dropFingerprint();
+        }
+    }
+    if (status && fileList.size() > 1) {
+        cout << "Chunker : chunking over, total file number = " << fileList.size() << endl;
     }
+#if SYSTEM_BREAK_DOWN == 1
+    // no buffer is taken after chunking, the high-water mark is final
+    cout << "Chunker : chunks in flight high-water mark = " << dataPoolObj->getHighWaterNumber() << " of " << dataPoolObj->getBufferNumber()
+         << " (" << dataPoolObj->getHighWaterNumber() * sizeof(PooledData_t) / (1024 * 1024) << " MB)" << endl;
+#endif
 
-    if (ChunkerType == CHUNKER_TRACE_DRIVEN_TYPE_UBC) {
-        traceDrivenChunkingUBC();
+    if (setJobDoneFlag() == false) {
+        cerr << "Chunker : set chunking done flag error" << endl;
+        return false;
     }
+    return status;
+}
 
-    return true;
+bool Chunker::chunking(std::string path)
+{
+    // the buffers and threads of the chunker are reused for another file
+    fileList.assign(1, path);
+    return chunking();
 }
 
-void Chunker::fixSizeChunking()
+bool Chunker::fixSizeChunking()
 {
     double chunkTime = 0;
-    double hashTime = 0;
     long diff;
     double second;
-    std::ifstream& fin = getChunkingFile();
     uint64_t chunkIDCounter = 0;
     memset(chunkBuffer, 0, sizeof(char) * avgChunkSize);
     uint64_t fileSize = 0;
-    u_char hash[CHUNK_HASH_SIZE];
+    u_char* block;
+    bool fileEnd = false;
     /*start chunking*/
     while (true) {
-        memset((char*)waitingForChunkingBuffer, 0, sizeof(unsigned char) * ReadSize);
-        fin.read((char*)waitingForChunkingBuffer, sizeof(char) * ReadSize);
-        uint64_t totalReadSize = fin.gcount();
+        uint64_t totalReadSize = readInput(block, 0, fileEnd);
         fileSize += totalReadSize;
         uint64_t chunkedSize = 0;
         if (totalReadSize == ReadSize) {
@@ -225,104 +521,56 @@ void Chunker::fixSizeChunking()
                 gettimeofday(&timestartChunker, NULL);
 #endif
                 memset(chunkBuffer, 0, sizeof(char) * avgChunkSize);
-                memcpy(chunkBuffer, waitingForChunkingBuffer + chunkedSize, avgChunkSize);
+                memcpy(chunkBuffer, block + chunkedSize, avgChunkSize);
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timeendChunker, NULL);
                 diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
                 second = diff / 1000000.0;
                 chunkTime += second;
 #endif
-#if SYSTEM_BREAK_DOWN == 1
-                gettimeofday(&timestartChunker, NULL);
-#endif
-                if (!cryptoObj->generateHash(chunkBuffer, avgChunkSize, hash)) {
-                    cerr << "Chunker : fixed size chunking: compute hash error" << endl;
+                Data_t* tempChunk = dataPoolObj->get();
+                tempChunk->chunk.ID = chunkIDCounter;
+                tempChunk->chunk.logicDataSize = avgChunkSize;
+                memcpy(tempChunk->chunk.logicData, chunkBuffer, avgChunkSize);
+                tempChunk->dataType = DATA_TYPE_CHUNK;
+
+                if (!insertChunk(tempChunk)) {
+                    cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCounter << endl;
+                    return false;
                 }
-#if SYSTEM_BREAK_DOWN == 1
-                gettimeofday(&timeendChunker, NULL);
-                diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
-                second = diff / 1000000.0;
-                hashTime += second;
-#endif
-                Data_t tempChunk;
-                tempChunk.chunk.ID = chunkIDCounter;
-                tempChunk.chunk.logicDataSize = avgChunkSize;
-                memcpy(tempChunk.chunk.logicData, chunkBuffer, avgChunkSize);
-                memcpy(tempChunk.chunk.chunkHash, hash, CHUNK_HASH_SIZE);
-                tempChunk.dataType = DATA_TYPE_CHUNK;
-
-                insertMQToKeyClient(tempChunk);
                 chunkIDCounter++;
                 chunkedSize += avgChunkSize;
             }
         } else {
-            uint64_t retSize = 0;
+            /*the tail of file: the last chunk may be smaller than avgChunkSize*/
             while (chunkedSize < totalReadSize) {
+                uint64_t retSize = totalReadSize - chunkedSize;
+                int currentChunkSize = (retSize > (uint64_t)avgChunkSize) ? avgChunkSize : (int)retSize;
                 memset(chunkBuffer, 0, sizeof(char) * avgChunkSize);
-                Data_t tempChunk;
-                if (retSize > avgChunkSize) {
+                Data_t* tempChunk = dataPoolObj->get();
 #if SYSTEM_BREAK_DOWN == 1
-                    gettimeofday(&timestartChunker, NULL);
-#endif
-                    memcpy(chunkBuffer, waitingForChunkingBuffer + chunkedSize, avgChunkSize);
-#if SYSTEM_BREAK_DOWN == 1
-                    gettimeofday(&timeendChunker, NULL);
-                    diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
-                    second = diff / 1000000.0;
-                    chunkTime += second;
-#endif
-#if SYSTEM_BREAK_DOWN == 1
-                    gettimeofday(&timestartChunker, NULL);
-#endif
-                    if (!cryptoObj->generateHash(chunkBuffer, avgChunkSize, hash)) {
-                        cerr << "Chunker : fixed size chunking: compute hash error" << endl;
-                    }
-#if SYSTEM_BREAK_DOWN == 1
-                    gettimeofday(&timeendChunker, NULL);
-                    diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
-                    second = diff / 1000000.0;
-                    hashTime += second;
-#endif
-                    tempChunk.chunk.ID = chunkIDCounter;
-                    tempChunk.chunk.logicDataSize = avgChunkSize;
-                    memcpy(tempChunk.chunk.logicData, chunkBuffer, avgChunkSize);
-                    memcpy(tempChunk.chunk.chunkHash, hash, CHUNK_HASH_SIZE);
-                } else {
-#if SYSTEM_BREAK_DOWN == 1
-                    gettimeofday(&timestartChunker, NULL);
-#endif
-                    memcpy(chunkBuffer, waitingForChunkingBuffer + chunkedSize, retSize);
-#if SYSTEM_BREAK_DOWN == 1
-                    gettimeofday(&timeendChunker, NULL);
-                    diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
-                    second = diff / 1000000.0;
-                    chunkTime += second;
+                gettimeofday(&timestartChunker, NULL);
 #endif
+                memcpy(chunkBuffer, block + chunkedSize, currentChunkSize);
 #if SYSTEM_BREAK_DOWN == 1
-                    gettimeofday(&timestartChunker, NULL);
-#endif
-                    if (!cryptoObj->generateHash(chunkBuffer, retSize, hash)) {
-                        cerr << "Chunker : fixed size chunking: compute hash error" << endl;
-                    }
-#if SYSTEM_BREAK_DOWN == 1
-                    gettimeofday(&timeendChunker, NULL);
-                    diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
-                    second = diff / 1000000.0;
-                    hashTime += second;
+                gettimeofday(&timeendChunker, NULL);
+                diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
+                second = diff / 1000000.0;
+                chunkTime += second;
 #endif
-                    tempChunk.chunk.ID = chunkIDCounter;
-                    tempChunk.chunk.logicDataSize = retSize;
-                    memcpy(tempChunk.chunk.logicData, chunkBuffer, retSize);
-                    memcpy(tempChunk.chunk.chunkHash, hash, CHUNK_HASH_SIZE);
+                tempChunk->chunk.ID = chunkIDCounter;
+                tempChunk->chunk.logicDataSize = currentChunkSize;
+                memcpy(tempChunk->chunk.logicData, chunkBuffer, currentChunkSize);
+                tempChunk->dataType = DATA_TYPE_CHUNK;
+                if (!insertChunk(tempChunk)) {
+                    cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCounter << endl;
+                    return false;
                 }
-                retSize = totalReadSize - chunkedSize;
-                tempChunk.dataType = DATA_TYPE_CHUNK;
-                insertMQToKeyClient(tempChunk);
                 chunkIDCounter++;
-                chunkedSize += avgChunkSize;
+                chunkedSize += currentChunkSize;
             }
         }
-        if (fin.eof()) {
+        if (fileEnd) {
             break;
         }
     }
@@ -331,38 +579,34 @@ void Chunker::fixSizeChunking()
     fileRecipe.recipe.fileRecipeHead.fileSize = fileSize;
     fileRecipe.recipe.keyRecipeHead.fileSize = fileRecipe.recipe.fileRecipeHead.fileSize;
     fileRecipe.dataType = DATA_TYPE_RECIPE;
-    insertMQToKeyClient(fileRecipe);
-    if (setJobDoneFlag() == false) {
-        cerr << "Chunker : set chunking done flag error" << endl;
+    if (!insertRecipeToKeyClient()) {
+        cerr << "Chunker : error insert recipe head to keyClient message queue" << endl;
+        return false;
     }
     cout << "Chunker : Fixed chunking over:\nTotal file size = " << fileRecipe.recipe.fileRecipeHead.fileSize << "; Total chunk number = " << fileRecipe.recipe.fileRecipeHead.totalChunkNumber << endl;
 #if SYSTEM_BREAK_DOWN == 1
     cout << "Chunker : total chunking time = " << chunkTime << " s" << endl;
     cout << "Chunker : total hashing time = " << hashTime << " s" << endl;
 #endif
+    return true;
 }
 
-void Chunker::traceDrivenChunkingFSL()
+bool Chunker::traceDrivenChunkingFSL()
 {
     double chunkTime = 0;
-    double hashTime = 0;
     long diff;
     double second;
-    std::ifstream& fin = getChunkingFile();
+    TraceReader traceReader;
+    if (!traceReader.open(chunkingFilePath)) {
+        cerr << "Chunker : open trace file: " << chunkingFilePath << " error, client exit now" << endl;
+        exit(1);
+    }
     uint64_t chunkIDCounter = 0;
     uint64_t fileSize = 0;
-    u_char hash[CHUNK_HASH_SIZE];
     char readLineBuffer[256];
-    string readLineStr;
-    /*start chunking*/
-    getline(fin, readLineStr);
-    while (true) {
-        getline(fin, readLineStr);
-        if (fin.eof()) {
-            break;
-        }
-        memset(readLineBuffer, 0, 256);
-        memcpy(readLineBuffer, (char*)readLineStr.c_str(), readLineStr.length());
+    /*start chunking, the trace (plain/gzip/zstd) is decoded in the reader thread*/
+    traceReader.readLine(readLineBuffer, 256);
+    while (traceReader.readLine(readLineBuffer, 256) != NULL) {
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timestartChunker, NULL);
 #endif
@@ -391,26 +635,16 @@ void Chunker::traceDrivenChunkingFSL()
         second = diff / 1000000.0;
         chunkTime += second;
 #endif
-#if SYSTEM_BREAK_DOWN == 1
-        gettimeofday(&timestartChunker, NULL);
-#endif
-        if (!cryptoObj->generateHash(chunkBuffer, size, hash)) {
-            cerr << "Chunker : trace driven chunking: compute hash error" << endl;
+        Data_t* tempChunk = dataPoolObj->get();
+        tempChunk->chunk.ID = chunkIDCounter;
+        tempChunk->chunk.logicDataSize = size;
+        memcpy(tempChunk->chunk.logicData, chunkBuffer, size);
+        tempChunk->dataType = DATA_TYPE_CHUNK;
+
+        if (!insertChunk(tempChunk)) {
+            cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCounter << endl;
+            return false;
         }
-#if SYSTEM_BREAK_DOWN == 1
-        gettimeofday(&timeendChunker, NULL);
-        diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
-        second = diff / 1000000.0;
-        hashTime += second;
-#endif
-        Data_t tempChunk;
-        tempChunk.chunk.ID = chunkIDCounter;
-        tempChunk.chunk.logicDataSize = size;
-        memcpy(tempChunk.chunk.logicData, chunkBuffer, size);
-        memcpy(tempChunk.chunk.chunkHash, hash, CHUNK_HASH_SIZE);
-        tempChunk.dataType = DATA_TYPE_CHUNK;
-
-        insertMQToKeyClient(tempChunk);
         chunkIDCounter++;
         fileSize += size;
     }
@@ -419,38 +653,34 @@ void Chunker::traceDrivenChunkingFSL()
     fileRecipe.recipe.fileRecipeHead.fileSize = fileSize;
     fileRecipe.recipe.keyRecipeHead.fileSize = fileRecipe.recipe.fileRecipeHead.fileSize;
     fileRecipe.dataType = DATA_TYPE_RECIPE;
-    insertMQToKeyClient(fileRecipe);
-    if (setJobDoneFlag() == false) {
-        cerr << "Chunker : set chunking done flag error" << endl;
+    if (!insertRecipeToKeyClient()) {
+        cerr << "Chunker : error insert recipe head to keyClient message queue" << endl;
+        return false;
     }
     cout << "Chunker : trace gen over:\nTotal file size = " << fileRecipe.recipe.fileRecipeHead.fileSize << "; Total chunk number = " << fileRecipe.recipe.fileRecipeHead.totalChunkNumber << endl;
 #if SYSTEM_BREAK_DOWN == 1
     cout << "Chunker : total chunking time = " << chunkTime << " s" << endl;
     cout << "Chunker : total hashing time = " << hashTime << " s" << endl;
 #endif
+    return true;
 }
 
-void Chunker::traceDrivenChunkingUBC()
+bool Chunker::traceDrivenChunkingUBC()
 {
     double chunkTime = 0;
-    double hashTime = 0;
     long diff;
     double second;
-    std::ifstream& fin = getChunkingFile();
+    TraceReader traceReader;
+    if (!traceReader.open(chunkingFilePath)) {
+        cerr << "Chunker : open trace file: " << chunkingFilePath << " error, client exit now" << endl;
+        exit(1);
+    }
     uint64_t chunkIDCounter = 0;
     uint64_t fileSize = 0;
-    u_char hash[CHUNK_HASH_SIZE];
     char readLineBuffer[256];
-    string readLineStr;
-    /*start chunking*/
-    getline(fin, readLineStr);
-    while (true) {
-        getline(fin, readLineStr);
-        if (fin.eof()) {
-            break;
-        }
-        memset(readLineBuffer, 0, 256);
-        memcpy(readLineBuffer, (char*)readLineStr.c_str(), readLineStr.length());
+    /*start chunking, the trace (plain/gzip/zstd) is decoded in the reader thread*/
+    traceReader.readLine(readLineBuffer, 256);
+    while (traceReader.readLine(readLineBuffer, 256) != NULL) {
 
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timestartChunker, NULL);
@@ -480,26 +710,16 @@ void Chunker::traceDrivenChunkingUBC()
         second = diff / 1000000.0;
         chunkTime += second;
 #endif
-#if SYSTEM_BREAK_DOWN == 1
-        gettimeofday(&timestartChunker, NULL);
-#endif
-        if (!cryptoObj->generateHash(chunkBuffer, size, hash)) {
-            cerr << "Chunker : trace driven chunking: compute hash error" << endl;
+        Data_t* tempChunk = dataPoolObj->get();
+        tempChunk->chunk.ID = chunkIDCounter;
+        tempChunk->chunk.logicDataSize = size;
+        memcpy(tempChunk->chunk.logicData, chunkBuffer, size);
+        tempChunk->dataType = DATA_TYPE_CHUNK;
+
+        if (!insertChunk(tempChunk)) {
+            cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCounter << endl;
+            return false;
         }
-#if SYSTEM_BREAK_DOWN == 1
-        gettimeofday(&timeendChunker, NULL);
-        diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
-        second = diff / 1000000.0;
-        hashTime += second;
-#endif
-        Data_t tempChunk;
-        tempChunk.chunk.ID = chunkIDCounter;
-        tempChunk.chunk.logicDataSize = size;
-        memcpy(tempChunk.chunk.logicData, chunkBuffer, size);
-        memcpy(tempChunk.chunk.chunkHash, hash, CHUNK_HASH_SIZE);
-        tempChunk.dataType = DATA_TYPE_CHUNK;
-
-        insertMQToKeyClient(tempChunk);
         chunkIDCounter++;
         fileSize += size;
     }
@@ -508,40 +728,38 @@ void Chunker::traceDrivenChunkingUBC()
     fileRecipe.recipe.fileRecipeHead.fileSize = fileSize;
     fileRecipe.recipe.keyRecipeHead.fileSize = fileRecipe.recipe.fileRecipeHead.fileSize;
     fileRecipe.dataType = DATA_TYPE_RECIPE;
-    insertMQToKeyClient(fileRecipe);
-    if (setJobDoneFlag() == false) {
-        cerr << "Chunker : set chunking done flag error" << endl;
+    if (!insertRecipeToKeyClient()) {
+        cerr << "Chunker : error insert recipe head to keyClient message queue" << endl;
+        return false;
     }
     cout << "Chunker : trace gen over:\nTotal file size = " << fileRecipe.recipe.fileRecipeHead.fileSize << "; Total chunk number = " << fileRecipe.recipe.fileRecipeHead.totalChunkNumber << endl;
 #if SYSTEM_BREAK_DOWN == 1
     cout << "Chunker : total chunking time = " << chunkTime << " s" << endl;
     cout << "Chunker : total hashing time = " << hashTime << " s" << endl;
 #endif
+    return true;
 }
 
-void Chunker::varSizeChunking()
+bool Chunker::varSizeChunking()
 {
     double insertTime = 0;
-    double hashTime = 0;
     long diff;
     double second;
-    uint16_t winFp;
+    uint16_t winFp = 0;
     uint64_t chunkBufferCnt = 0, chunkIDCnt = 0;
-    ifstream& fin = getChunkingFile();
     uint64_t fileSize = 0;
-    u_char hash[CHUNK_HASH_SIZE];
+    u_char* block;
+    bool fileEnd = false;
 /*start chunking*/
 #if SYSTEM_BREAK_DOWN == 1
     gettimeofday(&timestartChunker, NULL);
 #endif
     while (true) {
-        memset((char*)waitingForChunkingBuffer, 0, sizeof(unsigned char) * ReadSize);
-        fin.read((char*)waitingForChunkingBuffer, sizeof(unsigned char) * ReadSize);
-        int len = fin.gcount();
+        uint64_t len = readInput(block, 0, fileEnd);
         fileSize += len;
-        for (int i = 0; i < len; i++) {
+        for (uint64_t i = 0; i < len; i++) {
 
-            chunkBuffer[chunkBufferCnt] = waitingForChunkingBuffer[i];
+            chunkBuffer[chunkBufferCnt] = block[i];
 
             /*full fill sliding window*/
             if (chunkBufferCnt < slidingWinSize) {
@@ -562,31 +780,17 @@ void Chunker::varSizeChunking()
 
             /*find chunk pattern*/
             if ((winFp & anchorMask) == anchorValue) {
-#if SYSTEM_BREAK_DOWN == 1
-                gettimeofday(&timestartChunker_VarSizeHash, NULL);
-#endif
-                if (!cryptoObj->generateHash(chunkBuffer, chunkBufferCnt, hash)) {
-                    cerr << "Chunker : average size chunking compute hash error" << endl;
-                    return;
-                }
-#if SYSTEM_BREAK_DOWN == 1
-                gettimeofday(&timeendChunker_VarSizeHash, NULL);
-                diff = 1000000 * (timeendChunker_VarSizeHash.tv_sec - timestartChunker_VarSizeHash.tv_sec) + timeendChunker_VarSizeHash.tv_usec - timestartChunker_VarSizeHash.tv_usec;
-                second = diff / 1000000.0;
-                hashTime += second;
-#endif
-                Data_t tempChunk;
-                tempChunk.chunk.ID = chunkIDCnt;
-                tempChunk.chunk.logicDataSize = chunkBufferCnt;
-                memcpy(tempChunk.chunk.logicData, chunkBuffer, chunkBufferCnt);
-                memcpy(tempChunk.chunk.chunkHash, hash, CHUNK_HASH_SIZE);
-                tempChunk.dataType = DATA_TYPE_CHUNK;
+                Data_t* tempChunk = dataPoolObj->get();
+                tempChunk->chunk.ID = chunkIDCnt;
+                tempChunk->chunk.logicDataSize = chunkBufferCnt;
+                memcpy(tempChunk->chunk.logicData, chunkBuffer, chunkBufferCnt);
+                tempChunk->dataType = DATA_TYPE_CHUNK;
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timestartChunker_VarSizeInsert, NULL);
 #endif
-                if (!insertMQToKeyClient(tempChunk)) {
-                    cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << tempChunk.chunk.ID << endl;
-                    return;
+                if (!insertChunk(tempChunk)) {
+                    cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCnt << endl;
+                    return false;
                 }
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timeendChunker_VarSizeInsert, NULL);
@@ -600,31 +804,17 @@ void Chunker::varSizeChunking()
 
             /*chunk's size exceed maxChunkSize*/
             if (chunkBufferCnt >= maxChunkSize) {
-#if SYSTEM_BREAK_DOWN == 1
-                gettimeofday(&timestartChunker_VarSizeHash, NULL);
-#endif
-                if (!cryptoObj->generateHash(chunkBuffer, chunkBufferCnt, hash)) {
-                    cerr << "Chunker : average size chunking compute hash error" << endl;
-                    return;
-                }
-#if SYSTEM_BREAK_DOWN == 1
-                gettimeofday(&timeendChunker_VarSizeHash, NULL);
-                diff = 1000000 * (timeendChunker_VarSizeHash.tv_sec - timestartChunker_VarSizeHash.tv_sec) + timeendChunker_VarSizeHash.tv_usec - timestartChunker_VarSizeHash.tv_usec;
-                second = diff / 1000000.0;
-                hashTime += second;
-#endif
-                Data_t tempChunk;
-                tempChunk.chunk.ID = chunkIDCnt;
-                tempChunk.chunk.logicDataSize = chunkBufferCnt;
-                memcpy(tempChunk.chunk.logicData, chunkBuffer, chunkBufferCnt);
-                memcpy(tempChunk.chunk.chunkHash, hash, CHUNK_HASH_SIZE);
-                tempChunk.dataType = DATA_TYPE_CHUNK;
+                Data_t* tempChunk = dataPoolObj->get();
+                tempChunk->chunk.ID = chunkIDCnt;
+                tempChunk->chunk.logicDataSize = chunkBufferCnt;
+                memcpy(tempChunk->chunk.logicData, chunkBuffer, chunkBufferCnt);
+                tempChunk->dataType = DATA_TYPE_CHUNK;
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timestartChunker_VarSizeInsert, NULL);
 #endif
-                if (!insertMQToKeyClient(tempChunk)) {
-                    cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << tempChunk.chunk.ID << endl;
-                    return;
+                if (!insertChunk(tempChunk)) {
+                    cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCnt << endl;
+                    return false;
                 }
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timeendChunker_VarSizeInsert, NULL);
@@ -636,38 +826,24 @@ void Chunker::varSizeChunking()
                 chunkBufferCnt = winFp = 0;
             }
         }
-        if (fin.eof()) {
+        if (fileEnd) {
             break;
         }
     }
 
     /*add final chunk*/
     if (chunkBufferCnt != 0) {
-#if SYSTEM_BREAK_DOWN == 1
-        gettimeofday(&timestartChunker_VarSizeHash, NULL);
-#endif
-        if (!cryptoObj->generateHash(chunkBuffer, chunkBufferCnt, hash)) {
-            cerr << "Chunker : average size chunking compute hash error" << endl;
-            return;
-        }
-#if SYSTEM_BREAK_DOWN == 1
-        gettimeofday(&timeendChunker_VarSizeHash, NULL);
-        diff = 1000000 * (timeendChunker_VarSizeHash.tv_sec - timestartChunker_VarSizeHash.tv_sec) + timeendChunker_VarSizeHash.tv_usec - timestartChunker_VarSizeHash.tv_usec;
-        second = diff / 1000000.0;
-        hashTime += second;
-#endif
-        Data_t tempChunk;
-        tempChunk.chunk.ID = chunkIDCnt;
-        tempChunk.chunk.logicDataSize = chunkBufferCnt;
-        memcpy(tempChunk.chunk.logicData, chunkBuffer, chunkBufferCnt);
-        memcpy(tempChunk.chunk.chunkHash, hash, CHUNK_HASH_SIZE);
-        tempChunk.dataType = DATA_TYPE_CHUNK;
+        Data_t* tempChunk = dataPoolObj->get();
+        tempChunk->chunk.ID = chunkIDCnt;
+        tempChunk->chunk.logicDataSize = chunkBufferCnt;
+        memcpy(tempChunk->chunk.logicData, chunkBuffer, chunkBufferCnt);
+        tempChunk->dataType = DATA_TYPE_CHUNK;
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timestartChunker_VarSizeInsert, NULL);
 #endif
-        if (!insertMQToKeyClient(tempChunk)) {
-            cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << tempChunk.chunk.ID << endl;
-            return;
+        if (!insertChunk(tempChunk)) {
+            cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCnt << endl;
+            return false;
         }
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timeendChunker_VarSizeInsert, NULL);
@@ -683,31 +859,408 @@ void Chunker::varSizeChunking()
     fileRecipe.recipe.fileRecipeHead.fileSize = fileSize;
     fileRecipe.recipe.keyRecipeHead.fileSize = fileRecipe.recipe.fileRecipeHead.fileSize;
     fileRecipe.dataType = DATA_TYPE_RECIPE;
-    if (!insertMQToKeyClient(fileRecipe)) {
+    if (!insertRecipeToKeyClient()) {
         cerr << "Chunker : error insert recipe head to keyClient message queue" << endl;
-        return;
+        return false;
     }
-    if (setJobDoneFlag() == false) {
-        cerr << "Chunker: set chunking done flag error" << endl;
-        return;
+    cout << "Chunker : variable size chunking over:\nTotal file size = " << fileRecipe.recipe.fileRecipeHead.fileSize << "; Total chunk number = " << fileRecipe.recipe.fileRecipeHead.totalChunkNumber << endl;
+#if SYSTEM_BREAK_DOWN == 1
+    gettimeofday(&timeendChunker, NULL);
+    diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
+    second = diff / 1000000.0;
+    cout << "Chunker : total chunking time = " << setbase(10) << second - insertTime << " s" << endl;
+    cout << "Chunker : total hashing time = " << hashTime << " s" << endl;
+#endif
+    return true;
+}
+
+void Chunker::findAnchors(const u_char* block, uint64_t start, uint64_t end, vector<uint64_t>& anchorList)
+{
+    /*the same rolling hash as varSizeChunking, the window before start is filled first*/
+    uint16_t winFp = 0;
+    const u_char* window = block + start - slidingWinSize;
+    for (int i = 0; i < slidingWinSize; i++) {
+        winFp = (winFp + (window[i] * powerLUT[slidingWinSize - i - 1])) & polyMOD;
+    }
+    for (uint64_t i = start; i < end; i++) {
+        unsigned short int v = block[i - slidingWinSize];
+        winFp = ((winFp + removeLUT[v]) * polyBase + block[i]) & polyMOD;
+        if ((winFp & anchorMask) == anchorValue) {
+            anchorList.push_back(i);
+        }
+    }
+}
+
+bool Chunker::parallelVarSizeChunking()
+{
+    double insertTime = 0;
+    long diff;
+    double second;
+    uint64_t chunkIDCnt = 0;
+    uint64_t fileSize = 0;
+    /*the tail of last read which is not chunked yet, the next block starts with it*/
+    uint64_t remainSize = 0;
+    u_char* block;
+    bool fileEnd = false;
+    /*an anchor at offset i of a chunk cuts it only if i >= firstCheck (the first anchor check of varSizeChunking)*/
+    uint64_t firstCheck = max(minChunkSize - 1, slidingWinSize);
+    vector<vector<uint64_t>> segmentAnchors(chunkingThreadNum);
+    vector<std::future<void>> segmentDone(chunkingThreadNum);
+/*start chunking*/
+#if SYSTEM_BREAK_DOWN == 1
+    gettimeofday(&timestartChunker, NULL);
+#endif
+    while (true) {
+        uint64_t len = readInput(block, remainSize, fileEnd);
+        fileSize += len - remainSize;
+
+        /*the block starts with a chunk, find the anchors of [slidingWinSize, len) by segments*/
+        uint64_t segmentSize = max((len + chunkingThreadNum - 1) / chunkingThreadNum, (uint64_t)CHUNKING_SEGMENT_MIN_SIZE);
+        int segmentNum = 0;
+        for (uint64_t start = slidingWinSize; start < len; start += segmentSize) {
+            segmentAnchors[segmentNum].clear();
+            segmentDone[segmentNum] = chunkingPool->enqueue(&Chunker::findAnchors, this, block, start,
+                min(start + segmentSize, len), std::ref(segmentAnchors[segmentNum]));
+            segmentNum++;
+        }
+
+        /*stitch: walk the anchors in order as varSizeChunking, a chunk cut by an anchor of the next segment resyncs there*/
+        uint64_t chunkedSize = 0;
+        int segmentIndex = 0;
+        size_t anchorIndex = 0;
+        if (segmentNum != 0) {
+            segmentDone[0].wait();
+        }
+        while (chunkedSize < len) {
+            uint64_t cutSize = 0;
+            while (segmentIndex < segmentNum) {
+                vector<uint64_t>& anchorList = segmentAnchors[segmentIndex];
+                while (anchorIndex < anchorList.size() && anchorList[anchorIndex] < chunkedSize + firstCheck) {
+                    anchorIndex++;
+                }
+                if (anchorIndex < anchorList.size()) {
+                    if (anchorList[anchorIndex] < chunkedSize + maxChunkSize) {
+                        cutSize = anchorList[anchorIndex] + 1 - chunkedSize;
+                    }
+                    break;
+                }
+                segmentIndex++;
+                anchorIndex = 0;
+                if (segmentIndex < segmentNum) {
+                    segmentDone[segmentIndex].wait();
+                }
+            }
+            if (cutSize == 0) {
+                if (chunkedSize + maxChunkSize <= len) {
+                    cutSize = maxChunkSize;
+                } else if (fileEnd) {
+                    cutSize = len - chunkedSize;
+                } else {
+                    /*wait for the next read*/
+                    break;
+                }
+            }
+            u_char* chunkStart = block + chunkedSize;
+            Data_t* tempChunk = dataPoolObj->get();
+            tempChunk->chunk.ID = chunkIDCnt;
+            tempChunk->chunk.logicDataSize = cutSize;
+            memcpy(tempChunk->chunk.logicData, chunkStart, cutSize);
+            tempChunk->dataType = DATA_TYPE_CHUNK;
+#if SYSTEM_BREAK_DOWN == 1
+            gettimeofday(&timestartChunker_VarSizeInsert, NULL);
+#endif
+            if (!insertChunk(tempChunk)) {
+                cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCnt << endl;
+                /*the segment threads still refer to the anchor lists*/
+                for (int i = 0; i < segmentNum; i++) {
+                    segmentDone[i].wait();
+                }
+                return false;
+            }
+#if SYSTEM_BREAK_DOWN == 1
+            gettimeofday(&timeendChunker_VarSizeInsert, NULL);
+            diff = 1000000 * (timeendChunker_VarSizeInsert.tv_sec - timestartChunker_VarSizeInsert.tv_sec) + timeendChunker_VarSizeInsert.tv_usec - timestartChunker_VarSizeInsert.tv_usec;
+            second = diff / 1000000.0;
+            insertTime += second;
+#endif
+            chunkIDCnt++;
+            chunkedSize += cutSize;
+        }
+        /*all segments are done before the buffer is reused*/
+        for (int i = 0; i < segmentNum; i++) {
+            segmentDone[i].wait();
+        }
+        remainSize = len - chunkedSize;
+        if (fileEnd) {
+            break;
+        }
+    }
+    fileRecipe.recipe.fileRecipeHead.totalChunkNumber = chunkIDCnt;
+    fileRecipe.recipe.keyRecipeHead.totalChunkKeyNumber = chunkIDCnt;
+    fileRecipe.recipe.fileRecipeHead.fileSize = fileSize;
+    fileRecipe.recipe.keyRecipeHead.fileSize = fileRecipe.recipe.fileRecipeHead.fileSize;
+    fileRecipe.dataType = DATA_TYPE_RECIPE;
+    if (!insertRecipeToKeyClient()) {
+        cerr << "Chunker : error insert recipe head to keyClient message queue" << endl;
+        return false;
     }
     cout << "Chunker : variable size chunking over:\nTotal file size = " << fileRecipe.recipe.fileRecipeHead.fileSize << "; Total chunk number = " << fileRecipe.recipe.fileRecipeHead.totalChunkNumber << endl;
 #if SYSTEM_BREAK_DOWN == 1
     gettimeofday(&timeendChunker, NULL);
     diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
     second = diff / 1000000.0;
-    cout << "Chunker : total chunking time = " << setbase(10) << second - (insertTime + hashTime) << " s" << endl;
+    cout << "Chunker : total chunking time = " << setbase(10) << second - insertTime << " s" << endl;
     cout << "Chunker : total hashing time = " << hashTime << " s" << endl;
 #endif
-    return;
+    return true;
+}
+
+uint64_t Chunker::gearCutPoint(const u_char* src, uint64_t len)
+{
+    if (len <= (uint64_t)minChunkSize) {
+        return len;
+    }
+    uint64_t normalSize = min(len, (uint64_t)avgChunkSize);
+    uint64_t limitSize = min(len, (uint64_t)maxChunkSize);
+    uint64_t fp = 0;
+    /*skip the bytes before minChunkSize, except the window that warms up the fingerprint*/
+    uint64_t i = (minChunkSize > GEAR_WINDOW_SIZE) ? minChunkSize - GEAR_WINDOW_SIZE : 0;
+    for (; i < (uint64_t)minChunkSize; i++) {
+        fp = (fp << 1) + gearTable[src[i]];
+    }
+    for (; i < normalSize; i++) {
+        fp = (fp << 1) + gearTable[src[i]];
+        if (!(fp & gearMaskS)) {
+            return i + 1;
+        }
+    }
+    for (; i < limitSize; i++) {
+        fp = (fp << 1) + gearTable[src[i]];
+        if (!(fp & gearMaskL)) {
+            return i + 1;
+        }
+    }
+    return limitSize;
 }
 
-bool Chunker::insertMQToKeyClient(Data_t& newData)
+bool Chunker::fastCDCChunking()
 {
+    double insertTime = 0;
+    long diff;
+    double second;
+    uint64_t chunkIDCnt = 0;
+    uint64_t fileSize = 0;
+    /*the tail of last read which is not chunked yet, the next block starts with it*/
+    uint64_t remainSize = 0;
+    u_char* block;
+    bool fileEnd = false;
+/*start chunking*/
+#if SYSTEM_BREAK_DOWN == 1
+    gettimeofday(&timestartChunker, NULL);
+#endif
+    while (true) {
+        uint64_t len = readInput(block, remainSize, fileEnd);
+        fileSize += len - remainSize;
+        uint64_t chunkedSize = 0;
+        while (chunkedSize < len) {
+            /*a chunk never spans two reads, wait for the next read unless it is the end of file*/
+            if (len - chunkedSize < (uint64_t)maxChunkSize && !fileEnd) {
+                break;
+            }
+            u_char* chunkStart = block + chunkedSize;
+            uint64_t chunkSize = gearCutPoint(chunkStart, len - chunkedSize);
+            Data_t* tempChunk = dataPoolObj->get();
+            tempChunk->chunk.ID = chunkIDCnt;
+            tempChunk->chunk.logicDataSize = chunkSize;
+            memcpy(tempChunk->chunk.logicData, chunkStart, chunkSize);
+            tempChunk->dataType = DATA_TYPE_CHUNK;
+#if SYSTEM_BREAK_DOWN == 1
+            gettimeofday(&timestartChunker_VarSizeInsert, NULL);
+#endif
+            if (!insertChunk(tempChunk)) {
+                cerr << "Chunker : error insert chunk to keyClient message queue for chunk ID = " << chunkIDCnt << endl;
+                return false;
+            }
+#if SYSTEM_BREAK_DOWN == 1
+            gettimeofday(&timeendChunker_VarSizeInsert, NULL);
+            diff = 1000000 * (timeendChunker_VarSizeInsert.tv_sec - timestartChunker_VarSizeInsert.tv_sec) + timeendChunker_VarSizeInsert.tv_usec - timestartChunker_VarSizeInsert.tv_usec;
+            second = diff / 1000000.0;
+            insertTime += second;
+#endif
+            chunkIDCnt++;
+            chunkedSize += chunkSize;
+        }
+        remainSize = len - chunkedSize;
+        if (fileEnd) {
+            break;
+        }
+    }
+    fileRecipe.recipe.fileRecipeHead.totalChunkNumber = chunkIDCnt;
+    fileRecipe.recipe.keyRecipeHead.totalChunkKeyNumber = chunkIDCnt;
+    fileRecipe.recipe.fileRecipeHead.fileSize = fileSize;
+    fileRecipe.recipe.keyRecipeHead.fileSize = fileRecipe.recipe.fileRecipeHead.fileSize;
+    fileRecipe.dataType = DATA_TYPE_RECIPE;
+    if (!insertRecipeToKeyClient()) {
+        cerr << "Chunker : error insert recipe head to keyClient message queue" << endl;
+        return false;
+    }
+    cout << "Chunker : FastCDC chunking over:\nTotal file size = " << fileRecipe.recipe.fileRecipeHead.fileSize << "; Total chunk number = " << fileRecipe.recipe.fileRecipeHead.totalChunkNumber << endl;
+#if SYSTEM_BREAK_DOWN == 1
+    gettimeofday(&timeendChunker, NULL);
+    diff = 1000000 * (timeendChunker.tv_sec - timestartChunker.tv_sec) + timeendChunker.tv_usec - timestartChunker.tv_usec;
+    second = diff / 1000000.0;
+    cout << "Chunker : total chunking time = " << setbase(10) << second - insertTime << " s" << endl;
+    cout << "Chunker : total hashing time = " << hashTime << " s" << endl;
+#endif
+    return true;
+}
+
+bool Chunker::insertChunk(Data_t* newChunk)
+{
+    if (fingerprintPool == NULL) {
+#if SYSTEM_BREAK_DOWN == 1
+        struct timeval timestartHash, timeendHash;
+        gettimeofday(&timestartHash, NULL);
+#endif
+        if (!cryptoObj->generateChunkHash(newChunk->chunk.logicData, newChunk->chunk.logicDataSize, newChunk->chunk.chunkHash)) {
+            cerr << "Chunker : compute hash error for chunk ID = " << newChunk->chunk.ID << endl;
+            DataPool::release(newChunk);
+            return false;
+        }
+#if SYSTEM_BREAK_DOWN == 1
+        gettimeofday(&timeendHash, NULL);
+        long diff = 1000000 * (timeendHash.tv_sec - timestartHash.tv_sec) + timeendHash.tv_usec - timestartHash.tv_usec;
+        hashTime += diff / 1000000.0;
+#endif
+        return insertMQToKeyClient(newChunk);
+    }
+    fingerprintBatch.push_back(newChunk);
+    if (fingerprintBatch.size() < FINGERPRINT_BATCH_SIZE) {
+        return true;
+    }
+    fingerprintBatchList.push_back(std::move(fingerprintBatch));
+    fingerprintBatch.clear();
+    fingerprintBatch.reserve(FINGERPRINT_BATCH_SIZE);
+    // the batch and its time stay at the same address in the deques until they are inserted
+    fingerprintTimeList.push_back(0);
+    fingerprintDoneList.push_back(fingerprintPool->enqueue(&Chunker::hashChunkBatch, &fingerprintBatchList.back(), &fingerprintTimeList.back()));
+    if (fingerprintBatchList.size() < fingerprintWindow) {
+        return true;
+    }
+    return insertFingerprintBatch();
+}
+
+bool Chunker::hashChunkBatch(vector<Data_t*>* batch, double* hashTime)
+{
+    // each fingerprinting thread keeps its own digest context
+    static thread_local CryptoPrimitive hashCryptoObj;
+    struct timeval timestartHash, timeendHash;
+    gettimeofday(&timestartHash, NULL);
+    bool status = true;
+    for (size_t i = 0; i < batch->size(); i++) {
+        Chunk_t& chunk = (*batch)[i]->chunk;
+        if (!hashCryptoObj.generateChunkHash(chunk.logicData, chunk.logicDataSize, chunk.chunkHash)) {
+            cerr << "Chunker : compute hash error for chunk ID = " << chunk.ID << endl;
+            status = false;
+            break;
+        }
+    }
+    gettimeofday(&timeendHash, NULL);
+    long diff = 1000000 * (timeendHash.tv_sec - timestartHash.tv_sec) + timeendHash.tv_usec - timestartHash.tv_usec;
+    *hashTime = diff / 1000000.0;
+    return status;
+}
+
+bool Chunker::insertFingerprintBatch()
+{
+    // wait for the oldest batch, so that the chunks are inserted in order
+    bool hashStatus = fingerprintDoneList.front().get();
+    hashTime += fingerprintTimeList.front();
+    vector<Data_t*>& batch = fingerprintBatchList.front();
+    bool status = true;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (!hashStatus) {
+            DataPool::release(batch[i]);
+        } else if (!insertMQToKeyClient(batch[i])) {
+            status = false;
+        }
+    }
+    fingerprintDoneList.pop_front();
+    fingerprintTimeList.pop_front();
+    fingerprintBatchList.pop_front();
+    if (!hashStatus) {
+        // no chunk is forwarded after a failed one, the stage stops here
+        dropFingerprint();
+        return false;
+    }
+    return status;
+}
+
+void Chunker::dropFingerprint()
+{
+    for (size_t i = 0; i < fingerprintBatch.size(); i++) {
+        DataPool::release(fingerprintBatch[i]);
+    }
+    fingerprintBatch.clear();
+    while (!fingerprintBatchList.empty()) {
+        fingerprintDoneList.front().wait();
+        vector<Data_t*>& batch = fingerprintBatchList.front();
+        for (size_t i = 0; i < batch.size(); i++) {
+            DataPool::release(batch[i]);
+        }
+        fingerprintDoneList.pop_front();
+        fingerprintTimeList.pop_front();
+        fingerprintBatchList.pop_front();
+    }
+}
+
+bool Chunker::flushFingerprint()
+{
+    if (fingerprintPool == NULL) {
+        return true;
+    }
+    if (!fingerprintBatch.empty()) {
+        fingerprintBatchList.push_back(std::move(fingerprintBatch));
+        fingerprintBatch.clear();
+        fingerprintTimeList.push_back(0);
+        fingerprintDoneList.push_back(fingerprintPool->enqueue(&Chunker::hashChunkBatch, &fingerprintBatchList.back(), &fingerprintTimeList.back()));
+    }
+    bool status = true;
+    while (!fingerprintBatchList.empty()) {
+        if (!insertFingerprintBatch()) {
+            status = false;
+        }
+    }
+    return status;
+}
+
+bool Chunker::insertMQToKeyClient(Data_t* newData)
+{
+    if (keyClientObj == NULL) {
+        bool status = chunkHandler(*newData);
+        DataPool::release(newData);
+        return status;
+    }
     return keyClientObj->insertMQFromChunker(newData);
 }
 
+bool Chunker::insertRecipeToKeyClient()
+{
+    // the recipe follows all chunks
+    if (!flushFingerprint()) {
+        cerr << "Chunker : error insert the hashed chunks to keyClient message queue" << endl;
+        return false;
+    }
+    Data_t* recipeData = dataPoolObj->get();
+    memcpy(&recipeData->recipe, &fileRecipe.recipe, sizeof(Recipe_t));
+    recipeData->dataType = DATA_TYPE_RECIPE;
+    return insertMQToKeyClient(recipeData);
+}
+
 bool Chunker::setJobDoneFlag()
 {
+    if (keyClientObj == NULL) {
+        return true;
+    }
     return keyClientObj->editJobDoneFlag();
 }
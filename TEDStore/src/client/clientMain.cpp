@@ -23,7 +23,7 @@ struct timeval timeend;
 void usage()
 {
     cerr << "[client -r filename] for receive file" << endl;
-    cerr << "[client -s filename] for send file" << endl;
+    cerr << "[client -s filename] for send file (a directory: send all files under it)" << endl;
 }
 
 int main(int argv, char* argc[])
@@ -49,10 +49,16 @@ int main(int argv, char* argc[])
 
     } else if (strcmp("-s", argc[1]) == 0) {
 
+        string inputPath(argc[2]);
+        vector<string> fileList;
+        Chunker::collectFiles(inputPath, fileList);
+        if (fileList.empty()) {
+            cerr << "Client : no file to send under " << inputPath << endl;
+            return 1;
+        }
         senderObj = new Sender();
         keyClientObj = new keyClient(senderObj);
-        string inputFile(argc[2]);
-        chunkerObj = new Chunker(inputFile, keyClientObj);
+        chunkerObj = new Chunker(fileList, keyClientObj);
 
         th = new boost::thread(attrs, boost::bind(&Chunker::chunking, chunkerObj));
         thList.push_back(th);
@@ -11,7 +11,7 @@ struct timeval timeendKeySocket;
 
 keyClient::keyClient(Sender* senderObjTemp)
 {
-    inputMQ_ = new messageQueue<Data_t>;
+    inputMQ_ = new messageQueue<Data_t*>;
     senderObj_ = senderObjTemp;
     cryptoObj_ = new CryptoPrimitive();
     keyBatchSize_ = (int)config.getKeyBatchSize();
@@ -51,19 +51,28 @@ keyClient::keyClient(Sender* senderObjTemp)
         adjustValue_ = config.getAdjustValue();
     }
     tPool_ = new ThreadPool(this->keyManNum_);
+    encodeErrorFlag_ = false;
+    encodeThreadNum_ = (int)config.getEncodeThreadNum();
+    if (encodeThreadNum_ > 0) {
+        encodePool_ = new ThreadPool(encodeThreadNum_);
+    }
 }
 
 keyClient::keyClient(uint64_t keyGenNumber)
 {
-    inputMQ_ = new messageQueue<Data_t>;
+    inputMQ_ = new messageQueue<Data_t*>;
     cryptoObj_ = new CryptoPrimitive();
     keyBatchSize_ = (int)config.getKeyBatchSize();
     keyGenNumber_ = keyGenNumber;
     sendShortHashMaskBitNumber = config.getSendShortHashMaskBitNumber();
+    encodeErrorFlag_ = false;
 }
 
 keyClient::~keyClient()
 {
+    if (encodePool_ != NULL) {
+        delete encodePool_;
+    }
     if (cryptoObj_ != NULL) {
         delete cryptoObj_;
     }
@@ -215,7 +224,7 @@ void keyClient::run()
     long diff;
     double second;
 #endif
-    vector<Data_t> batchList;
+    vector<Data_t*> batchList;
     batchList.reserve(keyBatchSize_);
     int batchNumber = 0;
     u_char chunkKey[CHUNK_ENCRYPT_KEY_SIZE * keyBatchSize_];
@@ -226,32 +235,19 @@ void keyClient::run()
     for (int i = 0; i < sendShortHashMaskBitNumber; i++) {
         maskInt &= ~(1 << (32 - i));
     }
-    int hashInt[4];
     while (true) {
 
-        Data_t tempChunk;
-        if (inputMQ_->done_ && inputMQ_->isEmpty()) {
-            cerr << "KeyClient : Chunker jobs done, queue is empty" << endl;
-            JobDoneFlag = true;
-        }
+        Data_t* tempChunk;
         if (extractMQFromChunker(tempChunk)) {
-            if (tempChunk.dataType == DATA_TYPE_RECIPE) {
-                insertMQToSender(tempChunk);
+            if (tempChunk->dataType == DATA_TYPE_RECIPE) {
+                insertRecipeToSender(tempChunk);
                 continue;
             }
 #if SYSTEM_BREAK_DOWN == 1
             gettimeofday(&timestartKey, NULL);
 #endif
             batchList.push_back(tempChunk);
-            char hash[16];
-            MurmurHash3_x64_128((void const*)tempChunk.chunk.logicData, tempChunk.chunk.logicDataSize, 0, (void*)hash);
-            for (int i = 0; i < 4; i++) {
-                memcpy(&hashInt[i], hash + i * sizeof(int), sizeof(int));
-            }
-            for (int i = 0; i < 4; i++) {
-                hashInt[i] &= maskInt;
-                memcpy(chunkHash + batchNumber * singleChunkHashSize + i * sizeof(int), &hashInt[i], sizeof(int));
-            }
+            generateShortHash(tempChunk, maskInt, chunkHash + batchNumber * singleChunkHashSize);
             batchNumber++;
 #if SYSTEM_BREAK_DOWN == 1
             gettimeofday(&timeendKey, NULL);
@@ -260,6 +256,9 @@ void keyClient::run()
             keyGenTime += second;
             shortHashTime += second;
 #endif
+        } else {
+            cerr << "KeyClient : Chunker jobs done, queue is empty" << endl;
+            JobDoneFlag = true;
         }
         if (batchNumber == keyBatchSize_ || JobDoneFlag) {
 #if SYSTEM_BREAK_DOWN == 1
@@ -277,15 +276,26 @@ void keyClient::run()
             if (!keyExchangeStatus) {
                 cerr << "KeyClient : error get key for " << setbase(10) << batchNumber << " chunks" << endl;
                 return;
+            } else if (encodePool_ != NULL) {
+                u_char* keySeedList = chunkKey;
+                if (!encodeBatch(batchList, batchNumber, [this, keySeedList](int index, Data_t* newChunk, EncodeState_t& encodeState) {
+                        return deriveKey(newChunk, keySeedList + index * CHUNK_ENCRYPT_KEY_SIZE, &encodeState.cryptoObj);
+                    })) {
+                    cerr << "KeyClient : encode chunk error, exiting" << endl;
+                    abortEncode();
+                    return;
+                }
+                batchList.clear();
+                batchList.reserve(keyBatchSize_);
+                memset(chunkHash, 0, singleChunkHashSize * keyBatchSize_);
+                memset(chunkKey, 0, CHUNK_ENCRYPT_KEY_SIZE * keyBatchSize_);
+                batchNumber = 0;
             } else {
-                u_char newKeyBuffer[CHUNK_ENCRYPT_KEY_SIZE + CHUNK_ENCRYPT_KEY_SIZE];
                 for (int i = 0; i < batchNumber; i++) {
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timestartKey, NULL);
 #endif
-                    memcpy(newKeyBuffer, batchList[i].chunk.chunkHash, CHUNK_HASH_SIZE);
-                    memcpy(newKeyBuffer + CHUNK_HASH_SIZE, chunkKey + i * CHUNK_ENCRYPT_KEY_SIZE, CHUNK_ENCRYPT_KEY_SIZE);
-                    cryptoObj_->generateHash(newKeyBuffer, CHUNK_ENCRYPT_KEY_SIZE + CHUNK_ENCRYPT_KEY_SIZE, batchList[i].chunk.encryptKey);
+                    deriveKey(batchList[i], chunkKey + i * CHUNK_ENCRYPT_KEY_SIZE, cryptoObj_);
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timeendKey, NULL);
                     diff = 1000000 * (timeendKey.tv_sec - timestartKey.tv_sec) + timeendKey.tv_usec - timestartKey.tv_usec;
@@ -296,7 +306,7 @@ void keyClient::run()
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timestartKey, NULL);
 #endif
-                    bool encodeChunkStatus = encodeChunk(batchList[i]);
+                    bool encodeChunkStatus = encodeChunk(*batchList[i]);
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timeendKey, NULL);
                     diff = 1000000 * (timeendKey.tv_sec - timestartKey.tv_sec) + timeendKey.tv_usec - timestartKey.tv_usec;
@@ -318,6 +328,12 @@ void keyClient::run()
             }
         }
         if (JobDoneFlag) {
+            // the chunks in the encoding threads go to the sender before its job done flag
+            if (!waitEncodeDone()) {
+                cerr << "KeyClient : encode chunk error, exiting" << endl;
+                abortEncode();
+                return;
+            }
             if (!senderObj_->editJobDoneFlag()) {
                 cerr << "KeyClient : error to set job done flag for sender" << endl;
             } else {
@@ -328,6 +344,7 @@ void keyClient::run()
     }
 #if SYSTEM_BREAK_DOWN == 1
     cout << "KeyClient : keyGen total work time = " << keyGenTime << " s" << endl;
+    cout << "KeyClient : input queue high-water mark = " << inputMQ_->getHighWater() << " chunks (" << inputMQ_->getHighWater() * sizeof(PooledData_t) / (1024 * 1024) << " MB)" << endl;
     cout << "KeyClient : short hash compute work time = " << shortHashTime << " s" << endl;
     cout << "KeyClient : key exchange work time = " << keyExchangeTime << " s" << endl;
     cout << "KeyClient : key derivation work time = " << keyDerivationTime << " s" << endl;
@@ -511,8 +528,13 @@ bool keyClient::keyExchangeSimpleAll(u_char** batchHashList, int batchNumber, u_
 
 bool keyClient::encodeChunk(Data_t& newChunk)
 {
-    bool statusChunk = cryptoObj_->encryptChunk(newChunk.chunk);
-    bool statusHash = cryptoObj_->generateHash(newChunk.chunk.logicData, newChunk.chunk.logicDataSize, newChunk.chunk.chunkHash);
+    return encodeChunk(newChunk, cryptoObj_);
+}
+
+bool keyClient::encodeChunk(Data_t& newChunk, CryptoPrimitive* cryptoObj)
+{
+    bool statusChunk = cryptoObj->encryptChunk(newChunk.chunk);
+    bool statusHash = cryptoObj->generateHash(newChunk.chunk.logicData, newChunk.chunk.logicDataSize, newChunk.chunk.chunkHash);
     if (!statusChunk) {
         cerr << "KeyClient : error encrypt chunk" << endl;
         return false;
@@ -524,29 +546,170 @@ bool keyClient::encodeChunk(Data_t& newChunk)
     }
 }
 
-bool keyClient::insertMQFromChunker(Data_t& newChunk)
+EncodeState::EncodeState()
 {
-    return inputMQ_->push(newChunk);
+    for (size_t i = 0; i < K_PARA; i++) {
+        mpz_init(share[i]);
+    }
+    mpz_init(secret);
 }
 
-bool keyClient::extractMQFromChunker(Data_t& newChunk)
+EncodeState::~EncodeState()
 {
-    return inputMQ_->pop(newChunk);
+    for (size_t i = 0; i < K_PARA; i++) {
+        mpz_clear(share[i]);
+    }
+    mpz_clear(secret);
 }
 
-bool keyClient::insertMQToSender(Data_t& newChunk)
+bool keyClient::deriveKey(Data_t* newChunk, u_char* keySeed, CryptoPrimitive* cryptoObj)
 {
-    return senderObj_->insertMQFromKeyClient(newChunk);
+    u_char newKeyBuffer[CHUNK_ENCRYPT_KEY_SIZE + CHUNK_ENCRYPT_KEY_SIZE];
+    memcpy(newKeyBuffer, newChunk->chunk.chunkHash, CHUNK_HASH_SIZE);
+    memcpy(newKeyBuffer + CHUNK_HASH_SIZE, keySeed, CHUNK_ENCRYPT_KEY_SIZE);
+    return cryptoObj->generateHash(newKeyBuffer, CHUNK_ENCRYPT_KEY_SIZE + CHUNK_ENCRYPT_KEY_SIZE, newChunk->chunk.encryptKey);
 }
 
-bool keyClient::editJobDoneFlag()
+bool keyClient::deriveKeySimple(Data_t* newChunk, int index, CryptoPrimitive* cryptoObj)
+{
+    u_char newKeyBuffer[CHUNK_ENCRYPT_KEY_SIZE + CHUNK_ENCRYPT_KEY_SIZE];
+    KeySeedReturnEntry_t tempKeySeed;
+    // store the key seed in first 32 bytes of newKeyBuffer
+    memset(newKeyBuffer, 1, CHUNK_ENCRYPT_KEY_SIZE);
+    for (size_t j = 0; j < this->keyManNum_; j++) {
+        memcpy(&tempKeySeed, chunkKeyArray_[j] + index * sizeof(KeySeedReturnEntry_t), sizeof(KeySeedReturnEntry_t));
+        XORTwoBuffers((uint64_t*)newKeyBuffer, (uint64_t*)tempKeySeed.simpleKeySeed.shaKeySeed, CHUNK_ENCRYPT_KEY_SIZE);
+    }
+    memcpy(newKeyBuffer + CHUNK_ENCRYPT_KEY_SIZE, newChunk->chunk.chunkHash, CHUNK_HASH_SIZE);
+    return cryptoObj->generateHash(newKeyBuffer, CHUNK_ENCRYPT_KEY_SIZE + CHUNK_ENCRYPT_KEY_SIZE, newChunk->chunk.encryptKey);
+}
+
+bool keyClient::deriveKeySS(Data_t* newChunk, int index, CryptoPrimitive* cryptoObj, HHash* hHash, mpz_t share[K_PARA], mpz_t secret)
+{
+    u_char newKeyBuffer[CHUNK_HASH_SIZE + HHASH_KEY_SEED];
+    KeySeedReturnEntry_t tempKeySeed;
+    ShareIndexEntry_t tempShareIndex;
+    int indexList[K_PARA];
+    memset(newKeyBuffer, 0, CHUNK_HASH_SIZE + HHASH_KEY_SEED);
+    // recover the share index
+    memcpy(&tempShareIndex, shareIndexArrayBuffer_ + index * sizeof(ShareIndexEntry_t), sizeof(ShareIndexEntry_t));
+    // each key manager returns a seed for every chunk of the batch, the ted seed first
+    memcpy(&tempKeySeed, chunkKeyArray_[tempShareIndex.tedSeedIndex] + index * sizeof(KeySeedReturnEntry_t), sizeof(KeySeedReturnEntry_t));
+    indexList[0] = tempShareIndex.tedSeedIndex + 1;
+    mpz_import(share[0], HHASH_KEY_SEED, 1, sizeof(char), 1, 0, tempKeySeed.hhashKeySeed.hhashKeySeed);
+    for (size_t j = 0; j < K_PARA - 1; j++) {
+        memcpy(&tempKeySeed, chunkKeyArray_[tempShareIndex.shareIndexArray[j]] + index * sizeof(KeySeedReturnEntry_t), sizeof(KeySeedReturnEntry_t));
+        mpz_import(share[j + 1], HHASH_KEY_SEED, 1, sizeof(char), 1, 0, tempKeySeed.hhashKeySeed.hhashKeySeed);
+        indexList[j + 1] = tempShareIndex.shareIndexArray[j] + 1;
+    }
+    hHash->RecoverySecretFromHash(share, indexList, secret, adjustValue_);
+    u_char tempSecret[HHASH_KEY_SEED] = { 0 };
+    size_t length;
+    mpz_export(tempSecret, &length, 1, sizeof(char), 1, 0, secret);
+
+    memcpy(newKeyBuffer, newChunk->chunk.chunkHash, CHUNK_HASH_SIZE);
+    memcpy(newKeyBuffer + CHUNK_HASH_SIZE, tempSecret, HHASH_KEY_SEED);
+    return cryptoObj->generateHash(newKeyBuffer, CHUNK_HASH_SIZE + HHASH_KEY_SEED, newChunk->chunk.encryptKey);
+}
+
+bool keyClient::encodeBatch(vector<Data_t*>& batchList, int batchNumber, KeyDeriver_t deriveKey)
+{
+    // each thread takes a contiguous part of the batch
+    int taskNumber = min(encodeThreadNum_, batchNumber);
+    vector<std::future<bool>> deriveDoneList;
+    for (int task = 0; task < taskNumber; task++) {
+        int start = (int)((int64_t)batchNumber * task / taskNumber);
+        int end = (int)((int64_t)batchNumber * (task + 1) / taskNumber);
+        vector<Data_t*> chunkList(batchList.begin() + start, batchList.begin() + end);
+        std::shared_ptr<std::promise<bool>> deriveDone = std::make_shared<std::promise<bool>>();
+        deriveDoneList.push_back(deriveDone->get_future());
+        encodePool_->enqueue([this, chunkList, start, deriveKey, deriveDone]() {
+            static thread_local EncodeState_t encodeState;
+            bool status = true;
+            for (size_t i = 0; i < chunkList.size(); i++) {
+                if (!deriveKey(start + (int)i, chunkList[i], encodeState)) {
+                    status = false;
+                }
+            }
+            // the key seeds of the batch are not used after this point
+            deriveDone->set_value(status);
+            if (!status) {
+                cerr << "KeyClient : derive key error" << endl;
+                encodeErrorFlag_ = true;
+            }
+            for (size_t i = 0; i < chunkList.size(); i++) {
+                // after an error no chunk goes to the sender, the remaining ones go back to the pool
+                if (encodeErrorFlag_ || !encodeChunk(*chunkList[i], &encodeState.cryptoObj)) {
+                    encodeErrorFlag_ = true;
+                    for (size_t j = i; j < chunkList.size(); j++) {
+                        DataPool::release(chunkList[j]);
+                    }
+                    return;
+                }
+                insertMQToSender(chunkList[i]);
+            }
+        });
+    }
+    bool status = true;
+    for (size_t i = 0; i < deriveDoneList.size(); i++) {
+        if (!deriveDoneList[i].get()) {
+            status = false;
+        }
+    }
+    return status && !encodeErrorFlag_;
+}
+
+bool keyClient::waitEncodeDone()
 {
-    inputMQ_->done_ = true;
-    if (inputMQ_->done_) {
+    if (encodePool_ == NULL) {
         return true;
-    } else {
+    }
+    encodePool_->wait_until_nothing_in_flight();
+    return !encodeErrorFlag_;
+}
+
+void keyClient::abortEncode()
+{
+    // the encoding threads release their chunks on error, then the sender drops the ones waiting for them
+    if (encodePool_ != NULL) {
+        encodePool_->wait_until_nothing_in_flight();
+    }
+    if (!senderObj_->abortJob()) {
+        cerr << "KeyClient : error to set job done flag for sender" << endl;
+    }
+}
+
+bool keyClient::insertMQFromChunker(Data_t* newChunk)
+{
+    return inputMQ_->push(newChunk);
+}
+
+bool keyClient::extractMQFromChunker(Data_t*& newChunk)
+{
+    // wait for a chunk, false if the chunker is done and the queue is drained
+    if (!inputMQ_->popWait(newChunk)) {
         return false;
     }
+    // number the chunks in the stream order, the sender restores it
+    if (newChunk->dataType == DATA_TYPE_CHUNK) {
+        newChunk->seq = sendSeq_++;
+    }
+    return true;
+}
+
+bool keyClient::insertMQToSender(Data_t* newChunk)
+{
+    return senderObj_->insertMQFromKeyClient(newChunk);
+}
+
+bool keyClient::insertRecipeToSender(Data_t* newRecipe)
+{
+    return senderObj_->insertRecipeFromKeyClient(newRecipe);
+}
+
+bool keyClient::editJobDoneFlag()
+{
+    return inputMQ_->setJobDoneFlag();
 }
 
 /**
@@ -695,7 +858,7 @@ void keyClient::runSimple()
     long diff;
     double second;
 #endif
-    vector<Data_t> batchList;
+    vector<Data_t*> batchList;
     batchList.reserve(keyBatchSize_);
     int batchNumber = 0;
     bool JobDoneFlag = false;
@@ -703,30 +866,24 @@ void keyClient::runSimple()
     for (int i = 0; i < sendShortHashMaskBitNumber; i++) {
         maskInt &= ~(1 << (32 - i));
     }
-    int hashInt[4];
 
     while (true) {
         keyGenEntry_t tempKeyGenEntry;
-        Data_t tempChunk;
-        if (inputMQ_->done_ && inputMQ_->isEmpty()) {
-            cerr << "KeyClient : Chunker jobs done, queue is empty" << endl;
-            JobDoneFlag = true;
-        }
+        Data_t* tempChunk;
         if (extractMQFromChunker(tempChunk)) {
-            if (tempChunk.dataType == DATA_TYPE_RECIPE) {
-                insertMQToSender(tempChunk);
+            if (tempChunk->dataType == DATA_TYPE_RECIPE) {
+                insertRecipeToSender(tempChunk);
                 continue;
             }
 #if SYSTEM_BREAK_DOWN == 1
             gettimeofday(&timestartKey, NULL);
 #endif
             batchList.push_back(tempChunk);
-            char hash[16];
 
             // for multiple key manager
             // uint32_t fpValue;
             // uint32_t keyManagerIndex = 0;
-            // fpValue = convertFPtoValue(tempChunk);
+            // fpValue = convertFPtoValue(*tempChunk);
 
             // assign the key manager here
             uint32_t keyManagerIndex = 0;
@@ -745,14 +902,7 @@ void keyClient::runSimple()
 #if SYSTEM_BREAK_DOWN == 1
             gettimeofday(&timestartKey, NULL);
 #endif
-            MurmurHash3_x64_128((void const*)tempChunk.chunk.logicData, tempChunk.chunk.logicDataSize, 0, (void*)hash);
-            for (int i = 0; i < 4; i++) {
-                memcpy(&hashInt[i], hash + i * sizeof(int), sizeof(int));
-            }
-            for (int i = 0; i < 4; i++) {
-                hashInt[i] &= maskInt;
-                memcpy(tempKeyGenEntry.singleChunkHash + i * sizeof(int), &hashInt[i], sizeof(int));
-            }
+            generateShortHash(tempChunk, maskInt, tempKeyGenEntry.singleChunkHash);
             for (size_t i = 0; i < this->keyManNum_; i++) {
                 tempKeyGenEntry.nonce = nonce;
                 memcpy(chunkHashArray_[i] + batchNumber * sizeof(keyGenEntry_t),
@@ -768,6 +918,9 @@ void keyClient::runSimple()
             keyGenTime += second;
             shortHashTime += second;
 #endif
+        } else {
+            cerr << "KeyClient : Chunker jobs done, queue is empty" << endl;
+            JobDoneFlag = true;
         }
         if (batchNumber == keyBatchSize_ || JobDoneFlag) {
 #if SYSTEM_BREAK_DOWN == 1
@@ -796,23 +949,28 @@ void keyClient::runSimple()
             if (!keyExchangeStatus) {
                 cerr << "KeyClient : error get key for " << setbase(10) << batchNumber << " chunks" << endl;
                 return;
+            } else if (encodePool_ != NULL) {
+                if (!encodeBatch(batchList, batchNumber, [this](int index, Data_t* newChunk, EncodeState_t& encodeState) {
+                        return deriveKeySimple(newChunk, index, &encodeState.cryptoObj);
+                    })) {
+                    cerr << "KeyClient : encode chunk error, exiting" << endl;
+                    abortEncode();
+                    return;
+                }
+                batchList.clear();
+                batchList.reserve(keyBatchSize_);
+                for (size_t i = 0; i < this->keyManNum_; i++) {
+                    memset(chunkHashArray_[i], 0, sizeof(keyGenEntry_t) * this->keyBatchSize_);
+                    memset(chunkKeyArray_[i], 0, sizeof(KeySeedReturnEntry_t) * this->keyBatchSize_);
+                }
+                batchNumber = 0;
             } else {
-                u_char newKeyBuffer[CHUNK_ENCRYPT_KEY_SIZE + CHUNK_ENCRYPT_KEY_SIZE];
                 for (int i = 0; i < batchNumber; i++) {
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timestartKey, NULL);
 #endif
                     // generate the secret here
-                    KeySeedReturnEntry_t tempKeySeed;
-                    // store the key seed in first 32 bytes of newKeyBuffer
-                    memset(newKeyBuffer, 1, CHUNK_ENCRYPT_KEY_SIZE);
-                    for (size_t j = 0; j < this->keyManNum_; j++) {
-                        memcpy(&tempKeySeed, chunkKeyArray_[j] + i * sizeof(KeySeedReturnEntry_t), sizeof(KeySeedReturnEntry_t));
-                        XORTwoBuffers((uint64_t*)newKeyBuffer, (uint64_t*)tempKeySeed.simpleKeySeed.shaKeySeed, CHUNK_ENCRYPT_KEY_SIZE);
-                    }
-
-                    memcpy(newKeyBuffer + CHUNK_ENCRYPT_KEY_SIZE, batchList[i].chunk.chunkHash, CHUNK_HASH_SIZE);
-                    cryptoObj_->generateHash(newKeyBuffer, CHUNK_ENCRYPT_KEY_SIZE + CHUNK_ENCRYPT_KEY_SIZE, batchList[i].chunk.encryptKey);
+                    deriveKeySimple(batchList[i], i, cryptoObj_);
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timeendKey, NULL);
                     diff = 1000000 * (timeendKey.tv_sec - timestartKey.tv_sec) + timeendKey.tv_usec - timestartKey.tv_usec;
@@ -823,7 +981,7 @@ void keyClient::runSimple()
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timestartKey, NULL);
 #endif
-                    bool encodeChunkStatus = encodeChunk(batchList[i]);
+                    bool encodeChunkStatus = encodeChunk(*batchList[i]);
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timeendKey, NULL);
                     diff = 1000000 * (timeendKey.tv_sec - timestartKey.tv_sec) + timeendKey.tv_usec - timestartKey.tv_usec;
@@ -847,6 +1005,12 @@ void keyClient::runSimple()
             }
         }
         if (JobDoneFlag) {
+            // the chunks in the encoding threads go to the sender before its job done flag
+            if (!waitEncodeDone()) {
+                cerr << "KeyClient : encode chunk error, exiting" << endl;
+                abortEncode();
+                return;
+            }
             if (!senderObj_->editJobDoneFlag()) {
                 cerr << "KeyClient : error to set job done flag for sender" << endl;
             } else {
@@ -857,6 +1021,7 @@ void keyClient::runSimple()
     }
 #if SYSTEM_BREAK_DOWN == 1
     cout << "KeyClient : keyGen total work time = " << keyGenTime << " s" << endl;
+    cout << "KeyClient : input queue high-water mark = " << inputMQ_->getHighWater() << " chunks (" << inputMQ_->getHighWater() * sizeof(PooledData_t) / (1024 * 1024) << " MB)" << endl;
     cout << "KeyClient : assign chunk work time = " << assignTime << " s" << endl;
     cout << "KeyClient : short hash compute work time = " << shortHashTime << " s" << endl;
     cout << "KeyClient : key exchange work time = " << keyExchangeTime << " s" << endl;
@@ -882,7 +1047,7 @@ void keyClient::runSS()
     long diff;
     double second;
 #endif
-    vector<Data_t> batchList;
+    vector<Data_t*> batchList;
     batchList.reserve(keyBatchSize_);
     int batchNumber = 0;
     int assignNumberArray[keyManNum_];
@@ -893,29 +1058,23 @@ void keyClient::runSS()
     uint32_t maskInt = ~(0);
     maskInt = (maskInt >> sendShortHashMaskBitNumber);
     fprintf(stderr, "mashInt: %u\n", maskInt);
-    int hashInt[4];
     while (true) {
         keyGenEntry_t tempKeyGenEntry;
-        Data_t tempChunk;
-        if (inputMQ_->done_ && inputMQ_->isEmpty()) {
-            cerr << "KeyClient : Chunker jobs done, queue is empty" << endl;
-            JobDoneFlag = true;
-        }
+        Data_t* tempChunk;
         if (extractMQFromChunker(tempChunk)) {
-            if (tempChunk.dataType == DATA_TYPE_RECIPE) {
-                insertMQToSender(tempChunk);
+            if (tempChunk->dataType == DATA_TYPE_RECIPE) {
+                insertRecipeToSender(tempChunk);
                 continue;
             }
 #if SYSTEM_BREAK_DOWN == 1
             gettimeofday(&timestartKey, NULL);
 #endif
             batchList.push_back(tempChunk);
-            char hash[16];
 
             // for multiple key manager
             // uint32_t fpValue;
             // uint32_t keyManagerIndex = 0;
-            // fpValue = convertFPtoValue(tempChunk);
+            // fpValue = convertFPtoValue(*tempChunk);
             uint32_t nonce = 0;
             nonce = rand();
 
@@ -932,14 +1091,7 @@ void keyClient::runSS()
 #if SYSTEM_BREAK_DOWN == 1
             gettimeofday(&timestartKey, NULL);
 #endif
-            MurmurHash3_x64_128((void const*)tempChunk.chunk.logicData, tempChunk.chunk.logicDataSize, 0, (void*)hash);
-            for (int i = 0; i < 4; i++) {
-                memcpy(&hashInt[i], hash + i * sizeof(int), sizeof(int));
-            }
-            for (int i = 0; i < 4; i++) {
-                hashInt[i] &= maskInt;
-                memcpy(tempKeyGenEntry.singleChunkHash + i * sizeof(int), &hashInt[i], sizeof(int));
-            }
+            generateShortHash(tempChunk, maskInt, tempKeyGenEntry.singleChunkHash);
 	    
 
             // allocate the share to the key managers
@@ -995,6 +1147,9 @@ void keyClient::runSS()
             keyGenTime += second;
             shortHashTime += second;
 #endif
+        } else {
+            cerr << "KeyClient : Chunker jobs done, queue is empty" << endl;
+            JobDoneFlag = true;
         }
         if (batchNumber == keyBatchSize_ || JobDoneFlag) {
 #if SYSTEM_BREAK_DOWN == 1
@@ -1014,57 +1169,32 @@ void keyClient::runSS()
             if (!keyExchangeStatus) {
                 cerr << "KeyClient : error get key for " << setbase(10) << batchNumber << " chunks" << endl;
                 return;
-            } else {
-                u_char newKeyBuffer[CHUNK_HASH_SIZE + HHASH_KEY_SEED];
+            } else if (encodePool_ != NULL) {
+                if (!encodeBatch(batchList, batchNumber, [this](int index, Data_t* newChunk, EncodeState_t& encodeState) {
+                        return deriveKeySS(newChunk, index, &encodeState.cryptoObj, &encodeState.hHash, encodeState.share, encodeState.secret);
+                    })) {
+                    cerr << "KeyClient : encode chunk error, exiting" << endl;
+                    abortEncode();
+                    return;
+                }
+                batchList.clear();
+                batchList.reserve(keyBatchSize_);
+                for (size_t i = 0; i < this->keyManNum_; i++) {
+                    memset(chunkHashArray_[i], 0, sizeof(keyGenEntry_t) * this->keyBatchSize_);
+                    memset(chunkKeyArray_[i], 0, sizeof(KeySeedReturnEntry_t) * this->keyBatchSize_);
+                }
+                batchNumber = 0;
                 for (size_t i = 0; i < this->keyManNum_; i++) {
                     assignNumberArray[i] = 0;
                 }
+                memset(shareIndexArrayBuffer_, 0, sizeof(ShareIndexEntry_t) * this->keyBatchSize_);
+            } else {
                 for (int i = 0; i < batchNumber; i++) {
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timestartKey, NULL);
 #endif
                     // generate the secret here
-                    KeySeedReturnEntry_t tempKeySeed;
-                    ShareIndexEntry_t tempShareIndex;
-                    int indexList[K_PARA];
-                    // store the key seed in first 32 bytes of newKeyBuffer
-                    memset(newKeyBuffer, 0, CHUNK_HASH_SIZE + HHASH_KEY_SEED);
-                    // recover the share index
-                    memcpy(&tempShareIndex, shareIndexArrayBuffer_ + i * sizeof(ShareIndexEntry_t),
-                        sizeof(ShareIndexEntry_t));                    
-                    // copy ted seed to newKeyBuffer
-                    memcpy(&tempKeySeed, chunkKeyArray_[tempShareIndex.tedSeedIndex] + assignNumberArray[tempShareIndex.tedSeedIndex] * 
-                        sizeof(KeySeedReturnEntry_t), sizeof(KeySeedReturnEntry_t));
-                    // assignNumberArray[tempShareIndex.tedSeedIndex]++;
-
-                    indexList[0] = tempShareIndex.tedSeedIndex + 1;
-                    mpz_import(share_[0], HHASH_KEY_SEED, 1, sizeof(char), 1, 0,  tempKeySeed.hhashKeySeed.hhashKeySeed);
-                    
-                    for (size_t j = 0; j < K_PARA - 1; j++) {
-                        memcpy(&tempKeySeed, chunkKeyArray_[tempShareIndex.shareIndexArray[j]] + assignNumberArray[tempShareIndex.shareIndexArray[j]] * sizeof(KeySeedReturnEntry_t), sizeof(KeySeedReturnEntry_t));
-                        mpz_import(share_[j + 1], HHASH_KEY_SEED, 1, sizeof(char), 1, 0, tempKeySeed.hhashKeySeed.hhashKeySeed);
-                        // assignNumberArray[tempShareIndex.shareIndexArray[j]]++;
-                        indexList[j + 1] = tempShareIndex.shareIndexArray[j] + 1;
-                    }
-                    hHash_->RecoverySecretFromHash(share_, indexList, finalSecret_, adjustValue_);
-                    u_char tempSecret[HHASH_KEY_SEED] = { 0 };
-                    size_t length;
-                    mpz_export(tempSecret, &length, 1, sizeof(char), 1, 0, finalSecret_);
-                    
-                    memcpy(newKeyBuffer, batchList[i].chunk.chunkHash, CHUNK_HASH_SIZE);
-                    memcpy(newKeyBuffer + CHUNK_HASH_SIZE, tempSecret, HHASH_KEY_SEED);
-		            //cout << "chunk hash: ";
-	 	            //for (size_t j = 0; j < CHUNK_HASH_SIZE; j++) {
-                    //    printf("%x", batchList[i].chunk.chunkHash[j]);
-                    //}
-                    //cout << endl;
-                    cryptoObj_->generateHash(newKeyBuffer, CHUNK_HASH_SIZE + HHASH_KEY_SEED,
-                        batchList[i].chunk.encryptKey);
-		            //cout << "Encryption key: ";
-		            //for (size_t j = 0; j < CHUNK_HASH_SIZE; j++) {
-		            //	printf("%x", batchList[i].chunk.encryptKey[j]);
-		            // }
-		            // cout << endl;
+                    deriveKeySS(batchList[i], i, cryptoObj_, hHash_, share_, finalSecret_);
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timeendKey, NULL);
                     diff = 1000000 * (timeendKey.tv_sec - timestartKey.tv_sec) + timeendKey.tv_usec - timestartKey.tv_usec;
@@ -1075,7 +1205,7 @@ void keyClient::runSS()
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timestartKey, NULL);
 #endif
-                    bool encodeChunkStatus = encodeChunk(batchList[i]);
+                    bool encodeChunkStatus = encodeChunk(*batchList[i]);
 #if SYSTEM_BREAK_DOWN == 1
                     gettimeofday(&timeendKey, NULL);
                     diff = 1000000 * (timeendKey.tv_sec - timestartKey.tv_sec) + timeendKey.tv_usec - timestartKey.tv_usec;
@@ -1088,11 +1218,6 @@ void keyClient::runSS()
                         cerr << "KeyClient : encode chunk error, exiting" << endl;
                         return;
                     }
-
-                    for (size_t i = 0; i < this->keyManNum_; i++) {
-                        assignNumberArray[i]++;
-                    }
-
                 }
                 batchList.clear();
                 batchList.reserve(keyBatchSize_);
@@ -1108,6 +1233,12 @@ void keyClient::runSS()
             }
         }
         if (JobDoneFlag) {
+            // the chunks in the encoding threads go to the sender before its job done flag
+            if (!waitEncodeDone()) {
+                cerr << "KeyClient : encode chunk error, exiting" << endl;
+                abortEncode();
+                return;
+            }
             if (!senderObj_->editJobDoneFlag()) {
                 cerr << "KeyClient : error to set job done flag for sender" << endl;
             } else {
@@ -1118,6 +1249,7 @@ void keyClient::runSS()
     }
 #if SYSTEM_BREAK_DOWN == 1
     cout << "KeyClient : keyGen total work time = " << keyGenTime << " s" << endl;
+    cout << "KeyClient : input queue high-water mark = " << inputMQ_->getHighWater() << " chunks (" << inputMQ_->getHighWater() * sizeof(PooledData_t) / (1024 * 1024) << " MB)" << endl;
     cout << "KeyClient : assign chunk work time = " << assignTime << " s" << endl;
     cout << "KeyClient : short hash compute work time = " << shortHashTime << " s" << endl;
     cout << "KeyClient : key exchange work time = " << keyExchangeTime << " s" << endl;
@@ -1128,3 +1260,18 @@ void keyClient::runSS()
 #endif
     return;
 }
+
+void keyClient::generateShortHash(Data_t* newChunk, uint32_t maskInt, u_char* shortHash)
+{
+    int hashInt[4];
+#if SHORT_HASH_FROM_FINGERPRINT == 1
+    // the fingerprint is already a hash of the chunk, no second pass over the chunk data
+    memcpy(hashInt, newChunk->chunk.chunkHash, 4 * sizeof(int));
+#else
+    MurmurHash3_x64_128((void const*)newChunk->chunk.logicData, newChunk->chunk.logicDataSize, 0, (void*)hashInt);
+#endif
+    for (int i = 0; i < 4; i++) {
+        hashInt[i] &= maskInt;
+    }
+    memcpy(shortHash, hashInt, 4 * sizeof(int));
+}
@@ -164,7 +164,8 @@ bool RecvDecode::insertMQ(RetrieverData_t& newData)
 }
 bool RecvDecode::extractMQ(RetrieverData_t& newData)
 {
-    return outPutMQ_->pop(newData);
+    // wait for a chunk, false if the download is done and the queue is drained
+    return outPutMQ_->popWait(newData);
 }
 
 bool RecvDecode::getJobDoneFlag()
@@ -257,7 +258,7 @@ void RecvDecode::run()
 #if SYSTEM_BREAK_DOWN == 1
     cout << "RecvDecode : chunk download time = " << recvChunkTime << " s" << endl;
     cout << "RecvDecode : chunk decrypt time = " << decryptChunkTime << " s" << endl;
-    outPutMQ_->done_ = true;
 #endif
+    outPutMQ_->setJobDoneFlag();
     return;
 }
\ No newline at end of file
@@ -42,6 +42,9 @@ void Retriever::run()
             second = diff / 1000000.0;
             writeFileTime += second;
 #endif
+        } else {
+            cerr << "Retriever : download done with " << totalRecvNumber_ << " of " << totalChunkNumber_ << " chunks" << endl;
+            break;
         }
     }
 #if SYSTEM_BREAK_DOWN == 1
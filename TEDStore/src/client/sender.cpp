@@ -12,7 +12,7 @@ struct timeval timeendSenderRecipe;
 
 Sender::Sender()
 {
-    inputMQ_ = new messageQueue<Data_t>;
+    inputMQ_ = new messageQueue<Data_t*>;
     socket_.init(CLIENT_TCP, config.getStorageServerIP(), config.getStorageServerPort());
     cryptoObj_ = new CryptoPrimitive();
     clientID_ = config.getClientID();
@@ -133,9 +133,11 @@ bool Sender::sendEndFlag()
 
 void Sender::run()
 {
-    Data_t tempChunk;
+    Data_t* tempChunk;
     RecipeList_t recipeList;
-    Recipe_t fileRecipe;
+    // the recipe heads of files, a head may arrive before the last chunks of its file
+    std::deque<Recipe_t> fileRecipeList;
+    bool recipeErrorFlag = false;
     int sendBatchSize = config.getSendChunkBatchSize();
     int status;
     char* sendChunkBatchBuffer = (char*)malloc(sizeof(NetworkHeadStruct_t) + sizeof(int) + sizeof(char) * sendBatchSize * (CHUNK_HASH_SIZE + MAX_CHUNK_SIZE + sizeof(int)));
@@ -157,9 +159,6 @@ void Sender::run()
     gettimeofday(&timestartSenderRun, NULL);
 #endif
     while (!jobDoneFlag) {
-        if (inputMQ_->done_ && inputMQ_->isEmpty()) {
-            jobDoneFlag = true;
-        }
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timestartSender, NULL);
 #endif
@@ -170,27 +169,31 @@ void Sender::run()
         second = diff / 1000000.0;
         totalReadMessageQueueTime += second;
 #endif
+        if (!extractChunkStatus) {
+            // the key client is done and the queue is drained
+            jobDoneFlag = true;
+        }
         if (extractChunkStatus) {
-            if (tempChunk.dataType == DATA_TYPE_RECIPE) {
+            if (tempChunk->dataType == DATA_TYPE_RECIPE) {
 #if SYSTEM_DEBUG_FLAG == 1
-                cout << "Sender : get file recipe head, file size = " << tempChunk.recipe.fileRecipeHead.fileSize << " file chunk number = " << tempChunk.recipe.fileRecipeHead.totalChunkNumber << endl;
-                PRINT_BYTE_ARRAY_SENDER(stderr, tempChunk.recipe.fileRecipeHead.fileNameHash, FILE_NAME_HASH_SIZE);
+                cout << "Sender : get file recipe head, file size = " << tempChunk->recipe.fileRecipeHead.fileSize << " file chunk number = " << tempChunk->recipe.fileRecipeHead.totalChunkNumber << endl;
+                PRINT_BYTE_ARRAY_SENDER(stderr, tempChunk->recipe.fileRecipeHead.fileNameHash, FILE_NAME_HASH_SIZE);
 #endif
-                memcpy(&fileRecipe, &tempChunk.recipe, sizeof(Recipe_t));
-                continue;
+                fileRecipeList.push_back(tempChunk->recipe);
+                DataPool::release(tempChunk);
             } else {
 
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timestartSender, NULL);
 #endif
-                memcpy(sendChunkBatchBuffer + currentSendChunkBatchBufferSize, tempChunk.chunk.chunkHash, CHUNK_HASH_SIZE);
+                memcpy(sendChunkBatchBuffer + currentSendChunkBatchBufferSize, tempChunk->chunk.chunkHash, CHUNK_HASH_SIZE);
                 currentSendChunkBatchBufferSize += CHUNK_HASH_SIZE;
-                memcpy(sendChunkBatchBuffer + currentSendChunkBatchBufferSize, &tempChunk.chunk.logicDataSize, sizeof(int));
+                memcpy(sendChunkBatchBuffer + currentSendChunkBatchBufferSize, &tempChunk->chunk.logicDataSize, sizeof(int));
                 currentSendChunkBatchBufferSize += sizeof(int);
-                memcpy(sendChunkBatchBuffer + currentSendChunkBatchBufferSize, tempChunk.chunk.logicData, tempChunk.chunk.logicDataSize);
-                currentSendChunkBatchBufferSize += tempChunk.chunk.logicDataSize;
+                memcpy(sendChunkBatchBuffer + currentSendChunkBatchBufferSize, tempChunk->chunk.logicData, tempChunk->chunk.logicDataSize);
+                currentSendChunkBatchBufferSize += tempChunk->chunk.logicDataSize;
                 currentChunkNumber++;
-                // cout << "Sender : Chunk ID = " << tempChunk.chunk.ID << " size = " << tempChunk.chunk.logicDataSize << endl;
+                // cout << "Sender : Chunk ID = " << tempChunk->chunk.ID << " size = " << tempChunk->chunk.logicDataSize << endl;
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timeendSender, NULL);
                 diff = 1000000 * (timeendSender.tv_sec - timestartSender.tv_sec) + timeendSender.tv_usec - timestartSender.tv_usec;
@@ -198,20 +201,22 @@ void Sender::run()
                 totalChunkAssembleTime += second;
 #endif
                 // #if SYSTEM_DEBUG_FLAG == 1
-                //                     PRINT_BYTE_ARRAY_SENDER(stderr, tempChunk.chunk.chunkHash, CHUNK_HASH_SIZE);
-                //                     PRINT_BYTE_ARRAY_SENDER(stderr, tempChunk.chunk.encryptKey, CHUNK_ENCRYPT_KEY_SIZE);
-                //                     PRINT_BYTE_ARRAY_SENDER(stderr, tempChunk.chunk.logicData, tempChunk.chunk.logicDataSize);
+                //                     PRINT_BYTE_ARRAY_SENDER(stderr, tempChunk->chunk.chunkHash, CHUNK_HASH_SIZE);
+                //                     PRINT_BYTE_ARRAY_SENDER(stderr, tempChunk->chunk.encryptKey, CHUNK_ENCRYPT_KEY_SIZE);
+                //                     PRINT_BYTE_ARRAY_SENDER(stderr, tempChunk->chunk.logicData, tempChunk->chunk.logicDataSize);
                 // #endif
                 
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timestartSender, NULL);
 #endif
                 RecipeEntry_t newRecipeEntry;
-                newRecipeEntry.chunkID = tempChunk.chunk.ID;
-                newRecipeEntry.chunkSize = tempChunk.chunk.logicDataSize;
-                memcpy(newRecipeEntry.chunkHash, tempChunk.chunk.chunkHash, CHUNK_HASH_SIZE);
-                memcpy(newRecipeEntry.chunkKey, tempChunk.chunk.encryptKey, CHUNK_ENCRYPT_KEY_SIZE);
+                newRecipeEntry.chunkID = tempChunk->chunk.ID;
+                newRecipeEntry.chunkSize = tempChunk->chunk.logicDataSize;
+                memcpy(newRecipeEntry.chunkHash, tempChunk->chunk.chunkHash, CHUNK_HASH_SIZE);
+                memcpy(newRecipeEntry.chunkKey, tempChunk->chunk.encryptKey, CHUNK_ENCRYPT_KEY_SIZE);
                 recipeList.push_back(newRecipeEntry);
+                // the chunk is copied into the send buffer and the recipe, return it to the chunker
+                DataPool::release(tempChunk);
                 currentSendRecipeNumber++;
 #if SYSTEM_BREAK_DOWN == 1
                 gettimeofday(&timeendSender, NULL);
@@ -221,7 +226,13 @@ void Sender::run()
 #endif
             }
         }
-        if (currentChunkNumber == sendBatchSize || jobDoneFlag) {
+        // the recipe heads come apart from the chunks, take them when the next one is needed
+        if (jobDoneFlag || fileRecipeList.empty() || recipeList.size() >= fileRecipeList.front().fileRecipeHead.totalChunkNumber) {
+            takeRecipes(fileRecipeList);
+        }
+        // the chunks of a file are stored before its recipe
+        bool recipeReadyFlag = !fileRecipeList.empty() && recipeList.size() >= fileRecipeList.front().fileRecipeHead.totalChunkNumber;
+        if (currentChunkNumber == sendBatchSize || jobDoneFlag || (recipeReadyFlag && currentChunkNumber != 0)) {
             // cout << "Sender : run -> start send " << setbase(10) << currentChunkNumber << " chunks to server, size = " << setbase(10) << currentSendChunkBatchBufferSize << endl;
 #if SYSTEM_BREAK_DOWN == 1
             gettimeofday(&timestartSender, NULL);
@@ -248,43 +259,53 @@ void Sender::run()
                 break;
             }
         }
-    }
+        while (!fileRecipeList.empty() && recipeList.size() >= fileRecipeList.front().fileRecipeHead.totalChunkNumber) {
 #if SYSTEM_BREAK_DOWN == 1
-    cout << "Sender : assemble chunk list time = " << totalChunkAssembleTime << " s" << endl;
-    cout << "Sender : chunk upload and storage service time = " << totalSendChunkTime << " s" << endl;
-#endif
-#if SYSTEM_BREAK_DOWN == 1
-    gettimeofday(&timestartSender, NULL);
+            gettimeofday(&timestartSender, NULL);
 #endif
 #if SYSTEM_DEBUG_FLAG == 1
-    cout << "Sender : start send file recipes" << endl;
+            cout << "Sender : start send file recipe, file chunk number = " << fileRecipeList.front().fileRecipeHead.totalChunkNumber << endl;
 #endif
-    if (!this->sendRecipe(fileRecipe, recipeList, status)) {
-        cerr << "Sender : send recipe list error, upload fail " << endl;
-        free(sendChunkBatchBuffer);
-        bool serverJobDoneFlag = sendEndFlag();
-        if (serverJobDoneFlag) {
-            return;
-        } else {
-            cerr << "Sender : server job done flag error, server may shutdown, upload may faild" << endl;
-            return;
+            // the entries of the next file stay in the list
+            RecipeList_t::iterator fileEnd = recipeList.begin() + fileRecipeList.front().fileRecipeHead.totalChunkNumber;
+            RecipeList_t fileRecipeEntryList(recipeList.begin(), fileEnd);
+            recipeList.erase(recipeList.begin(), fileEnd);
+            if (!this->sendRecipe(fileRecipeList.front(), fileRecipeEntryList, status)) {
+                cerr << "Sender : send recipe list error, upload fail " << endl;
+                recipeErrorFlag = true;
+                break;
+            }
+            fileRecipeList.pop_front();
+#if SYSTEM_BREAK_DOWN == 1
+            gettimeofday(&timeendSender, NULL);
+            diff = 1000000 * (timeendSender.tv_sec - timestartSender.tv_sec) + timeendSender.tv_usec - timestartSender.tv_usec;
+            second = diff / 1000000.0;
+            totalSendRecipeTime += second;
+#endif
+        }
+        if (recipeErrorFlag) {
+            break;
         }
     }
+    if (!recipeErrorFlag && (!fileRecipeList.empty() || !recipeList.empty())) {
+        cerr << "Sender : " << fileRecipeList.size() << " file recipes and " << recipeList.size() << " chunks are not matched, upload fail" << endl;
+    }
+#if SYSTEM_BREAK_DOWN == 1
+    cout << "Sender : assemble chunk list time = " << totalChunkAssembleTime << " s" << endl;
+    cout << "Sender : chunk upload and storage service time = " << totalSendChunkTime << " s" << endl;
+#endif
 #if SYSTEM_BREAK_DOWN == 1
     gettimeofday(&timeendSenderRun, NULL);
     diff = 1000000 * (timeendSenderRun.tv_sec - timestartSenderRun.tv_sec) + timeendSenderRun.tv_usec - timestartSenderRun.tv_usec;
     second = diff / 1000000.0;
     totalSenderRunTime += second;
-#endif
-#if SYSTEM_BREAK_DOWN == 1
-    gettimeofday(&timeendSender, NULL);
-    diff = 1000000 * (timeendSender.tv_sec - timestartSender.tv_sec) + timeendSender.tv_usec - timestartSender.tv_usec;
-    second = diff / 1000000.0;
-    totalSendRecipeTime += second;
     cout << "Sender : assemble recipe list time = " << totalRecipeAssembleTime << " s" << endl;
     cout << "Sender : send recipe list time = " << totalSendRecipeTime << " s" << endl;
     cout << "Sender : total sending work time = " << totalRecipeAssembleTime + totalSendRecipeTime + totalChunkAssembleTime + totalSendChunkTime << " s" << endl;
     cout << "Sender : total thread work time = " << totalSenderRunTime - totalReadMessageQueueTime << " s" << endl;
+    cout << "Sender : input queue high-water mark = " << inputMQ_->getHighWater() << " chunks ("
+         << inputMQ_->getHighWater() * sizeof(PooledData_t) / (1024 * 1024) << " MB), reorder buffer high-water mark = "
+         << reorderHighWater_ << " chunks (" << reorderHighWater_ * sizeof(PooledData_t) / (1024 * 1024) << " MB)" << endl;
 #endif
     free(sendChunkBatchBuffer);
     bool serverJobDoneFlag = sendEndFlag();
@@ -296,22 +317,72 @@ void Sender::run()
     }
 }
 
-bool Sender::insertMQFromKeyClient(Data_t& newChunk)
+bool Sender::insertMQFromKeyClient(Data_t* newChunk)
+{
+    // the encoding threads may finish out of order, the chunks are queued in the stream order
+    std::lock_guard<std::mutex> locker(reorderMtx_);
+    if (newChunk->seq != nextSeq_) {
+        reorderBuffer_[newChunk->seq] = newChunk;
+        reorderHighWater_ = max(reorderHighWater_, reorderBuffer_.size());
+        return true;
+    }
+    bool status = inputMQ_->push(newChunk);
+    nextSeq_++;
+    std::map<uint64_t, Data_t*>::iterator it = reorderBuffer_.begin();
+    while (it != reorderBuffer_.end() && it->first == nextSeq_) {
+        if (!inputMQ_->push(it->second)) {
+            status = false;
+        }
+        nextSeq_++;
+        it = reorderBuffer_.erase(it);
+    }
+    return status;
+}
+
+bool Sender::insertRecipeFromKeyClient(Data_t* newRecipe)
 {
-    return inputMQ_->push(newChunk);
+    // the recipe does not wait behind the chunks of an unfinished key batch, its buffer goes back at once
+    std::lock_guard<std::mutex> locker(recipeMtx_);
+    recipeQueue_.push_back(newRecipe->recipe);
+    DataPool::release(newRecipe);
+    return true;
 }
 
-bool Sender::extractMQFromKeyClient(Data_t& newChunk)
+void Sender::takeRecipes(std::deque<Recipe_t>& fileRecipeList)
 {
-    return inputMQ_->pop(newChunk);
+    std::lock_guard<std::mutex> locker(recipeMtx_);
+    while (!recipeQueue_.empty()) {
+        fileRecipeList.push_back(recipeQueue_.front());
+        recipeQueue_.pop_front();
+    }
+}
+
+bool Sender::extractMQFromKeyClient(Data_t*& newChunk)
+{
+    // take a batch of chunks at once, wait only when the taken ones are used up
+    if (popPos_ == popNum_) {
+        popNum_ = inputMQ_->popBatch(popBuffer_, MQ_POP_BATCH_SIZE);
+        popPos_ = 0;
+        if (popNum_ == 0) {
+            return false;
+        }
+    }
+    newChunk = popBuffer_[popPos_++];
+    return true;
 }
 
 bool Sender::editJobDoneFlag()
 {
-    inputMQ_->done_ = true;
-    if (inputMQ_->done_) {
-        return true;
-    } else {
-        return false;
+    return inputMQ_->setJobDoneFlag();
+}
+
+bool Sender::abortJob()
+{
+    // the chunks waiting for a sequence number that never comes are not sent
+    std::lock_guard<std::mutex> locker(reorderMtx_);
+    for (std::map<uint64_t, Data_t*>::iterator it = reorderBuffer_.begin(); it != reorderBuffer_.end(); it++) {
+        DataPool::release(it->second);
     }
+    reorderBuffer_.clear();
+    return inputMQ_->setJobDoneFlag();
 }
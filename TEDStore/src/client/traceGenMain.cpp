@@ -0,0 +1,332 @@
+/**
+ * @file traceGenMain.cpp
+ * @author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+ * @brief generate the fingerprint trace of a directory with the chunker, in the input
+ * format of TED (text, or the binary FSL hashfile)
+ * @version 0.1
+ * @date 2020-10-29
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "chunker.hpp"
+#include "configure.hpp"
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace std;
+
+Configure config("config.json");
+
+// the chunks of a file: the truncated fingerprints and the sizes
+typedef struct {
+    vector<u_char> fpList;
+    vector<uint64_t> sizeList;
+    uint64_t fileSize;
+    struct stat fileStat;
+    bool done;
+    bool status;
+} FileTrace_t;
+
+// the shared state between chunking threads and the writer
+vector<string> fileList;
+vector<FileTrace_t> traceList;
+size_t nextFileIndex = 0;
+size_t writtenFileIndex = 0;
+size_t fileWindow = 0;
+int fpSize = TRACE_GEN_FP_SIZE;
+bool chunkingError = false;
+std::mutex traceMtx;
+std::condition_variable traceDone;
+std::condition_variable windowFree;
+
+void usage()
+{
+    cerr << "[traceGen [-t chunkingType] [-n threadNumber] [-f fingerprintSize] [-b] inputPath outputFile]" << endl;
+    cerr << "chunkingType: 0 fixed-size, 1 variable-size, 4 FastCDC (default: the chunkingType in config.json)" << endl;
+    cerr << "fingerprintSize: the truncated bytes of SHA-256 fingerprints (default: " << TRACE_GEN_FP_SIZE << ")" << endl;
+    cerr << "-b: write the binary FSL hashfile instead of the text trace" << endl;
+}
+
+/**
+ * @brief the chunking thread: take the next file, chunk it, and hand the trace to the writer
+ *
+ */
+void chunkFiles()
+{
+    // one chunker per thread, its buffers and threads are reused for each file
+    FileTrace_t* trace = NULL;
+    Chunker* chunkerObj = new Chunker([&trace](Data_t& newData) {
+        if (newData.dataType == DATA_TYPE_CHUNK) {
+            trace->fpList.insert(trace->fpList.end(), newData.chunk.chunkHash, newData.chunk.chunkHash + fpSize);
+            trace->sizeList.push_back(newData.chunk.logicDataSize);
+            trace->fileSize += newData.chunk.logicDataSize;
+        }
+        return true;
+    });
+    while (true) {
+        size_t fileIndex;
+        {
+            std::unique_lock<std::mutex> lock(traceMtx);
+            // bound the chunked files waiting for the writer
+            windowFree.wait(lock, [] { return chunkingError || nextFileIndex < writtenFileIndex + fileWindow; });
+            if (chunkingError || nextFileIndex == fileList.size()) {
+                break;
+            }
+            fileIndex = nextFileIndex++;
+        }
+
+        trace = &traceList[fileIndex];
+        trace->fileSize = 0;
+        lstat(fileList[fileIndex].c_str(), &trace->fileStat);
+        bool status = chunkerObj->chunking(fileList[fileIndex]);
+
+        std::unique_lock<std::mutex> lock(traceMtx);
+        trace->status = status;
+        trace->done = true;
+        if (!status) {
+            chunkingError = true;
+            windowFree.notify_all();
+        }
+        traceDone.notify_all();
+    }
+    delete chunkerObj;
+}
+
+/**
+ * @brief write the header of binary trace (FSL hashfile)
+ *
+ * @param fp the output file
+ * @param rootPath the input path
+ * @param fileNum the number of files
+ * @param chunkNum the number of chunks
+ * @param totalSize the total size of files
+ * @param startTime the start time
+ * @param endTime the end time
+ */
+void writeHashFileHeader(FILE* fp, string rootPath, uint64_t fileNum, uint64_t chunkNum, uint64_t totalSize,
+    int64_t startTime, int64_t endTime)
+{
+    // magic(4) version(4) root path(4096) system id(4096) files(8) chunks(8) bytes(8) start/end time(16)
+    // chunking method(4) chunking params(20) hashing method(4) hash size(4) compression method(4) level(4)
+    u_char header[8 + 2 * HASHFILE_PATH_SIZE + 80];
+    memset(header, 0, sizeof(header));
+    uint32_t value32[4];
+    uint64_t value64[5] = { fileNum, chunkNum, totalSize, (uint64_t)startTime, (uint64_t)endTime };
+    value32[0] = HASHFILE_MAGIC;
+    value32[1] = HASHFILE_VERSION;
+    memcpy(header, value32, 2 * sizeof(uint32_t));
+    strncpy((char*)header + 8, rootPath.c_str(), HASHFILE_PATH_SIZE - 1);
+    strncpy((char*)header + 8 + HASHFILE_PATH_SIZE, "TEDStore traceGen", HASHFILE_PATH_SIZE - 1);
+    u_char* pos = header + 8 + 2 * HASHFILE_PATH_SIZE;
+    memcpy(pos, value64, sizeof(value64));
+    pos += sizeof(value64);
+
+    if (config.getChunkingType() == CHUNKER_FIX_SIZE_TYPE) {
+        value32[0] = HASHFILE_FIXED_CHUNKING;
+        value32[1] = config.getAverageChunkSize();
+        memcpy(pos, value32, 2 * sizeof(uint32_t));
+    } else if (config.getChunkingType() == CHUNKER_FAST_CDC_TYPE) {
+        // algorithm, gear params (no prime, window size), min and max chunk size
+        uint32_t params[6] = { HASHFILE_VARIABLE_CHUNKING, HASHFILE_GEAR_CHUNKING, 0,
+            GEAR_WINDOW_SIZE, (uint32_t)config.getMinChunkSize(),
+            (uint32_t)config.getMaxChunkSize() };
+        memcpy(pos, params, sizeof(params));
+    } else {
+        // algorithm, rabin params (prime, window size), min and max chunk size
+        uint32_t params[6] = { HASHFILE_VARIABLE_CHUNKING, HASHFILE_RABIN_CHUNKING, 257,
+            (uint32_t)config.getSlidingWinSize(), (uint32_t)config.getMinChunkSize(),
+            (uint32_t)config.getMaxChunkSize() };
+        memcpy(pos, params, sizeof(params));
+    }
+    pos += 24;
+    value32[0] = HASHFILE_SHA256_HASH;
+    value32[1] = fpSize;
+    memcpy(pos, value32, 2 * sizeof(uint32_t));
+
+    if (fwrite(header, 1, sizeof(header), fp) != sizeof(header)) {
+        cerr << "TraceGen : write the output error" << endl;
+        exit(1);
+    }
+}
+
+/**
+ * @brief write the trace of a file
+ *
+ * @param fp the output file
+ * @param path the file path
+ * @param trace the chunks of file
+ * @param binary write the binary trace (FSL hashfile)
+ */
+void writeFileTrace(FILE* fp, string& path, FileTrace_t& trace, bool binary)
+{
+    size_t chunkNum = trace.sizeList.size();
+    if (binary) {
+        // file size(8) chunks(8) path length(4) path, metadata (uid, gid, perm, atime, mtime, ctime,
+        // hard links, device id, inode), then each chunk: size(8) compression ratio(1) hash
+        uint64_t value64[2] = { trace.fileSize, chunkNum };
+        uint32_t pathLen = path.length() + 1;
+        fwrite(value64, sizeof(uint64_t), 2, fp);
+        fwrite(&pathLen, sizeof(uint32_t), 1, fp);
+        fwrite(path.c_str(), 1, pathLen, fp);
+        uint32_t ids[2] = { (uint32_t)trace.fileStat.st_uid, (uint32_t)trace.fileStat.st_gid };
+        uint64_t meta[7] = { (uint64_t)trace.fileStat.st_mode, (uint64_t)trace.fileStat.st_atime,
+            (uint64_t)trace.fileStat.st_mtime, (uint64_t)trace.fileStat.st_ctime,
+            (uint64_t)trace.fileStat.st_nlink, (uint64_t)trace.fileStat.st_dev,
+            (uint64_t)trace.fileStat.st_ino };
+        fwrite(ids, sizeof(uint32_t), 2, fp);
+        fwrite(meta, sizeof(uint64_t), 7, fp);
+        u_char compressRatio = 0;
+        for (size_t i = 0; i < chunkNum; i++) {
+            fwrite(&trace.sizeList[i], sizeof(uint64_t), 1, fp);
+            fwrite(&compressRatio, 1, 1, fp);
+            fwrite(&trace.fpList[i * fpSize], 1, fpSize, fp);
+        }
+        return;
+    }
+
+    // the same as hf-stat -h without the title line: hex-fingerprint\t\tsize\t\t10
+    static const char* hex = "0123456789abcdef";
+    char line[CHUNK_HASH_SIZE * 3 + 32];
+    for (size_t i = 0; i < chunkNum; i++) {
+        char* pos = line;
+        for (int j = 0; j < fpSize; j++) {
+            u_char byte = trace.fpList[i * fpSize + j];
+            *pos++ = hex[byte >> 4];
+            *pos++ = hex[byte & 0xf];
+            *pos++ = ':';
+        }
+        pos--;
+        pos += sprintf(pos, "\t\t%lu\t\t10\n", trace.sizeList[i]);
+        fwrite(line, 1, pos - line, fp);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int threadNumber = std::thread::hardware_concurrency();
+    bool binary = false;
+    int option;
+    while ((option = getopt(argc, argv, "t:n:f:b")) != -1) {
+        switch (option) {
+        case 't':
+            config.setChunkingType(atoi(optarg));
+            break;
+        case 'n':
+            threadNumber = atoi(optarg);
+            break;
+        case 'f':
+            fpSize = atoi(optarg);
+            break;
+        case 'b':
+            binary = true;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (argc - optind != 2) {
+        usage();
+        return 1;
+    }
+    if (config.getChunkingType() != CHUNKER_FIX_SIZE_TYPE && config.getChunkingType() != CHUNKER_VAR_SIZE_TYPE
+        && config.getChunkingType() != CHUNKER_FAST_CDC_TYPE) {
+        cerr << "TraceGen : only the fixed-size, variable-size and FastCDC chunking can generate traces" << endl;
+        return 1;
+    }
+    if (fpSize <= 0 || fpSize > CHUNK_HASH_SIZE) {
+        cerr << "TraceGen : the fingerprint size should be in [1, " << CHUNK_HASH_SIZE << "]" << endl;
+        return 1;
+    }
+    if (threadNumber <= 0) {
+        threadNumber = 1;
+    }
+    string inputPath(argv[optind]);
+    string outputFile(argv[optind + 1]);
+
+    struct timeval timestart;
+    struct timeval timeend;
+    gettimeofday(&timestart, NULL);
+
+    Chunker::collectFiles(inputPath, fileList);
+    if (fileList.empty()) {
+        cerr << "TraceGen : no file to chunk under " << inputPath << endl;
+        return 1;
+    }
+    traceList.resize(fileList.size());
+    for (size_t i = 0; i < traceList.size(); i++) {
+        traceList[i].done = false;
+    }
+    fileWindow = threadNumber * TRACE_GEN_FILE_WINDOW;
+    cerr << "TraceGen : chunk " << fileList.size() << " files with " << threadNumber << " threads" << endl;
+
+    FILE* fp = fopen(outputFile.c_str(), binary ? "wb" : "w");
+    if (fp == NULL) {
+        cerr << "TraceGen : open the output " << outputFile << " error" << endl;
+        return 1;
+    }
+    if (binary) {
+        // the totals are filled after all files are chunked
+        writeHashFileHeader(fp, inputPath, 0, 0, 0, timestart.tv_sec, 0);
+    }
+
+    vector<std::thread> threadList;
+    for (int i = 0; i < threadNumber; i++) {
+        threadList.push_back(std::thread(chunkFiles));
+    }
+
+    // write the traces in the order of files
+    uint64_t chunkNum = 0;
+    uint64_t totalSize = 0;
+    bool status = true;
+    for (size_t i = 0; i < fileList.size(); i++) {
+        {
+            std::unique_lock<std::mutex> lock(traceMtx);
+            traceDone.wait(lock, [i] { return traceList[i].done; });
+        }
+        if (!traceList[i].status) {
+            cerr << "TraceGen : chunking " << fileList[i] << " fails" << endl;
+            status = false;
+            break;
+        }
+        writeFileTrace(fp, fileList[i], traceList[i], binary);
+        chunkNum += traceList[i].sizeList.size();
+        totalSize += traceList[i].fileSize;
+        vector<u_char>().swap(traceList[i].fpList);
+        vector<uint64_t>().swap(traceList[i].sizeList);
+
+        std::unique_lock<std::mutex> lock(traceMtx);
+        writtenFileIndex = i + 1;
+        windowFree.notify_all();
+    }
+    {
+        std::unique_lock<std::mutex> lock(traceMtx);
+        writtenFileIndex = fileList.size();
+        windowFree.notify_all();
+    }
+    for (size_t i = 0; i < threadList.size(); i++) {
+        threadList[i].join();
+    }
+    if (!status) {
+        // no partial trace is left as if it were complete
+        fclose(fp);
+        remove(outputFile.c_str());
+        return 1;
+    }
+
+    gettimeofday(&timeend, NULL);
+    if (binary) {
+        fseek(fp, 0, SEEK_SET);
+        writeHashFileHeader(fp, inputPath, fileList.size(), chunkNum, totalSize, timestart.tv_sec, timeend.tv_sec);
+    }
+    fclose(fp);
+
+    long diff = 1000000 * (timeend.tv_sec - timestart.tv_sec) + timeend.tv_usec - timestart.tv_usec;
+    double second = diff / 1000000.0;
+    cerr << "TraceGen : " << fileList.size() << " files, " << chunkNum << " chunks, " << totalSize
+         << " bytes, time = " << second << " s" << endl;
+    return 0;
+}
@@ -24,6 +24,7 @@ keyServer::keyServer(ssl* keyServerSecurityChannelTemp)
     opSolverFlag_ = false;
     opm_ = sketchTableWidith_ * (1 + config.getStorageBlowPercent());
     gen_ = mt19937_64(rd_());
+    cumulativeLogicalChunks_ = 0;
     memset(keyServerPrivate_, 1, SECRET_SIZE);
     optimalSolverComputeItemNumberThreshold_ = config.getOptimalSolverComputeItemNumberThreshold();
 }
@@ -42,6 +43,7 @@ keyServer::keyServer(ssl* keyServerSecurityChannelTemp, uint64_t secretValue)
     opSolverFlag_ = false;
     opm_ = sketchTableWidith_ * (1 + config.getStorageBlowPercent());
     gen_ = mt19937_64(rd_());
+    cumulativeLogicalChunks_ = 0;
     memset(keyServerPrivate_, 1, SECRET_SIZE);
     optimalSolverComputeItemNumberThreshold_ = config.getOptimalSolverComputeItemNumberThreshold();
     secretValue_ = secretValue;
@@ -59,6 +61,44 @@ keyServer::~keyServer()
     delete cryptoObj_;
 }
 
+void keyServer::countChunk(HyperLogLog& plainHLL, HyperLogLog& cipherHLL, const u_char* chunkHash, int param)
+{
+    if (!KEY_SERVER_DEDUP_ESTIMATE) {
+        return;
+    }
+    // the same (hash, param) pair derives the same key, hence the same ciphertext
+    u_char cipherKey[4 * sizeof(uint32_t) + sizeof(int)];
+    memcpy(cipherKey, chunkHash, 4 * sizeof(uint32_t));
+    memcpy(cipherKey + 4 * sizeof(uint32_t), &param, sizeof(int));
+    plainHLL.add(chunkHash, 4 * sizeof(uint32_t));
+    cipherHLL.add(cipherKey, sizeof(cipherKey));
+}
+
+void keyServer::reportDedupEstimate(HyperLogLog& plainHLL, HyperLogLog& cipherHLL, uint64_t logicalChunks)
+{
+    if (!KEY_SERVER_DEDUP_ESTIMATE || logicalChunks == 0) {
+        return;
+    }
+    double plainUnique = plainHLL.estimate();
+    double cipherUnique = cipherHLL.estimate();
+    cout << "keyServer : backup logical chunk number = " << logicalChunks << endl;
+    cout << "keyServer : backup estimated unique plaintext chunk number = " << plainUnique << endl;
+    cout << "keyServer : backup estimated unique ciphertext chunk number = " << cipherUnique << endl;
+    cout << "keyServer : backup estimated dedup ratio (plaintext) = " << logicalChunks / plainUnique << endl;
+    cout << "keyServer : backup estimated dedup ratio (ciphertext) = " << logicalChunks / cipherUnique << endl;
+
+    std::lock_guard<std::mutex> locker(multiThreadEditHLLMutex_);
+    cumulativePlainHLL_.merge(plainHLL);
+    cumulativeCipherHLL_.merge(cipherHLL);
+    cumulativeLogicalChunks_ += logicalChunks;
+    plainUnique = cumulativePlainHLL_.estimate();
+    cipherUnique = cumulativeCipherHLL_.estimate();
+    cout << "keyServer : cumulative logical chunk number = " << cumulativeLogicalChunks_ << endl;
+    cout << "keyServer : cumulative estimated dedup ratio (plaintext) = " << cumulativeLogicalChunks_ / plainUnique << endl;
+    cout << "keyServer : cumulative estimated dedup ratio (ciphertext) = " << cumulativeLogicalChunks_ / cipherUnique << endl;
+    cout << "keyServer : cumulative estimated storage blowup = " << (cipherUnique - plainUnique) / plainUnique << endl;
+}
+
 #if SINGLE_THREAD_KEY_MANAGER == 1
 
 void keyServer::runKeyGen(SSL* connection)
@@ -73,6 +113,10 @@ void keyServer::runKeyGen(SSL* connection)
 #endif
     char hash[config.getKeyBatchSize() * 4 * sizeof(uint32_t)];
     u_int hashNumber[4];
+    // per-backup (connection) estimators
+    HyperLogLog plainHLL;
+    HyperLogLog cipherHLL;
+    uint64_t logicalChunks = 0;
     u_char newKeyBuffer[64 + 4 * sizeof(uint32_t) + sizeof(int)];
 #if SYSTEM_BREAK_DOWN == 1
     gettimeofday(&timestartKeyServerTotal, NULL);
@@ -161,6 +205,7 @@ void keyServer::runKeyGen(SSL* connection)
                 else
                     param = result;
             }
+            countChunk(plainHLL, cipherHLL, (u_char*)hash + i * 4 * sizeof(uint32_t), param);
             memcpy(newKeyBuffer, keyServerPrivate_, 64);
             memcpy(newKeyBuffer + 64, hash + i * 4 * sizeof(uint32_t), 4 * sizeof(uint32_t));
             memcpy(newKeyBuffer + 64 + 4 * sizeof(uint32_t), &param, sizeof(int));
@@ -169,6 +214,7 @@ void keyServer::runKeyGen(SSL* connection)
             memcpy(key + i * CHUNK_ENCRYPT_KEY_SIZE, currentKeySeed, CHUNK_ENCRYPT_KEY_SIZE);
         }
         sketchTableCounter_ += recvNumber;
+        logicalChunks += recvNumber;
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timeendKeyServer, NULL);
         diff = 1000000 * (timeendKeyServer.tv_sec - timestartKeyServer.tv_sec) + timeendKeyServer.tv_usec - timestartKeyServer.tv_usec;
@@ -229,6 +275,7 @@ void keyServer::runKeyGen(SSL* connection)
             multiThreadEditTMutex_.unlock();
         }
     }
+    reportDedupEstimate(plainHLL, cipherHLL, logicalChunks);
     cerr << "keyServer : exit successfully" << endl;
     return;
 }
@@ -242,6 +289,10 @@ void keyServer::runKeyGen(SSL* connection)
     double second;
     char hash[config.getKeyBatchSize() * 4 * sizeof(uint32_t)];
     u_int hashNumber[4];
+    // per-backup (connection) estimators
+    HyperLogLog plainHLL;
+    HyperLogLog cipherHLL;
+    uint64_t logicalChunks = 0;
     u_char newKeyBuffer[64 + 4 * sizeof(uint32_t) + sizeof(int)];
     while (true) {
         int recvSize = 0;
@@ -312,6 +363,7 @@ void keyServer::runKeyGen(SSL* connection)
                 else
                     param = result;
             }
+            countChunk(plainHLL, cipherHLL, (u_char*)hash + i * 4 * sizeof(uint32_t), param);
             memcpy(newKeyBuffer, keyServerPrivate_, 64);
             memcpy(newKeyBuffer + 64, hash + i * 4 * sizeof(uint32_t), 4 * sizeof(uint32_t));
             memcpy(newKeyBuffer + 64 + 4 * sizeof(uint32_t), &param, sizeof(int));
@@ -320,6 +372,7 @@ void keyServer::runKeyGen(SSL* connection)
             memcpy(key + i * CHUNK_ENCRYPT_KEY_SIZE, currentKeySeed, CHUNK_ENCRYPT_KEY_SIZE);
         }
         sketchTableCounter_ += recvNumber;
+        logicalChunks += recvNumber;
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timeendKeyServer, NULL);
         diff = 1000000 * (timeendKeyServer.tv_sec - timestartKeyServer.tv_sec) + timeendKeyServer.tv_usec - timestartKeyServer.tv_usec;
@@ -364,6 +417,7 @@ void keyServer::runKeyGen(SSL* connection)
         }
     }
 
+    reportDedupEstimate(plainHLL, cipherHLL, logicalChunks);
     cerr << "keyServer : exit successfully" << endl;
     return;
 }
@@ -391,6 +445,10 @@ void keyServer::runKeyGenSimple(SSL* connection)
     double second;
     char hash[config.getKeyBatchSize() * sizeof(keyGenEntry_t)];
     u_int hashNumber[4];
+    // per-backup (connection) estimators
+    HyperLogLog plainHLL;
+    HyperLogLog cipherHLL;
+    uint64_t logicalChunks = 0;
     while (true) {
         int recvSize = 0;
         if (!keySecurityChannel_->recv(connection, hash, recvSize)) {
@@ -454,6 +512,7 @@ void keyServer::runKeyGenSimple(SSL* connection)
             if (config.getStorageBlowPercent() == 0) {
                 param = 1;
             }
+            countChunk(plainHLL, cipherHLL, tempKeyGen.singleChunkHash, param);
             memcpy(newKeyBuffer, keyServerPrivate_, SECRET_SIZE);
             memcpy(newKeyBuffer + SECRET_SIZE, tempKeyGen.singleChunkHash, 4 * sizeof(uint32_t));
             memcpy(newKeyBuffer + SECRET_SIZE + 4 * sizeof(uint32_t), &param, sizeof(int));
@@ -463,6 +522,7 @@ void keyServer::runKeyGenSimple(SSL* connection)
             memcpy(key + i * sizeof(KeySeedReturnEntry_t), &tempKeySeed, sizeof(KeySeedReturnEntry_t));
         }
         sketchTableCounter_ += recvNumber;
+        logicalChunks += recvNumber;
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timeendKeyServer, NULL);
         diff = 1000000 * (timeendKeyServer.tv_sec - timestartKeyServer.tv_sec) + timeendKeyServer.tv_usec - timestartKeyServer.tv_usec;
@@ -506,6 +566,7 @@ void keyServer::runKeyGenSimple(SSL* connection)
             multiThreadEditTMutex_.unlock();
         }
     }
+    reportDedupEstimate(plainHLL, cipherHLL, logicalChunks);
     cerr << "keyServer : exit successfully" << endl;
     return;
 }
@@ -530,6 +591,10 @@ void keyServer::runKeyGenSS(SSL* connection)
     double second;
     char hash[config.getKeyBatchSize() * sizeof(keyGenEntry_t)];
     u_int hashNumber[4];
+    // per-backup (connection) estimators
+    HyperLogLog plainHLL;
+    HyperLogLog cipherHLL;
+    uint64_t logicalChunks = 0;
     while (true) {
         int recvSize = 0;
         if (!keySecurityChannel_->recv(connection, hash, recvSize)) {
@@ -591,6 +656,8 @@ void keyServer::runKeyGenSS(SSL* connection)
                 param = 1;
             }
 
+            countChunk(plainHLL, cipherHLL, tempKeyGen.singleChunkHash, param);
+
             if (tempKeyGen.isShare == true) {
                 // memcpy(newKeyBuffer, keyServerPrivate_, SECRET_SIZE);
                 // memcpy(newKeyBuffer + SECRET_SIZE, tempKeyGen.singleChunkHash, 4 * sizeof(uint32_t));
@@ -618,6 +685,7 @@ void keyServer::runKeyGenSS(SSL* connection)
             memcpy(key + i * sizeof(KeySeedReturnEntry_t), &tempKeySeed, sizeof(KeySeedReturnEntry_t));
         }
         sketchTableCounter_ += recvNumber;
+        logicalChunks += recvNumber;
 #if SYSTEM_BREAK_DOWN == 1
         gettimeofday(&timeendKeyServer, NULL);
         diff = 1000000 * (timeendKeyServer.tv_sec - timestartKeyServer.tv_sec) + timeendKeyServer.tv_usec - timestartKeyServer.tv_usec;
@@ -661,6 +729,7 @@ void keyServer::runKeyGenSS(SSL* connection)
             multiThreadEditTMutex_.unlock();
         }
     }
+    reportDedupEstimate(plainHLL, cipherHLL, logicalChunks);
     cerr << "keyServer : exit successfully" << endl;
     // clean up hHash function
     delete hHash;
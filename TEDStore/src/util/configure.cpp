@@ -21,6 +21,10 @@ void Configure::readConf(std::string path)
     _slidingWinSize = root.get<uint64_t>("ChunkerConfig._slidingWinSize");
     _averageChunkSize = root.get<uint64_t>("ChunkerConfig._avgChunkSize");
     _ReadSize = root.get<uint64_t>("ChunkerConfig._ReadSize");
+    // optional, 1 (serial chunking) if not set
+    _chunkingThreadNum = root.get<uint64_t>("ChunkerConfig._chunkingThreadNum", 1);
+    // optional, 0 (hash in the chunker thread) if not set
+    _fingerprintThreadNum = root.get<uint64_t>("ChunkerConfig._fingerprintThreadNum", 0);
 
     //Key Server Configure
     _keyBatchSize = root.get<uint64_t>("KeyServerConfig._keyBatchSize");
@@ -48,6 +52,10 @@ void Configure::readConf(std::string path)
     _sendRecipeBatchSize = root.get<int>("client._sendRecipeBatchSize");
     _sendShortHashMaskBitNumber = root.get<int>("client._sendShortHashMaskBitNumber");
     _adjustValue = root.get<uint64_t>("client._adjustValue");
+    // optional, 0 (encode in the key client thread) if not set
+    _encodeThreadNum = root.get<uint64_t>("client._encodeThreadNum", 0);
+    // optional, 0 (no budget) if not set
+    _memoryBudget = root.get<uint64_t>("client._memoryBudget", 0);
 
     // key manager ip list
     _keyManagerNum = 0;
@@ -70,6 +78,11 @@ uint64_t Configure::getChunkingType()
     return _chunkingType;
 }
 
+void Configure::setChunkingType(uint64_t chunkingType)
+{
+    _chunkingType = chunkingType;
+}
+
 uint64_t Configure::getMaxChunkSize()
 {
 
@@ -99,6 +112,16 @@ uint64_t Configure::getReadSize()
     return _ReadSize;
 }
 
+uint64_t Configure::getChunkingThreadNum()
+{
+    return _chunkingThreadNum;
+}
+
+uint64_t Configure::getFingerprintThreadNum()
+{
+    return _fingerprintThreadNum;
+}
+
 // key management settings
 int Configure::getKeyBatchSize()
 {
@@ -206,4 +229,14 @@ uint64_t Configure::getSecretShare()
 uint64_t Configure::getAdjustValue()
 {
     return _adjustValue;
+}
+
+uint64_t Configure::getEncodeThreadNum()
+{
+    return _encodeThreadNum;
+}
+
+uint64_t Configure::getMemoryBudget()
+{
+    return _memoryBudget;
 }
\ No newline at end of file
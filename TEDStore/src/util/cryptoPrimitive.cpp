@@ -170,6 +170,27 @@ bool CryptoPrimitive::generateHash(u_char* dataBuffer, const int dataSize, u_cha
     return true;
 }
 
+/*
+ * generate the hash of a chunk with the digest context of this object, which
+ * saves the context setup per chunk (not thread-safe, one object per thread)
+ *
+ * @param dataBuffer - the buffer that stores the data
+ * @param dataSize - the size of the data
+ * @param hash - the generated hash <return>
+ *
+ * @return - a boolean value that indicates if the hash generation succeeds
+ */
+bool CryptoPrimitive::generateChunkHash(u_char* dataBuffer, const int dataSize, u_char* hash)
+{
+    int hashSize;
+    if (EVP_DigestInit_ex(mdctx_, md_, nullptr) != 1 || EVP_DigestUpdate(mdctx_, dataBuffer, dataSize) != 1
+        || EVP_DigestFinal_ex(mdctx_, hash, (unsigned int*)&hashSize) != 1) {
+        cerr << "hash error\n";
+        return false;
+    }
+    return true;
+}
+
 bool CryptoPrimitive::encryptWithKey(u_char* dataBuffer, const int dataSize, u_char* key, u_char* ciphertext)
 {
 
@@ -0,0 +1,125 @@
+/**
+ * @file dataPool.cpp
+ * @author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+ * @brief implement the interfaces of the pool of Data_t buffers
+ * @version 0.1
+ * @date 2020-10-27
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "../../include/dataPool.hpp"
+
+#include <new>
+
+/**
+ * @brief Construct a new Data Pool object
+ *
+ * @param bufferNumber the number of buffers, the producer waits when all are in use
+ */
+DataPool::DataPool(uint32_t bufferNumber)
+{
+    bufferNumber_ = bufferNumber;
+    // only the pages of handed out buffers become resident
+    slab_ = (PooledData_t*)malloc(sizeof(PooledData_t) * bufferNumber_);
+    if (slab_ == NULL) {
+        cerr << "DataPool : Memory malloc error" << endl;
+        exit(1);
+    }
+    freeList_.reserve(bufferNumber_);
+}
+
+/**
+ * @brief Destroy the Data Pool object, all buffers should be released
+ *
+ */
+DataPool::~DataPool()
+{
+    if (freeList_.size() != initializedNumber_) {
+        cerr << "DataPool : " << initializedNumber_ - freeList_.size() << " buffers are not released" << endl;
+    }
+    free(slab_);
+}
+
+/**
+ * @brief get a buffer with the reference count of 1 (wait if none is free)
+ *
+ * @return Data_t* the buffer
+ */
+Data_t* DataPool::get()
+{
+    PooledData_t* buffer;
+    {
+        std::unique_lock<std::mutex> lock(poolMtx_);
+        if (freeList_.empty() && initializedNumber_ < bufferNumber_) {
+            buffer = &slab_[initializedNumber_++];
+            buffer->pool = this;
+            new (&buffer->refCount) std::atomic<int>(0);
+        } else {
+            notEmpty_.wait(lock, [this] { return !freeList_.empty(); });
+            buffer = &slab_[freeList_.back()];
+            freeList_.pop_back();
+        }
+        highWaterNumber_ = max(highWaterNumber_, initializedNumber_ - (uint32_t)freeList_.size());
+    }
+    buffer->refCount.store(1, std::memory_order_relaxed);
+    return &buffer->data;
+}
+
+/**
+ * @brief add a reference to a buffer (e.g., hand it to one more stage)
+ *
+ * @param data the buffer
+ */
+void DataPool::retain(Data_t* data)
+{
+    PooledData_t* buffer = reinterpret_cast<PooledData_t*>(data);
+    buffer->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief drop a reference to a buffer, it goes back to its pool at the last one
+ *
+ * @param data the buffer
+ */
+void DataPool::release(Data_t* data)
+{
+    PooledData_t* buffer = reinterpret_cast<PooledData_t*>(data);
+    if (buffer->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        buffer->pool->recycle(buffer);
+    }
+}
+
+/**
+ * @brief put a buffer back to the free list
+ *
+ * @param buffer the buffer
+ */
+void DataPool::recycle(PooledData_t* buffer)
+{
+    std::lock_guard<std::mutex> lock(poolMtx_);
+    freeList_.push_back(buffer - slab_);
+    notEmpty_.notify_one();
+}
+
+/**
+ * @brief get the number of buffers, i.e., the chunks the pipeline holds at most
+ *
+ * @return uint32_t the number of buffers
+ */
+uint32_t DataPool::getBufferNumber()
+{
+    return bufferNumber_;
+}
+
+/**
+ * @brief get the most buffers in use at a time
+ *
+ * @return uint32_t the high-water mark
+ */
+uint32_t DataPool::getHighWaterNumber()
+{
+    std::lock_guard<std::mutex> lock(poolMtx_);
+    return highWaterNumber_;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file hyperLogLog.cpp
+ * @author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+ * @brief implement the interfaces of HyperLogLog cardinality estimator
+ * @version 0.1
+ * @date 2020-10-27
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "../../include/hyperLogLog.hpp"
+
+/**
+ * @brief Construct a new Hyper Log Log object
+ *
+ * @param precision the number of index bits, [4, 18]
+ */
+HyperLogLog::HyperLogLog(uint32_t precision)
+{
+    if (precision < 4 || precision > 18) {
+        cerr << "HyperLogLog : the precision should be in [4, 18], use " << HLL_PRECISION << endl;
+        precision = HLL_PRECISION;
+    }
+    precision_ = precision;
+    registerNum_ = 1U << precision_;
+    registers_ = (uint8_t*)calloc(registerNum_, sizeof(uint8_t));
+}
+
+/**
+ * @brief Destroy the Hyper Log Log object
+ *
+ */
+HyperLogLog::~HyperLogLog()
+{
+    free(registers_);
+}
+
+/**
+ * @brief add a key to the estimator
+ *
+ * @param key the key buffer
+ * @param keyLen the length of key
+ */
+void HyperLogLog::add(const u_char* key, size_t keyLen)
+{
+    uint64_t hash[2];
+    MurmurHash3_x64_128(key, keyLen, HLL_SEED, hash);
+
+    // the high bits select the register, the rank is the position of first 1 in the rest
+    uint32_t index = hash[0] >> (64 - precision_);
+    uint64_t remain = (hash[0] << precision_) | (1ULL << (precision_ - 1));
+    uint8_t rank = __builtin_clzll(remain) + 1;
+    if (rank > registers_[index]) {
+        registers_[index] = rank;
+    }
+}
+
+/**
+ * @brief estimate the number of distinct keys
+ *
+ * @return double the estimated cardinality
+ */
+double HyperLogLog::estimate()
+{
+    double m = registerNum_;
+    double alpha;
+    if (registerNum_ == 16) {
+        alpha = 0.673;
+    } else if (registerNum_ == 32) {
+        alpha = 0.697;
+    } else if (registerNum_ == 64) {
+        alpha = 0.709;
+    } else {
+        alpha = 0.7213 / (1 + 1.079 / m);
+    }
+
+    double sum = 0;
+    uint32_t zeroNum = 0;
+    for (uint32_t i = 0; i < registerNum_; i++) {
+        sum += ldexp(1.0, -registers_[i]);
+        if (registers_[i] == 0) {
+            zeroNum++;
+        }
+    }
+    double result = alpha * m * m / sum;
+
+    // small range correction via linear counting (64-bit hash needs no large range one)
+    if (result <= 2.5 * m && zeroNum != 0) {
+        result = m * log(m / zeroNum);
+    }
+    return result;
+}
+
+/**
+ * @brief merge another estimator (of the same precision) into this one
+ *
+ * @param other the other estimator
+ */
+void HyperLogLog::merge(HyperLogLog const& other)
+{
+    if (other.precision_ != precision_) {
+        cerr << "HyperLogLog : cannot merge estimators with different precision" << endl;
+        return;
+    }
+    for (uint32_t i = 0; i < registerNum_; i++) {
+        if (other.registers_[i] > registers_[i]) {
+            registers_[i] = other.registers_[i];
+        }
+    }
+}
+
+/**
+ * @brief reset all registers
+ *
+ */
+void HyperLogLog::clear()
+{
+    memset(registers_, 0, registerNum_);
+}
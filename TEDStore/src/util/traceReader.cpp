@@ -0,0 +1,318 @@
+/**
+ * @file traceReader.cpp
+ * @author Zuoru YANG (zryang@cse.cuhk.edu.hk)
+ * @brief implement the interfaces of trace reader
+ * @version 0.1
+ * @date 2020-10-23
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+
+#include "../../include/traceReader.hpp"
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/**
+ * @brief Destroy the Trace Reader object
+ * 
+ */
+TraceReader::~TraceReader()
+{
+    close();
+}
+
+/**
+ * @brief detect the format of the input via the magic number
+ * 
+ * @return int the format
+ */
+int TraceReader::detectFormat()
+{
+    uint8_t magic[4] = {0};
+    FILE* fp = fopen(fileName_.c_str(), "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t len = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+
+    if (len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return TRACE_GZIP;
+    }
+    if (len >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f &&
+        magic[3] == 0xfd) {
+        return TRACE_ZSTD;
+    }
+    return TRACE_PLAIN;
+}
+
+/**
+ * @brief open the input file and start the reader thread
+ * 
+ * @param fileName the input file name
+ * @return true success
+ * @return false fail
+ */
+bool TraceReader::open(std::string const fileName)
+{
+    close();
+    fileName_ = fileName;
+    format_ = detectFormat();
+    if (format_ == -1) {
+        return false;
+    }
+#ifndef HAVE_ZSTD
+    if (format_ == TRACE_ZSTD) {
+        cerr << "TraceReader : zstd input is not supported in this build" << endl;
+        return false;
+    }
+#endif
+
+    for (size_t i = 0; i < TRACE_BLOCK_NUM; i++) {
+        TraceBlock_t* block = (TraceBlock_t*) malloc(sizeof(TraceBlock_t));
+        block->data = (char*) malloc(TRACE_BLOCK_SIZE);
+        block->len = 0;
+        freeQueue_.push(block);
+    }
+    readDone_ = false;
+    stop_ = false;
+    current_ = NULL;
+    currentPos_ = 0;
+
+    readerThread_ = std::thread(&TraceReader::readThread, this);
+    isOpen_ = true;
+    return true;
+}
+
+/**
+ * @brief get a free block (wait if none), return NULL if stopped
+ * 
+ * @return TraceBlock_t* the free block
+ */
+TraceBlock_t* TraceReader::getFreeBlock()
+{
+    std::unique_lock<std::mutex> lock(queueMtx_);
+    notFull_.wait(lock, [this] { return stop_ || !freeQueue_.empty(); });
+    if (stop_) {
+        return NULL;
+    }
+    TraceBlock_t* block = freeQueue_.front();
+    freeQueue_.pop();
+    return block;
+}
+
+/**
+ * @brief hand a filled block to the consumer
+ * 
+ * @param block the filled block
+ */
+void TraceReader::putFullBlock(TraceBlock_t* block)
+{
+    std::unique_lock<std::mutex> lock(queueMtx_);
+    fullQueue_.push(block);
+    notEmpty_.notify_one();
+}
+
+/**
+ * @brief the main loop of reader thread
+ * 
+ */
+void TraceReader::readThread()
+{
+    TraceBlock_t* block = NULL;
+
+    if (format_ == TRACE_ZSTD) {
+#ifdef HAVE_ZSTD
+        FILE* fp = fopen(fileName_.c_str(), "rb");
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        size_t inCap = ZSTD_DStreamInSize();
+        char* inBuffer = (char*) malloc(inCap);
+        ZSTD_inBuffer input = {inBuffer, 0, 0};
+        bool inputEnd = false;
+        bool decodeDone = false;
+        size_t ret = 0;
+        while ((block = getFreeBlock()) != NULL) {
+            ZSTD_outBuffer output = {block->data, TRACE_BLOCK_SIZE, 0};
+            while (output.pos < output.size) {
+                if (input.pos == input.size && !inputEnd) {
+                    input.size = fread(inBuffer, 1, inCap, fp);
+                    input.pos = 0;
+                    inputEnd = (input.size == 0);
+                }
+                size_t lastPos = output.pos;
+                size_t lastInputPos = input.pos;
+                size_t hint = ZSTD_decompressStream(dctx, &output, &input);
+                if (ZSTD_isError(hint)) {
+                    cerr << "TraceReader : zstd decompression error: " << ZSTD_getErrorName(hint) << endl;
+                    exit(1);
+                }
+                if (output.pos != lastPos || input.pos != lastInputPos) {
+                    // 0 if the last frame is complete
+                    ret = hint;
+                } else if (inputEnd) {
+                    // the input is used up and the decoder holds no more data
+                    decodeDone = true;
+                    break;
+                }
+            }
+            block->len = output.pos;
+            putFullBlock(block);
+            if (decodeDone) {
+                break;
+            }
+        }
+        if (decodeDone && ret != 0) {
+            cerr << "TraceReader : truncated zstd frame: " << fileName_ << endl;
+            exit(1);
+        }
+        free(inBuffer);
+        ZSTD_freeDCtx(dctx);
+        fclose(fp);
+#endif
+    } else {
+        // gzip (it also reads the plain file transparently)
+        gzFile gzIn = gzopen(fileName_.c_str(), "rb");
+        if (gzIn == NULL) {
+            cerr << "TraceReader : open file: " << fileName_ << " error" << endl;
+            exit(1);
+        }
+        gzbuffer(gzIn, TRACE_BLOCK_SIZE);
+        while ((block = getFreeBlock()) != NULL) {
+            int len = gzread(gzIn, block->data, TRACE_BLOCK_SIZE);
+            if (len < 0) {
+                int errNum;
+                cerr << "TraceReader : gzip decompression error: " << gzerror(gzIn, &errNum) << endl;
+                exit(1);
+            }
+            block->len = len;
+            putFullBlock(block);
+            if (len == 0) {
+                break;
+            }
+        }
+        gzclose(gzIn);
+    }
+
+    std::unique_lock<std::mutex> lock(queueMtx_);
+    readDone_ = true;
+    notEmpty_.notify_one();
+}
+
+/**
+ * @brief switch to the next filled block
+ * 
+ * @return true there is a new block
+ * @return false the end of file
+ */
+bool TraceReader::nextBlock()
+{
+    std::unique_lock<std::mutex> lock(queueMtx_);
+    if (current_ != NULL) {
+        // return the consumed block to the reader thread
+        freeQueue_.push(current_);
+        current_ = NULL;
+        notFull_.notify_one();
+    }
+    notEmpty_.wait(lock, [this] { return readDone_ || !fullQueue_.empty(); });
+    while (!fullQueue_.empty()) {
+        TraceBlock_t* block = fullQueue_.front();
+        fullQueue_.pop();
+        if (block->len != 0) {
+            current_ = block;
+            currentPos_ = 0;
+            return true;
+        }
+        freeQueue_.push(block);
+    }
+    return false;
+}
+
+/**
+ * @brief read a line, the same semantic of fgets
+ * 
+ * @param buffer the line buffer
+ * @param size the size of line buffer
+ * @return char* the buffer, NULL if the end of file
+ */
+char* TraceReader::readLine(char* buffer, int size)
+{
+    if (!isOpen_ || size <= 0) {
+        return NULL;
+    }
+
+    size_t lineLen = 0;
+    size_t maxLen = size - 1;
+    while (lineLen < maxLen) {
+        if (current_ == NULL || currentPos_ == current_->len) {
+            if (!nextBlock()) {
+                break;
+            }
+        }
+        char* start = current_->data + currentPos_;
+        size_t remain = current_->len - currentPos_;
+        size_t copyLen = (remain < maxLen - lineLen) ? remain : (maxLen - lineLen);
+        char* newLine = (char*) memchr(start, '\n', copyLen);
+        if (newLine != NULL) {
+            copyLen = newLine - start + 1;
+        }
+        memcpy(buffer + lineLen, start, copyLen);
+        lineLen += copyLen;
+        currentPos_ += copyLen;
+        if (newLine != NULL) {
+            break;
+        }
+    }
+
+    if (lineLen == 0) {
+        return NULL;
+    }
+    buffer[lineLen] = '\0';
+    return buffer;
+}
+
+/**
+ * @brief restart from the begin of the input
+ * 
+ */
+void TraceReader::rewind()
+{
+    std::string fileName = fileName_;
+    open(fileName);
+}
+
+/**
+ * @brief stop the reader thread and close the input
+ * 
+ */
+void TraceReader::close()
+{
+    if (!isOpen_) {
+        return ;
+    }
+    {
+        std::unique_lock<std::mutex> lock(queueMtx_);
+        stop_ = true;
+        notFull_.notify_all();
+    }
+    readerThread_.join();
+
+    if (current_ != NULL) {
+        freeQueue_.push(current_);
+        current_ = NULL;
+    }
+    while (!fullQueue_.empty()) {
+        freeQueue_.push(fullQueue_.front());
+        fullQueue_.pop();
+    }
+    while (!freeQueue_.empty()) {
+        TraceBlock_t* block = freeQueue_.front();
+        freeQueue_.pop();
+        free(block->data);
+        free(block);
+    }
+    isOpen_ = false;
+}